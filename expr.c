@@ -23,6 +23,8 @@ static void expr_delete(qexpr_t *e) {
 		return;
 	free(e->ops);
 	free(e->numbers);
+	free(e->code);
+	free(e->hash);
 	for (size_t i = 0; i < e->vars_max; i++) {
 		free(e->vars[i]->name);
 		free(e->vars[i]);
@@ -38,10 +40,12 @@ static qexpr_t *expr_new(size_t max) {
 		goto fail;
 	e->ops     = calloc(sizeof(*e->ops), max);
 	e->numbers = calloc(sizeof(*(e->numbers)), max);
-	if (!(e->ops) || !(e->numbers))
+	e->code    = calloc(sizeof(*(e->code)), max);
+	if (!(e->ops) || !(e->numbers) || !(e->code))
 		goto fail;
 	e->ops_max     = max;
 	e->numbers_max = max;
+	e->code_max    = max;
 	qexpr_init(e);
 	return e;
 fail:
@@ -51,12 +55,23 @@ fail:
 
 static qvariable_t *variable_lookup(qexpr_t *e, const char *name) {
 	assert(e);
-	for (size_t i = 0; i < e->vars_max; i++) {
-		qvariable_t *v = e->vars[i];
-		if (!strcmp(v->name, name))
-			return v;
+	const long i = qexpr_variable(e, name);
+	return i < 0 ? NULL : e->vars[i];
+}
+
+static int variable_index(qexpr_t *e) { /* keep hash at least twice the number of variables */
+	assert(e);
+	size_t max = e->hash_max ? e->hash_max : 16;
+	while (max < (2 * e->vars_max))
+		max *= 2;
+	if (max != e->hash_max) {
+		long *h = realloc(e->hash, max * sizeof(*h));
+		if (!h)
+			return -1;
+		e->hash = h;
+		e->hash_max = max;
 	}
-	return NULL;
+	return qexpr_hash(e);
 }
 
 static char *estrdup(const char *s) {
@@ -95,6 +110,7 @@ static qvariable_t *variable_add(qexpr_t *e, const char *name, q_t value) {
 	v->value = value;
 	vs[e->vars_max++] = v;
 	e->vars = vs;
+	(void)variable_index(e); /* on failure lookups fall back to a linear search */
 	return v;
 fail:
 	free(v);
@@ -131,6 +147,8 @@ static inline int tests(FILE *out) {
 		{   0,  QINT( 1),   "2== (1+1)"   },
 		//{   0,  QINT( 8),   "2 pow 3"     },
 		//{  -1,  QINT( 0),   "2pow3"       },
+		{  -1,  QINT( 0),   "(0-2) pow 0.5" },
+		{  -1,  QINT( 0),   "0 pow 0"     },
 		{   0,  QINT(20),   "(2+3)*4"     },
 		{   0, -QINT( 4),   "(2+(-3))*4"  },
 		{  -1,  QINT( 0),   "1/0"         },
@@ -163,7 +181,10 @@ static inline int tests(FILE *out) {
 
 		const int r = qexpr(e, test->expr);
 		const q_t tos = e->numbers[0];
-		const int pass = (r == test->r) && (r != 0 || tos == test->result);
+		int pass = (r == test->r) && (r != 0 || tos == test->result);
+		if (pass && qexpr_compile(e, test->expr) == 0) /* compile once, run twice */
+			pass = qexpr_run(e, NULL) == test->r && qexpr_run(e, NULL) == test->r
+				&& (test->r != 0 || qexpr_result(e) == test->result);
 		if (fprintf(out, "%s: r(%2d), eval(\"%s\") = %lg \n",
 				pass ? "   ok" : " FAIL", r, test->expr, (double)tos) < 0)
 			report = -1;
@@ -174,29 +195,197 @@ static inline int tests(FILE *out) {
 		}
 		expr_delete(e);
 	}
+	qexpr_t *e = expr_new(64);
+	if (!e || !variable_add(e, "a", 0) || !variable_add(e, "b", 0)) {
+		(void)fprintf(out, "test failed (unable to allocate)\n");
+		report = -1;
+		expr_delete(e);
+		goto end;
+	}
+	const q_t vars1[] = { QINT(1), QINT(2), }, vars2[] = { QINT(3), QINT(0) };
+	const q_t *const row[] = { &vars1[0], &vars1[1], };
+	q_t result = 0;
+	const int pass = qexpr_compile(e, "a+(b*5)") == 0 &&
+		qexpr_run(e, vars1) == 0 && qexpr_result(e) == QINT(11) &&
+		qexpr_run(e, vars2) == 0 && qexpr_result(e) == QINT(3) &&
+		qexpr_compile(e, "a / b") == 0 &&
+		qexpr_run(e, vars1) == 0 && qexpr_result(e) == QINT(1) / 2 &&
+		qexpr_run(e, vars2) == -1 &&
+		qexpr_compile(e, "a+") == -1 && e->code_count == 0 && /* nothing of a failed compile is kept */
+		qexpr_run(e, vars1) == -1 && qexpr_run_n(e, row, 1, &result) == -1 &&
+		qexpr_compile(e, "a*(b") == -1 && qexpr_run(e, NULL) == -1;
+	if (fprintf(out, "%s: compile once, run with different variables\n", pass ? "   ok" : " FAIL") < 0)
+		report = -1;
+	if (!pass)
+		report = -1;
+	enum { ROWS = 200, };
+	static q_t as[ROWS], bs[ROWS], rs[ROWS];
+	const q_t *columns[] = { as, bs, };
+	for (size_t i = 0; i < ROWS; i++) {
+		as[i] = QINT(2) + (q_t)(i * 0x1357);
+		bs[i] = (q_t)(i * 0x2468) - QINT(100);
+	}
+	int columnar = qexpr_compile(e, "a * 3 + b / (a - 1) - sin(b) * 2 + exp(-1) * b") == 0
+		&& qexpr_run_n(e, columns, ROWS, rs) == 0;
+	for (size_t i = 0; columnar && i < ROWS; i++) {
+		const q_t vars[] = { as[i], bs[i], };
+		columnar = qexpr_run(e, vars) == 0 && qexpr_result(e) == rs[i];
+	}
+	as[ROWS - 1] = QINT(1);
+	columnar = columnar && qexpr_run_n(e, columns, ROWS, rs) == -1;
+	static const char *optimised[] = { /* must match 'qexpr' for all values */
+		"a*2", "2*a", "a/2", "a*1", "1*a", "a+0", "0+a", "a-0", "a/1", "-a*2",
+		"a*2*2", "(a/2)/2", "a * (3.1415 / 180) + 2 * 3", "(1+2)*(3+4)*a", "sqrt(4)+a",
+	};
+	static const q_t values[] = {
+		0, 1, -1, 2, -2, 3, -3, QINT(1), -QINT(1), 0x12345, -0x12345,
+		QINT(20000), -QINT(20000), INT32_MAX, INT32_MIN, INT32_MAX - 1, INT32_MIN + 1,
+	};
+	int optimise = 1;
+	for (size_t i = 0; i < (sizeof (optimised) / sizeof (optimised[0])); i++) {
+		if (qexpr_compile(e, optimised[i]) < 0) {
+			optimise = 0;
+			break;
+		}
+		for (size_t j = 0; j < (sizeof (values) / sizeof (values[0])); j++) {
+			const q_t vars[] = { values[j], 0, };
+			e->vars[0]->value = values[j];
+			if (qexpr_run(e, vars) < 0) {
+				optimise = 0;
+				break;
+			}
+			const q_t compiled = qexpr_result(e);
+			optimise &= qexpr(e, optimised[i]) == 0 && qexpr_result(e) == compiled;
+		}
+	}
+	optimise = optimise 
+		&& qexpr_compile(e, "a * (3.1415 / 180) + 2 * 3") == 0 && e->code_count == 5
+		&& qexpr_compile(e, "a * 1 + 0") == 0 && e->code_count == 1
+		&& qexpr_compile(e, "a / (1 - 1)") == -1 && qexpr_compile(e, "sqrt(-1) + a") == -1;
+	if (fprintf(out, "%s: optimised compilation\n", optimise ? "   ok" : " FAIL") < 0)
+		report = -1;
+	if (!optimise)
+		report = -1;
+	if (fprintf(out, "%s: columnar evaluation\n", columnar ? "   ok" : " FAIL") < 0)
+		report = -1;
+	if (!columnar)
+		report = -1;
+	int hashed = 1;
+	for (int i = 0; hashed && i < 300; i++) {
+		char name[16] = { 0, };
+		(void)snprintf(name, sizeof name, "v%d", i);
+		hashed = variable_add(e, name, QINT(i)) != NULL;
+	}
+	const long v123 = qexpr_variable(e, "v123"), v299 = qexpr_variable(e, "v299");
+	hashed = hashed && e->hash_count == e->vars_max && v123 >= 0 && v299 >= 0
+		&& qexpr_variable(e, "v300") == -1 && qexpr_variable(e, "a") == 0
+		&& qexpr(e, "v123 + v299") == 0 && qexpr_result(e) == QINT(422);
+	if (hashed) { /* handles are stable, update a value through one */
+		e->vars[v123]->value = QINT(1);
+		hashed = qexpr(e, "v123 + v299") == 0 && qexpr_result(e) == QINT(300)
+			&& qexpr_variable(e, "v123") == v123;
+	}
+	if (fprintf(out, "%s: hashed variable lookup\n", hashed ? "   ok" : " FAIL") < 0)
+		report = -1;
+	if (!hashed)
+		report = -1;
+	qctx_t wrap = { .bound = qbound_wrap, .dp = 4, .base = 10, };
+	const unsigned base = qconf.base;
+	int contexts = qexpr_ctx(e, &wrap, "32767 + 1") == 0
+		&& qexpr_result(e) == qbound_wrap((ld_t)QINT(32767) + QINT(1))
+		&& qexpr_ctx(e, &wrap, "base(16)") == 0 && wrap.base == 16 && qconf.base == base
+		&& qexpr_ctx(e, &wrap, "10 * 2") == 0 && qexpr_result(e) == QINT(32)
+		&& qexpr_compile_ctx(e, &wrap, "a * 2 + b - 1") == 0;
+	for (size_t i = 0; contexts && i < ROWS; i++) {
+		as[i] = (q_t)(i * 0x9E3779B1uL);
+		bs[i] = (q_t)(i * 0x7F4A7C15uL);
+	}
+	contexts = contexts && qexpr_run_n(e, columns, ROWS, rs) == 0;
+	for (size_t i = 0; contexts && i < ROWS; i++) {
+		const q_t vars[] = { as[i], bs[i], };
+		const q_t r = qsub_ctx(&wrap, qadd_ctx(&wrap, qadd_ctx(&wrap, as[i], as[i]), bs[i]), QINT(1));
+		contexts = qexpr_run(e, vars) == 0 && qexpr_result(e) == r && rs[i] == r;
+	}
+	const qbounds_t bound = qconf.bound;
+	wrap.base = 10;
+	qconf.bound = qbound_wrap;
+	const q_t wrapped_exp = qexp(QINT(11)), wrapped_pow = qpow(QINT(3), QINT(10));
+	qconf.bound = bound;
+	contexts = contexts /* every operator uses the context, not only the arithmetic ones */
+		&& qexpr_ctx(e, &wrap, "exp(11)") == 0 && qexpr_result(e) == wrapped_exp && wrapped_exp != qinfo.max
+		&& qexpr_ctx(e, &wrap, "3 pow 10") == 0 && qexpr_result(e) == wrapped_pow && wrapped_pow != qinfo.max
+		&& qexpr_ctx(e, NULL, "exp(11)") == 0 && qexpr_result(e) == qinfo.max && qexp(QINT(11)) == qinfo.max
+		&& qexpr_compile_ctx(e, &wrap, "places(3) + a") == 0 && wrap.dp == 4 /* applied when run, not compiled */
+		&& qexpr_run(e, vars1) == 0 && wrap.dp == 3 && qconf.dp != 3;
+	e->ctx = NULL;
+	if (fprintf(out, "%s: evaluation with a context\n", contexts ? "   ok" : " FAIL") < 0)
+		report = -1;
+	if (!contexts)
+		report = -1;
+	qstats_t stats;
+	int counted = qstats_reset() < 0 && qstats(&stats) < 0 && stats.domain[0] == 0; /* built without counters */
+	if (qstats_reset() == 0) {
+		counted = qexpr(e, "log(0-1)") == -1 && qexpr(e, "1/0") == -1
+			&& qexpr(e, "20000 * 2") == 0 && qstats(&stats) == 0
+			&& stats.bounded[QSTAT_MUL] == 1 && stats.bounded[QSTAT_ADD] == 0;
+		unsigned long long domain = 0;
+		for (size_t i = 0; i < QSTAT_OPERATORS; i++)
+			domain += stats.domain[i];
+		counted = counted && domain == 2 && qstats_reset() == 0
+			&& qstats(&stats) == 0 && stats.bounded[QSTAT_MUL] == 0;
+	}
+	if (fprintf(out, "%s: instrumentation counters\n", counted ? "   ok" : " FAIL") < 0)
+		report = -1;
+	if (!counted)
+		report = -1;
+	static unsigned char arena[4096];
+	qexpr_t *a = qexpr_arena(&arena[1], sizeof (arena) - 1, 4); /* deliberately misaligned */
+	int arenas = a && (unsigned char*)a >= &arena[1] && (unsigned char*)a < &arena[1 + sizeof (void*)]
+		&& qexpr_reset(e) == -1 && qexpr_arena(arena, sizeof (qexpr_t) - 1, 0) == NULL
+		&& qexpr_arena_variable(a, "x", QINT(2)) && qexpr_arena_variable(a, "y", QINT(3))
+		&& !qexpr_arena_variable(a, "1x", 0)
+		&& qexpr(a, "x * (y + 1)") == 0 && qexpr_result(a) == QINT(8)
+		&& qexpr_compile(a, "x * (y + 1) - x") == 0 && a->depth == 3 && a->numbers_max == 3 && a->ops_max == 0
+		&& qexpr(a, "((((((x))))))") == 0 && a->ops_max > 3 /* moves the stacks, keeping the code */
+		&& qexpr_run(a, NULL) == 0 && qexpr_result(a) == QINT(6)
+		&& qexpr_arena_variable(a, "x", QINT(4)) == a->vars[0] && qexpr_run(a, NULL) == 0 && qexpr_result(a) == QINT(12)
+		&& qexpr_compile(a, "x * (x + 1) - x * x + x") == 0 && a->depth == 3
+		&& qexpr(a, "1") == 0 && qexpr_result(a) == QINT(1) /* shorter, must keep the longer code */
+		&& qexpr_run(a, NULL) == 0 && qexpr_result(a) == QINT(8)
+		&& qexpr_arena_variable(a, "z", 0) && qexpr_arena_variable(a, "w", 0) && !qexpr_arena_variable(a, "v", 0)
+		&& qexpr_reset(a) == 0 && a->vars_max == 0 && a->arena_count == a->arena_mark
+		&& qexpr(a, "x") == -1 && qexpr_arena_variable(a, "v", QINT(1)) && qexpr(a, "v + 1") == 0 && qexpr_result(a) == QINT(2);
+	qexpr_t *small = qexpr_arena(arena, sizeof (qexpr_t) + 256, 1);
+	arenas = arenas && small && qexpr(small, "1 + 1") == 0 && qexpr_result(small) == QINT(2)
+		&& qexpr(small, "1+1+1+1+1+1+1+1+1+1+1+1+1+1+1+1+1+1+1+1+1+1+1+1+1+1+1+1+1+1") == -1
+		&& qexpr_error(small) && qexpr(small, "2 * 3") == 0 && qexpr_result(small) == QINT(6);
+	if (fprintf(out, "%s: arena allocation\n", arenas ? "   ok" : " FAIL") < 0)
+		report = -1;
+	if (!arenas)
+		report = -1;
+	expr_delete(e);
 end:
 	if (fprintf(out, "Tests Complete: %s\n", report == 0 ? "pass" : "FAIL") < 0)
 		report = -1;
 	return report;
 }
 
-static qexpr_t *expr_new_with_vars(size_t max) {
-	qexpr_t *e = expr_new(max);
+static qexpr_t *expr_new_with_vars(void *buffer, size_t size) {
+	qexpr_t *e = qexpr_arena(buffer, size, 16);
 	if (!e) return NULL;
-	if (!variable_add(e, "whole", qinfo.whole)) goto fail;
-	if (!variable_add(e, "fractional", qinfo.fractional)) goto fail;
-	if (!variable_add(e, "bit", qinfo.bit)) goto fail;
-	if (!variable_add(e, "smallest", qinfo.min)) goto fail;
-	if (!variable_add(e, "biggest", qinfo.max)) goto fail;
-	if (!variable_add(e, "pi", qinfo.pi)) goto fail;
-	if (!variable_add(e, "e", qinfo.e)) goto fail;
-	if (!variable_add(e, "sqrt2", qinfo.sqrt2)) goto fail;
-	if (!variable_add(e, "sqrt3", qinfo.sqrt3)) goto fail;
-	if (!variable_add(e, "ln2", qinfo.ln2)) goto fail;
-	if (!variable_add(e, "ln10", qinfo.ln10)) goto fail;
+	if (!qexpr_arena_variable(e, "whole", qinfo.whole)) goto fail;
+	if (!qexpr_arena_variable(e, "fractional", qinfo.fractional)) goto fail;
+	if (!qexpr_arena_variable(e, "bit", qinfo.bit)) goto fail;
+	if (!qexpr_arena_variable(e, "smallest", qinfo.min)) goto fail;
+	if (!qexpr_arena_variable(e, "biggest", qinfo.max)) goto fail;
+	if (!qexpr_arena_variable(e, "pi", qinfo.pi)) goto fail;
+	if (!qexpr_arena_variable(e, "e", qinfo.e)) goto fail;
+	if (!qexpr_arena_variable(e, "sqrt2", qinfo.sqrt2)) goto fail;
+	if (!qexpr_arena_variable(e, "sqrt3", qinfo.sqrt3)) goto fail;
+	if (!qexpr_arena_variable(e, "ln2", qinfo.ln2)) goto fail;
+	if (!qexpr_arena_variable(e, "ln10", qinfo.ln10)) goto fail;
 	return e;
 fail:
-	expr_delete(e);
 	return NULL;
 }
 
@@ -220,8 +409,9 @@ int main(int argc, char *argv[]) {
 
 	int r = 0;
 
+	static unsigned char arena[1 << 16]; /* no allocation, an expression is evaluated in this */
 	for (int i = 1; i < argc; i++) {
-		qexpr_t *e = expr_new_with_vars(0);
+		qexpr_t *e = expr_new_with_vars(arena, sizeof arena);
 		if (!e) {
 			(void)fprintf(stderr, "allocate failed\n");
 			r = 1;
@@ -237,7 +427,6 @@ int main(int argc, char *argv[]) {
 			(void)fprintf(stderr, "error: %s\n", e->error_string);
 			r = 1;
 		}
-		expr_delete(e);
 	}
 	return r;
 }
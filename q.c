@@ -5,7 +5,8 @@
  * Repo:    <https://github.com/q> 
  *
  *
- * A Q32.32 version would be useful. 
+ * A small core of arithmetic in other formats (Q32.32, Q8.8, Q1.15) is
+ * generated from the templates in 'qgen.h', this file is not.
  *
  * The following should be changed/done for this library:
  *
@@ -22,6 +23,7 @@
  * limit decimal places).
  */
 
+#undef Q_INLINE_IMPL /* the library always has the out-of-line definitions */
 #include "q.h"
 #include <assert.h>
 #include <ctype.h>
@@ -44,9 +46,90 @@
 #define CONFIG_Q_HIDE_FUNCS (0)
 #endif
 
+#ifndef CONFIG_Q_EXPR_BLOCK /* rows evaluated together by 'qexpr_run_n' */
+#define CONFIG_Q_EXPR_BLOCK (64)
+#endif
+
+#ifndef CONFIG_Q_EXPR_DEPTH /* maximum stack depth of expression for 'qexpr_run_n' */
+#define CONFIG_Q_EXPR_DEPTH (16)
+#endif
+
+#ifndef CONFIG_Q_MATRIX_BLOCK /* rows of 'a' kept in cache together by 'qmatrix_mul' */
+#define CONFIG_Q_MATRIX_BLOCK (64)
+#endif
+
+#ifndef CONFIG_Q_PID_BLOCK /* controllers updated together by 'qpid_bank_update' */
+#define CONFIG_Q_PID_BLOCK (64)
+#endif
+
+#ifndef CONFIG_Q_SIMD /* 1 = use SIMD kernels in bulk functions if the target has them, 0 = portable C only */
+#define CONFIG_Q_SIMD (1)
+#endif
+
+#ifndef CONFIG_Q_STATS /* 1 = count out of range results and failed checks, see 'qstats', 0 = no counters */
+#define CONFIG_Q_STATS (0)
+#endif
+
+#ifndef CONFIG_Q_THREAD_LOCAL /* 1 = evaluator context and counters per thread, 0 = shared, single threaded only */
+#define CONFIG_Q_THREAD_LOCAL (1)
+#endif
+
+#if CONFIG_Q_SIMD && defined(__AVX2__)
+#include <immintrin.h>
+#define Q_SIMD_AVX2 (1)
+#elif CONFIG_Q_SIMD && defined(__SSE4_1__)
+#include <smmintrin.h>
+#define Q_SIMD_SSE41 (1)
+#elif CONFIG_Q_SIMD && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define Q_SIMD_NEON (1)
+#endif
+
 typedef  int16_t hd_t; /* half Q width,      signed */
 typedef uint64_t lu_t; /* double Q width,  unsigned */
 
+#if defined(__GNUC__) || defined(__clang__)
+#define QALIGN  __attribute__((aligned(64)))
+#else
+#define QALIGN
+#endif
+
+/* The evaluator's context ('active') and the counters are kept per thread,
+ * C99 has no thread local storage so it has to come from the compiler. A
+ * build without it must ask for the state to be shared, for single threaded
+ * use, rather than have threads silently use each other's contexts. */
+#if !CONFIG_Q_THREAD_LOCAL
+#define QTHREAD /* shared between threads, single threaded use only */
+#elif defined(__GNUC__) || defined(__clang__)
+#define QTHREAD __thread
+#elif defined(_MSC_VER)
+#define QTHREAD __declspec(thread)
+#elif defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L)
+#define QTHREAD _Thread_local
+#else
+#error "No thread local storage, define CONFIG_Q_THREAD_LOCAL to be zero for single threaded use"
+#endif
+
+/* The context the expression evaluator is applying an operator in, if it is
+ * not 'qconf', so everything the operator calls saturates the same way. It
+ * is only read when a result is out of range. */
+static QTHREAD qctx_t *active;
+
+/* The counters are only touched on the slow paths, when a result goes out
+ * of range or a check fails, and each thread has its own so they need no
+ * locking. They are padded out to whole cache lines so no other data shares
+ * a line with them. Without 'CONFIG_Q_STATS' the 'QSTAT' macro is empty. */
+#if CONFIG_Q_STATS
+typedef union {
+	qstats_t s;
+	unsigned char pad[((sizeof (qstats_t) + 63) / 64) * 64];
+} QALIGN qstats_line_t;
+static QTHREAD qstats_line_t stats;
+#define QSTAT(COUNTER) (stats.s.COUNTER++)
+#else
+#define QSTAT(COUNTER) ((void)0)
+#endif
+
 const qinfo_t qinfo = {
 	.whole      = QBITS,
 	.fractional = QBITS,
@@ -58,8 +141,8 @@ const qinfo_t qinfo = {
 
 	.pi    = QPI, /* 3.243F6 A8885 A308D 31319 8A2E0... */
 	.e     = QMK(0x2, 0xB7E1, 16), /* 2.B7E1 5162 8A... */
-	.sqrt2 = QMK(0x1, 0x6A09, 16), /* 1.6A09 E667 F3... */
-	.sqrt3 = QMK(0x1, 0xBB67, 16), /* 1.BB67 AE85 84... */
+	.sqrt2 = QMK(0x1, 0x6A0A, 16), /* 1.6A09 E667 F3..., rounded to nearest */
+	.sqrt3 = QMK(0x1, 0xBB68, 16), /* 1.BB67 AE85 84..., rounded to nearest */
 	.ln2   = QMK(0x0, 0xB172, 16), /* 0.B172 17F7 D1... */
 	.ln10  = QMK(0x2, 0x4D76, 16), /* 2.4D76 3776 AA... */
 
@@ -109,9 +192,20 @@ q_t qbound_wrap(const ld_t s) { /**< wrap numbers on overflow */
 	return DMAX - ((-s) % DMAX);
 }
 
-static inline q_t qsat(const ld_t s) {
+static inline q_t qsat_ctx(const qctx_t *c, const qstat_operation_t op, const ld_t s) {
+	assert(c);
 	static_assertions();
-	if (s > DMAX || s < DMIN) return qconf.bound(s);
+	if (s > DMAX || s < DMIN) {
+		QSTAT(bounded[op]);
+		return c->bound(s);
+	}
+	UNUSED(op);
+	return s;
+}
+
+static inline q_t qsat(const qstat_operation_t op, const ld_t s) {
+	if (s > DMAX || s < DMIN)
+		return qsat_ctx(active ? active : &qconf, op, s);
 	return s;
 }
 
@@ -132,6 +226,48 @@ static inline d_t divn(const d_t v, const unsigned p) {
 	return leading | shifted;
 }
 
+static inline ld_t ldivn(const ld_t v, const unsigned p) { /* 'divn' for 'ld_t' */
+	const lu_t shifted = ((lu_t)v) >> p;
+	if (v >= 0)
+		return shifted;
+	const lu_t leading = ((lu_t)(-1ll)) << ((sizeof(v)*CHAR_BIT) - p - 1);
+	return leading | shifted;
+}
+
+static inline q_t q30toq(const ld_t v) { /* Q2.30 to Q16.16, rounding */
+	return qsat(QSTAT_OTHER, ldivn(v + (1l << 13), 14));
+}
+
+static inline uint32_t qhash(uint32_t h, const char *s) { /* FNV-1a */
+	assert(s);
+	for (; *s; s++)
+		h = (h ^ (unsigned char)*s) * 0x01000193uL;
+	return h;
+}
+
+static inline lu_t isqrt(lu_t n) { /* round(sqrt(n)), bit by bit, always 32 steps */
+	lu_t r = 0, bit = 1ull << 62;
+	for (int i = 0; i < 32; i++, bit >>= 2) {
+		const lu_t t = r + bit, mask = -(lu_t)(n >= t);
+		n -= t & mask;
+		r = (r >> 1) + (bit & mask);
+	}
+	return r + (n > r); /* 'n' is now the remainder */
+}
+
+static inline unsigned qclz(u_t x) { /* count leading zeros, qclz(0) == 32 */
+#ifdef __GNUC__
+	return x ? (unsigned)__builtin_clz(x) : 32u;
+#else
+	unsigned n = 0;
+	if (!x)
+		return 32u;
+	for (; !(x & 0x80000000uL); x <<= 1)
+		n++;
+	return n;
+#endif
+}
+
 /* These really all should be moved the header for efficiency reasons */
 static inline u_t qhigh(const q_t q) { return ((u_t)q) >> QBITS; }
 static inline u_t qlow(const q_t q)  { return ((u_t)q) & QMASK; }
@@ -164,8 +300,8 @@ q_t qnegate(const q_t a)                { return (~(u_t)a) + 1ULL; }
 q_t qmin(const q_t a, const q_t b)      { return qless(a, b) ? a : b; }
 q_t qmax(const q_t a, const q_t b)      { return qmore(a, b) ? a : b; }
 q_t qabs(const q_t a)                   { return qisnegative(a) ? qnegate(a) : a; }
-q_t qadd(const q_t a, const q_t b)      { return qsat((ld_t)a + (ld_t)b); }
-q_t qsub(const q_t a, const q_t b)      { return qsat((ld_t)a - (ld_t)b); }
+q_t qadd(const q_t a, const q_t b)      { return qsat(QSTAT_ADD, (ld_t)a + (ld_t)b); }
+q_t qsub(const q_t a, const q_t b)      { return qsat(QSTAT_SUB, (ld_t)a - (ld_t)b); }
 q_t qcopysign(const q_t a, const q_t b) { return qisnegative(b) ? qnegate(qabs(a)) : qabs(a); }
 q_t qand(const q_t a, const q_t b)      { return a & b; }
 q_t qxor(const q_t a, const q_t b)      { return a ^ b; }
@@ -177,7 +313,7 @@ q_t qlogical(const q_t a)               { return QINT(BOOLIFY(a)); }
 q_t qlrs(const q_t a, const q_t b)      { /* assert low bits == 0? */ return (u_t)a >> (u_t)qtoi(b); }
 q_t qlls(const q_t a, const q_t b)      { return (u_t)a << b; }
 q_t qars(const q_t a, const q_t b)      { return arshift(a, qtoi(b)); }
-q_t qals(const q_t a, const q_t b)      { return qsat((lu_t)a << b); }
+q_t qals(const q_t a, const q_t b)      { return qsat(QSTAT_SHIFT, (lu_t)a << b); }
 q_t qsign(const q_t a)                  { return qisnegative(a) ? -QINT(1) : QINT(1); }
 q_t qsignum(const q_t a)                { return a ? qsign(a) : QINT(0); }
 
@@ -229,6 +365,13 @@ q_t qround(q_t q) {
 	return negative ? qnegate(q) : q;
 }
 
+static inline int little_endian(void) {
+	const u_t one = 1;
+	unsigned char first = 0;
+	memcpy(&first, &one, 1);
+	return first;
+}
+
 int qpack(const q_t *q, char *buffer, const size_t length) {
 	assert(buffer);
 	if (length < sizeof(*q))
@@ -257,29 +400,122 @@ int qunpack(q_t *q, const char *buffer, const size_t length) {
 	return sizeof(*q);
 }
 
+/* Arrays are packed in the same little endian order as 'qpack', which on
+ * a little endian machine is a straight copy. */
+int qpack_n(const q_t *q, const size_t n, char *buffer, const size_t length) {
+	assert(q);
+	assert(buffer);
+	if (n > (INT_MAX / sizeof (*q)) || length < (n * sizeof (*q)))
+		return -1;
+	if (little_endian()) {
+		memcpy(buffer, q, n * sizeof (*q));
+	} else {
+		for (size_t i = 0; i < n; i++)
+			qpack(&q[i], &buffer[i * sizeof (*q)], sizeof (*q));
+	}
+	return n * sizeof (*q);
+}
+
+int qunpack_n(q_t *q, const size_t n, const char *buffer, const size_t length) {
+	assert(q);
+	assert(buffer);
+	if (n > (INT_MAX / sizeof (*q)) || length < (n * sizeof (*q)))
+		return -1;
+	if (little_endian()) {
+		memcpy(q, buffer, n * sizeof (*q));
+	} else {
+		for (size_t i = 0; i < n; i++)
+			qunpack(&q[i], &buffer[i * sizeof (*q)], sizeof (*q));
+	}
+	return n * sizeof (*q);
+}
+
 static inline ld_t multiply(const q_t a, const q_t b) {
 	const ld_t dd = ((ld_t)a * (ld_t)b) + (lu_t)QHIGH;
 	/* N.B. portable version of "dd >> QBITS", for double width signed values */
-	return dd < 0 ? (-1ull << (2 * QBITS)) | ((lu_t)dd >> QBITS) : ((lu_t)dd) >> QBITS;
+	return dd < 0 ? (-1ull << ((sizeof(dd) * CHAR_BIT) - QBITS)) | ((lu_t)dd >> QBITS) : ((lu_t)dd) >> QBITS;
 }
 
 q_t qmul(const q_t a, const q_t b) {
-	return qsat(multiply(a, b));
+	return qsat(QSTAT_MUL, multiply(a, b));
 }
 
 q_t qfma(const q_t a, const q_t b, const q_t c) {
-	return qsat(multiply(a, b) + (ld_t)c);
+	return qsat(QSTAT_FMA, multiply(a, b) + (ld_t)c);
 }
 
-q_t qdiv(const q_t a, const q_t b) {
-	assert(b);
+static inline ld_t dividend(const q_t a, const q_t b) { /* a, with rounding for b */
 	const ld_t dd = ((ld_t)a) << QBITS;
 	ld_t bd2 = divn(b, 1);
 	if (!((dd >= 0 && b > 0) || (dd < 0 && b < 0)))
 		bd2 = -bd2;
-	/* Overflow not checked! */
+	return dd + bd2;
+}
+
+q_t qdiv(const q_t a, const q_t b) {
+	assert(b);
 	/*return (dd/b) + (bd2/b);*/
-	return (dd + bd2) / b;
+	return qsat(QSTAT_DIV, dividend(a, b) / b);
+}
+
+q_t qadd_ctx(const qctx_t *c, const q_t a, const q_t b) { return qsat_ctx(c, QSTAT_ADD, (ld_t)a + (ld_t)b); }
+q_t qsub_ctx(const qctx_t *c, const q_t a, const q_t b) { return qsat_ctx(c, QSTAT_SUB, (ld_t)a - (ld_t)b); }
+q_t qmul_ctx(const qctx_t *c, const q_t a, const q_t b) { return qsat_ctx(c, QSTAT_MUL, multiply(a, b)); }
+
+q_t qdiv_ctx(const qctx_t *c, const q_t a, const q_t b) {
+	assert(b);
+	return qsat_ctx(c, QSTAT_DIV, dividend(a, b) / b);
+}
+
+/* Dividing many numbers by the same divisor can be done with a multiply
+ * instead of a (slow) 64-bit division. The reciprocal 'floor((2^64-1)/|d|)'
+ * gives a quotient that is at most one too small for dividends under 2^63,
+ * which a single correction step fixes, so the result is always identical to
+ * 'qdiv'. */
+
+static inline lu_t mulhi(const lu_t a, const lu_t b) { /* (a * b) >> 64 */
+#ifdef __SIZEOF_INT128__
+	__extension__ typedef unsigned __int128 qu128_t;
+	return ((qu128_t)a * b) >> 64;
+#else
+	const lu_t al = (u_t)a, ah = a >> 32, bl = (u_t)b, bh = b >> 32;
+	const lu_t ll = al * bl, lh = al * bh, hl = ah * bl, hh = ah * bh;
+	const lu_t mid = (ll >> 32) + (u_t)lh + (u_t)hl;
+	return hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+#endif
+}
+
+qrecip_t qrecip_init(const q_t d) {
+	assert(d);
+	const lu_t m = d < 0 ? -(lu_t)(ld_t)d : (lu_t)d;
+	const qrecip_t r = { .divisor = d, .reciprocal = m ? UINT64_MAX / m : 0, };
+	return r;
+}
+
+q_t qdiv_by(const qrecip_t *r, const q_t a) {
+	assert(r);
+	assert(r->divisor);
+	const q_t b = r->divisor;
+	const ld_t n = dividend(a, b);
+	const lu_t un = n < 0 ? -(lu_t)n : (lu_t)n, ub = b < 0 ? -(lu_t)(ld_t)b : (lu_t)b;
+	lu_t q = mulhi(un, r->reciprocal);
+	q += (un - (q * ub)) >= ub;
+	return qsat(QSTAT_DIV, (n < 0) != (b < 0) ? -(ld_t)q : (ld_t)q);
+}
+
+void qdiv_by_n(q_t *r, const q_t *a, const qrecip_t *d, const size_t n) {
+	assert(r);
+	assert(a);
+	assert(d);
+	for (size_t i = 0; i < n; i++)
+		r[i] = qdiv_by(d, a[i]);
+}
+
+void qdiv_scalar_n(q_t *r, const q_t *a, const q_t s, const size_t n) {
+	assert(r);
+	assert(a);
+	const qrecip_t d = qrecip_init(s);
+	qdiv_by_n(r, a, &d, n);
 }
 
 q_t qrem(const q_t a, const q_t b) {
@@ -290,6 +526,565 @@ q_t qmod(q_t a, q_t b) {
 	return qsub(a, qmul(qfloor(qdiv(a, b)), b));
 }
 
+/********* Bulk Array Routines ***********************************************/
+
+/* The bulk routines give bit-identical results to the scalar routines they
+ * are named after, they operate on 'n' elements and the result array may be
+ * the same as one of the inputs (but should not otherwise overlap them).
+ *
+ * The SIMD kernels only implement saturation, so they are used only when the
+ * default bounds handler, 'qbound_saturate', is selected. Any remaining
+ * elements, or all of them if another handler is in use, are processed by
+ * the scalar functions. The kernels are selected at compile time, build with
+ * '-msse4.1', '-mavx2' or for a NEON target to enable them.
+ *
+ * The multiplication kernels compute the same double width product as
+ * 'multiply', adding the rounding constant (and for FMA the addend shifted
+ * into place, which is exact as its lower bits are zero). The result is in
+ * range only if bits 47 to 63 of that product are all the same, which can
+ * be checked on the upper 32-bits of each product alone. */
+
+#if defined(Q_SIMD_AVX2)
+typedef __m256i qv_t;
+#define QV_LANES (8)
+
+static inline qv_t qv_load(const q_t *p)   { return _mm256_loadu_si256((const __m256i*)p); }
+static inline void qv_store(q_t *p, qv_t v) { _mm256_storeu_si256((__m256i*)p, v); }
+static inline qv_t qv_dup(const q_t s)     { return _mm256_set1_epi32(s); }
+
+static inline qv_t qv_xor(const qv_t a, const qv_t b)  { return _mm256_xor_si256(a, b); }
+static inline qv_t qv_wadd(const qv_t a, const qv_t b) { return _mm256_add_epi32(a, b); } /* wrapping add */
+static inline qv_t qv_wsub(const qv_t a, const qv_t b) { return _mm256_sub_epi32(a, b); } /* wrapping subtract */
+static inline qv_t qv_sra(const qv_t a, const unsigned p) { return _mm256_sra_epi32(a, _mm_cvtsi32_si128(p)); }
+static inline qv_t qv_sign(const qv_t a) { return _mm256_srai_epi32(a, 31); } /* -1 if negative, 0 otherwise */
+static inline qv_t qv_min(const qv_t a, const qv_t b) { return _mm256_min_epi32(a, b); }
+static inline qv_t qv_max(const qv_t a, const qv_t b) { return _mm256_max_epi32(a, b); }
+static inline qv_t qv_and(const qv_t a, const qv_t b) { return _mm256_and_si256(a, b); }
+static inline qv_t qv_wmul(const qv_t a, const qv_t b) { return _mm256_mullo_epi32(a, b); } /* lower 32-bits of product */
+static inline qv_t qv_sll(const qv_t a, const unsigned p) { return _mm256_sll_epi32(a, _mm_cvtsi32_si128(p)); }
+static inline qv_t qv_select(const qv_t m, const qv_t a, const qv_t b) { return _mm256_blendv_epi8(b, a, m); } /* m ? a : b */
+
+#define QV_COMPLEX (1) /* has 'qv_cmul' and 'qv_rot' for interleaved complex numbers */
+
+static inline qv_t qv_cmul(const qv_t a, const qv_t w) { /* rounded complex multiply, as 'fft_cmul' */
+	const qv_t ao = _mm256_srli_epi64(a, 32), wo = _mm256_srli_epi64(w, 32), round = _mm256_set1_epi64x(QHIGH);
+	const qv_t re = _mm256_add_epi64(_mm256_sub_epi64(_mm256_mul_epi32(a, w), _mm256_mul_epi32(ao, wo)), round);
+	const qv_t im = _mm256_add_epi64(_mm256_add_epi64(_mm256_mul_epi32(a, wo), _mm256_mul_epi32(ao, w)), round);
+	return _mm256_blend_epi32(_mm256_srli_epi64(re, QBITS), _mm256_slli_epi64(im, 32 - QBITS), 0xAA);
+}
+
+static inline qv_t qv_rot(const qv_t t) { /* -i * t */
+	return _mm256_sign_epi32(_mm256_shuffle_epi32(t, 0xB1), _mm256_set_epi32(-1, 1, -1, 1, -1, 1, -1, 1));
+}
+
+#define QV_ISQRT (1) /* has 'qv_isqrt' for 'QV_LANES/2' unsigned 64-bit numbers */
+
+static inline qv_t qv_below(const qv_t a, const qv_t b) { /* a < b as unsigned 64-bit numbers, as a mask */
+	const qv_t bias = _mm256_set1_epi64x((ld_t)(1ull << 63));
+	return _mm256_cmpgt_epi64(_mm256_xor_si256(b, bias), _mm256_xor_si256(a, bias));
+}
+
+static inline void qv_isqrt(lu_t *v) { /* as 'isqrt', in place */
+	qv_t n = _mm256_loadu_si256((const __m256i*)v), r = _mm256_setzero_si256(), bit = _mm256_set1_epi64x(1ll << 62);
+	for (int i = 0; i < 32; i++, bit = _mm256_srli_epi64(bit, 2)) {
+		const qv_t t = _mm256_add_epi64(r, bit), less = qv_below(n, t);
+		n = _mm256_sub_epi64(n, _mm256_andnot_si256(less, t));
+		r = _mm256_add_epi64(_mm256_srli_epi64(r, 1), _mm256_andnot_si256(less, bit));
+	}
+	_mm256_storeu_si256((__m256i*)v, _mm256_sub_epi64(r, qv_below(r, n)));
+}
+
+static inline qv_t qv_saturation(const qv_t a) { /* saturation value given sign of 'a' */
+	return _mm256_xor_si256(_mm256_srai_epi32(a, 31), _mm256_set1_epi32(DMAX));
+}
+
+static inline qv_t qv_add(const qv_t a, const qv_t b) {
+	const qv_t r = _mm256_add_epi32(a, b);
+	const qv_t o = _mm256_and_si256(_mm256_xor_si256(a, r), _mm256_xor_si256(b, r));
+	return _mm256_blendv_epi8(r, qv_saturation(a), _mm256_srai_epi32(o, 31));
+}
+
+static inline qv_t qv_sub(const qv_t a, const qv_t b) {
+	const qv_t r = _mm256_sub_epi32(a, b);
+	const qv_t o = _mm256_and_si256(_mm256_xor_si256(a, b), _mm256_xor_si256(a, r));
+	return _mm256_blendv_epi8(r, qv_saturation(a), _mm256_srai_epi32(o, 31));
+}
+
+static inline qv_t qv_widen(const qv_t v) { /* sign extend even 32-bit elements to 64-bits */
+	return _mm256_blend_epi32(v, _mm256_srai_epi32(_mm256_slli_epi64(v, 32), 31), 0xAA);
+}
+
+static inline qv_t qv_mla(const qv_t a, const qv_t b, const qv_t ce, const qv_t co) {
+	const qv_t pe = _mm256_add_epi64(_mm256_mul_epi32(a, b), ce);
+	const qv_t po = _mm256_add_epi64(_mm256_mul_epi32(_mm256_srli_epi64(a, 32), _mm256_srli_epi64(b, 32)), co);
+	const qv_t lo = _mm256_blend_epi32(_mm256_srli_epi64(pe, QBITS), _mm256_slli_epi64(po, QBITS), 0xAA);
+	const qv_t hi = _mm256_blend_epi32(_mm256_srli_epi64(pe, 32), po, 0xAA);
+	const qv_t ok = _mm256_cmpeq_epi32(_mm256_srai_epi32(hi, 15), _mm256_srai_epi32(hi, 31));
+	return _mm256_blendv_epi8(qv_saturation(hi), lo, ok);
+}
+
+static inline qv_t qv_mul(const qv_t a, const qv_t b) {
+	const qv_t round = _mm256_set1_epi64x(QHIGH);
+	return qv_mla(a, b, round, round);
+}
+
+static inline qv_t qv_fma(const qv_t a, const qv_t b, const qv_t c) {
+	const qv_t round = _mm256_set1_epi64x(QHIGH);
+	const qv_t ce = _mm256_add_epi64(_mm256_slli_epi64(qv_widen(c), QBITS), round);
+	const qv_t co = _mm256_add_epi64(_mm256_slli_epi64(qv_widen(_mm256_srli_epi64(c, 32)), QBITS), round);
+	return qv_mla(a, b, ce, co);
+}
+
+typedef struct { qv_t se, so, he, ho; } qv_acc_t; /* see 'matrix_strip' */
+
+static inline void qv_acc_zero(qv_acc_t *c) { c->se = c->so = c->he = c->ho = _mm256_setzero_si256(); }
+
+static inline void qv_acc_mac(qv_acc_t *c, const qv_t a, const qv_t b) {
+	const qv_t pe = _mm256_mul_epi32(a, b);
+	const qv_t po = _mm256_mul_epi32(_mm256_srli_epi64(a, 32), _mm256_srli_epi64(b, 32));
+	c->se = _mm256_add_epi64(c->se, pe);
+	c->so = _mm256_add_epi64(c->so, po);
+	c->he = _mm256_add_epi64(c->he, qv_widen(_mm256_srli_epi64(pe, 32)));
+	c->ho = _mm256_add_epi64(c->ho, qv_widen(_mm256_srli_epi64(po, 32)));
+}
+
+static inline void qv_acc_store(const qv_acc_t *c, lu_t *s, ld_t *h) {
+	lu_t se[4], so[4];
+	ld_t he[4], ho[4];
+	_mm256_storeu_si256((__m256i*)se, c->se);
+	_mm256_storeu_si256((__m256i*)so, c->so);
+	_mm256_storeu_si256((__m256i*)he, c->he);
+	_mm256_storeu_si256((__m256i*)ho, c->ho);
+	for (size_t i = 0; i < 4; i++) {
+		s[2*i] = se[i], s[2*i + 1] = so[i];
+		h[2*i] = he[i], h[2*i + 1] = ho[i];
+	}
+}
+#elif defined(Q_SIMD_SSE41)
+typedef __m128i qv_t;
+#define QV_LANES (4)
+
+static inline qv_t qv_load(const q_t *p)   { return _mm_loadu_si128((const __m128i*)p); }
+static inline void qv_store(q_t *p, qv_t v) { _mm_storeu_si128((__m128i*)p, v); }
+static inline qv_t qv_dup(const q_t s)     { return _mm_set1_epi32(s); }
+
+static inline qv_t qv_xor(const qv_t a, const qv_t b)  { return _mm_xor_si128(a, b); }
+static inline qv_t qv_wadd(const qv_t a, const qv_t b) { return _mm_add_epi32(a, b); } /* wrapping add */
+static inline qv_t qv_wsub(const qv_t a, const qv_t b) { return _mm_sub_epi32(a, b); } /* wrapping subtract */
+static inline qv_t qv_sra(const qv_t a, const unsigned p) { return _mm_sra_epi32(a, _mm_cvtsi32_si128(p)); }
+static inline qv_t qv_sign(const qv_t a) { return _mm_srai_epi32(a, 31); } /* -1 if negative, 0 otherwise */
+static inline qv_t qv_min(const qv_t a, const qv_t b) { return _mm_min_epi32(a, b); }
+static inline qv_t qv_max(const qv_t a, const qv_t b) { return _mm_max_epi32(a, b); }
+static inline qv_t qv_and(const qv_t a, const qv_t b) { return _mm_and_si128(a, b); }
+static inline qv_t qv_wmul(const qv_t a, const qv_t b) { return _mm_mullo_epi32(a, b); } /* lower 32-bits of product */
+static inline qv_t qv_sll(const qv_t a, const unsigned p) { return _mm_sll_epi32(a, _mm_cvtsi32_si128(p)); }
+static inline qv_t qv_select(const qv_t m, const qv_t a, const qv_t b) { return _mm_blendv_epi8(b, a, m); } /* m ? a : b */
+
+#define QV_COMPLEX (1) /* has 'qv_cmul' and 'qv_rot' for interleaved complex numbers */
+
+static inline qv_t qv_cmul(const qv_t a, const qv_t w) { /* rounded complex multiply, as 'fft_cmul' */
+	const qv_t ao = _mm_srli_epi64(a, 32), wo = _mm_srli_epi64(w, 32), round = _mm_set1_epi64x(QHIGH);
+	const qv_t re = _mm_add_epi64(_mm_sub_epi64(_mm_mul_epi32(a, w), _mm_mul_epi32(ao, wo)), round);
+	const qv_t im = _mm_add_epi64(_mm_add_epi64(_mm_mul_epi32(a, wo), _mm_mul_epi32(ao, w)), round);
+	return _mm_blend_epi16(_mm_srli_epi64(re, QBITS), _mm_slli_epi64(im, 32 - QBITS), 0xCC);
+}
+
+static inline qv_t qv_rot(const qv_t t) { /* -i * t */
+	return _mm_sign_epi32(_mm_shuffle_epi32(t, 0xB1), _mm_set_epi32(-1, 1, -1, 1));
+}
+
+static inline qv_t qv_saturation(const qv_t a) { /* saturation value given sign of 'a' */
+	return _mm_xor_si128(_mm_srai_epi32(a, 31), _mm_set1_epi32(DMAX));
+}
+
+static inline qv_t qv_add(const qv_t a, const qv_t b) {
+	const qv_t r = _mm_add_epi32(a, b);
+	const qv_t o = _mm_and_si128(_mm_xor_si128(a, r), _mm_xor_si128(b, r));
+	return _mm_blendv_epi8(r, qv_saturation(a), _mm_srai_epi32(o, 31));
+}
+
+static inline qv_t qv_sub(const qv_t a, const qv_t b) {
+	const qv_t r = _mm_sub_epi32(a, b);
+	const qv_t o = _mm_and_si128(_mm_xor_si128(a, b), _mm_xor_si128(a, r));
+	return _mm_blendv_epi8(r, qv_saturation(a), _mm_srai_epi32(o, 31));
+}
+
+static inline qv_t qv_widen(const qv_t v) { /* sign extend even 32-bit elements to 64-bits */
+	return _mm_blend_epi16(v, _mm_srai_epi32(_mm_slli_epi64(v, 32), 31), 0xCC);
+}
+
+static inline qv_t qv_mla(const qv_t a, const qv_t b, const qv_t ce, const qv_t co) {
+	const qv_t pe = _mm_add_epi64(_mm_mul_epi32(a, b), ce);
+	const qv_t po = _mm_add_epi64(_mm_mul_epi32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32)), co);
+	const qv_t lo = _mm_blend_epi16(_mm_srli_epi64(pe, QBITS), _mm_slli_epi64(po, QBITS), 0xCC);
+	const qv_t hi = _mm_blend_epi16(_mm_srli_epi64(pe, 32), po, 0xCC);
+	const qv_t ok = _mm_cmpeq_epi32(_mm_srai_epi32(hi, 15), _mm_srai_epi32(hi, 31));
+	return _mm_blendv_epi8(qv_saturation(hi), lo, ok);
+}
+
+static inline qv_t qv_mul(const qv_t a, const qv_t b) {
+	const qv_t round = _mm_set1_epi64x(QHIGH);
+	return qv_mla(a, b, round, round);
+}
+
+static inline qv_t qv_fma(const qv_t a, const qv_t b, const qv_t c) {
+	const qv_t round = _mm_set1_epi64x(QHIGH);
+	const qv_t ce = _mm_add_epi64(_mm_slli_epi64(qv_widen(c), QBITS), round);
+	const qv_t co = _mm_add_epi64(_mm_slli_epi64(qv_widen(_mm_srli_epi64(c, 32)), QBITS), round);
+	return qv_mla(a, b, ce, co);
+}
+
+typedef struct { qv_t se, so, he, ho; } qv_acc_t; /* see 'matrix_strip' */
+
+static inline void qv_acc_zero(qv_acc_t *c) { c->se = c->so = c->he = c->ho = _mm_setzero_si128(); }
+
+static inline void qv_acc_mac(qv_acc_t *c, const qv_t a, const qv_t b) {
+	const qv_t pe = _mm_mul_epi32(a, b);
+	const qv_t po = _mm_mul_epi32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+	c->se = _mm_add_epi64(c->se, pe);
+	c->so = _mm_add_epi64(c->so, po);
+	c->he = _mm_add_epi64(c->he, qv_widen(_mm_srli_epi64(pe, 32)));
+	c->ho = _mm_add_epi64(c->ho, qv_widen(_mm_srli_epi64(po, 32)));
+}
+
+static inline void qv_acc_store(const qv_acc_t *c, lu_t *s, ld_t *h) {
+	lu_t se[2], so[2];
+	ld_t he[2], ho[2];
+	_mm_storeu_si128((__m128i*)se, c->se);
+	_mm_storeu_si128((__m128i*)so, c->so);
+	_mm_storeu_si128((__m128i*)he, c->he);
+	_mm_storeu_si128((__m128i*)ho, c->ho);
+	for (size_t i = 0; i < 2; i++) {
+		s[2*i] = se[i], s[2*i + 1] = so[i];
+		h[2*i] = he[i], h[2*i + 1] = ho[i];
+	}
+}
+#elif defined(Q_SIMD_NEON)
+typedef int32x4_t qv_t;
+#define QV_LANES (4)
+
+static inline qv_t qv_load(const q_t *p)   { return vld1q_s32(p); }
+static inline void qv_store(q_t *p, qv_t v) { vst1q_s32(p, v); }
+static inline qv_t qv_dup(const q_t s)     { return vdupq_n_s32(s); }
+static inline qv_t qv_add(const qv_t a, const qv_t b) { return vqaddq_s32(a, b); }
+static inline qv_t qv_sub(const qv_t a, const qv_t b) { return vqsubq_s32(a, b); }
+static inline qv_t qv_xor(const qv_t a, const qv_t b)  { return veorq_s32(a, b); }
+static inline qv_t qv_wadd(const qv_t a, const qv_t b) { return vaddq_s32(a, b); } /* wrapping add */
+static inline qv_t qv_wsub(const qv_t a, const qv_t b) { return vsubq_s32(a, b); } /* wrapping subtract */
+static inline qv_t qv_sra(const qv_t a, const unsigned p) { return vshlq_s32(a, vdupq_n_s32(-(int32_t)p)); }
+static inline qv_t qv_sign(const qv_t a) { return vshrq_n_s32(a, 31); } /* -1 if negative, 0 otherwise */
+static inline qv_t qv_min(const qv_t a, const qv_t b) { return vminq_s32(a, b); }
+static inline qv_t qv_max(const qv_t a, const qv_t b) { return vmaxq_s32(a, b); }
+static inline qv_t qv_and(const qv_t a, const qv_t b) { return vandq_s32(a, b); }
+static inline qv_t qv_wmul(const qv_t a, const qv_t b) { return vmulq_s32(a, b); } /* lower 32-bits of product */
+static inline qv_t qv_sll(const qv_t a, const unsigned p) { return vshlq_s32(a, vdupq_n_s32((int32_t)p)); }
+static inline qv_t qv_select(const qv_t m, const qv_t a, const qv_t b) { return vbslq_s32(vreinterpretq_u32_s32(m), a, b); } /* m ? a : b */
+
+static inline int32x2_t qv_half_fma(const int32x2_t a, const int32x2_t b, const int32x2_t c) {
+	const int64x2_t dd = vaddq_s64(vmull_s32(a, b), vdupq_n_s64(QHIGH));
+	return vqmovn_s64(vaddw_s32(vshrq_n_s64(dd, QBITS), c));
+}
+
+static inline qv_t qv_fma(const qv_t a, const qv_t b, const qv_t c) {
+	const int32x2_t lo = qv_half_fma(vget_low_s32(a),  vget_low_s32(b),  vget_low_s32(c));
+	const int32x2_t hi = qv_half_fma(vget_high_s32(a), vget_high_s32(b), vget_high_s32(c));
+	return vcombine_s32(lo, hi);
+}
+
+static inline qv_t qv_mul(const qv_t a, const qv_t b) { return qv_fma(a, b, vdupq_n_s32(0)); }
+
+typedef struct { int64x2_t s0, s1, h0, h1; } qv_acc_t; /* see 'matrix_strip' */
+
+static inline void qv_acc_zero(qv_acc_t *c) { c->s0 = c->s1 = c->h0 = c->h1 = vdupq_n_s64(0); }
+
+static inline void qv_acc_mac(qv_acc_t *c, const qv_t a, const qv_t b) {
+	const int64x2_t p0 = vmull_s32(vget_low_s32(a), vget_low_s32(b));
+	const int64x2_t p1 = vmull_s32(vget_high_s32(a), vget_high_s32(b));
+	c->s0 = vaddq_s64(c->s0, p0);
+	c->s1 = vaddq_s64(c->s1, p1);
+	c->h0 = vaddq_s64(c->h0, vshrq_n_s64(p0, 32));
+	c->h1 = vaddq_s64(c->h1, vshrq_n_s64(p1, 32));
+}
+
+static inline void qv_acc_store(const qv_acc_t *c, lu_t *s, ld_t *h) {
+	vst1q_s64((int64_t*)&s[0], c->s0);
+	vst1q_s64((int64_t*)&s[2], c->s1);
+	vst1q_s64(&h[0], c->h0);
+	vst1q_s64(&h[2], c->h1);
+}
+#endif
+
+#ifdef QV_LANES
+static inline int qv_usable(void) { return (active ? active : &qconf)->bound == qbound_saturate; }
+#endif
+
+void qadd_n(q_t *r, const q_t *a, const q_t *b, const size_t n) {
+	assert(r);
+	assert(a);
+	assert(b);
+	size_t i = 0;
+#ifdef QV_LANES
+	if (qv_usable())
+		for (; (i + QV_LANES) <= n; i += QV_LANES)
+			qv_store(&r[i], qv_add(qv_load(&a[i]), qv_load(&b[i])));
+#endif
+	for (; i < n; i++)
+		r[i] = qadd(a[i], b[i]);
+}
+
+void qsub_n(q_t *r, const q_t *a, const q_t *b, const size_t n) {
+	assert(r);
+	assert(a);
+	assert(b);
+	size_t i = 0;
+#ifdef QV_LANES
+	if (qv_usable())
+		for (; (i + QV_LANES) <= n; i += QV_LANES)
+			qv_store(&r[i], qv_sub(qv_load(&a[i]), qv_load(&b[i])));
+#endif
+	for (; i < n; i++)
+		r[i] = qsub(a[i], b[i]);
+}
+
+void qmul_n(q_t *r, const q_t *a, const q_t *b, const size_t n) {
+	assert(r);
+	assert(a);
+	assert(b);
+	size_t i = 0;
+#ifdef QV_LANES
+	if (qv_usable())
+		for (; (i + QV_LANES) <= n; i += QV_LANES)
+			qv_store(&r[i], qv_mul(qv_load(&a[i]), qv_load(&b[i])));
+#endif
+	for (; i < n; i++)
+		r[i] = qmul(a[i], b[i]);
+}
+
+void qfma_n(q_t *r, const q_t *a, const q_t *b, const q_t *c, const size_t n) {
+	assert(r);
+	assert(a);
+	assert(b);
+	assert(c);
+	size_t i = 0;
+#ifdef QV_LANES
+	if (qv_usable())
+		for (; (i + QV_LANES) <= n; i += QV_LANES)
+			qv_store(&r[i], qv_fma(qv_load(&a[i]), qv_load(&b[i]), qv_load(&c[i])));
+#endif
+	for (; i < n; i++)
+		r[i] = qfma(a[i], b[i], c[i]);
+}
+
+void qadd_scalar_n(q_t *r, const q_t *a, const q_t s, const size_t n) {
+	assert(r);
+	assert(a);
+	size_t i = 0;
+#ifdef QV_LANES
+	if (qv_usable()) {
+		const qv_t vs = qv_dup(s);
+		for (; (i + QV_LANES) <= n; i += QV_LANES)
+			qv_store(&r[i], qv_add(qv_load(&a[i]), vs));
+	}
+#endif
+	for (; i < n; i++)
+		r[i] = qadd(a[i], s);
+}
+
+void qsub_scalar_n(q_t *r, const q_t *a, const q_t s, const size_t n) {
+	assert(r);
+	assert(a);
+	size_t i = 0;
+#ifdef QV_LANES
+	if (qv_usable()) {
+		const qv_t vs = qv_dup(s);
+		for (; (i + QV_LANES) <= n; i += QV_LANES)
+			qv_store(&r[i], qv_sub(qv_load(&a[i]), vs));
+	}
+#endif
+	for (; i < n; i++)
+		r[i] = qsub(a[i], s);
+}
+
+void qmul_scalar_n(q_t *r, const q_t *a, const q_t s, const size_t n) {
+	assert(r);
+	assert(a);
+	size_t i = 0;
+#ifdef QV_LANES
+	if (qv_usable()) {
+		const qv_t vs = qv_dup(s);
+		for (; (i + QV_LANES) <= n; i += QV_LANES)
+			qv_store(&r[i], qv_mul(qv_load(&a[i]), vs));
+	}
+#endif
+	for (; i < n; i++)
+		r[i] = qmul(a[i], s);
+}
+
+void qfma_scalar_n(q_t *r, const q_t *a, const q_t s, const q_t *c, const size_t n) {
+	assert(r);
+	assert(a);
+	assert(c);
+	size_t i = 0;
+#ifdef QV_LANES
+	if (qv_usable()) {
+		const qv_t vs = qv_dup(s);
+		for (; (i + QV_LANES) <= n; i += QV_LANES)
+			qv_store(&r[i], qv_fma(qv_load(&a[i]), vs, qv_load(&c[i])));
+	}
+#endif
+	for (; i < n; i++)
+		r[i] = qfma(a[i], s, c[i]);
+}
+
+/* Sums of double width products are accumulated exactly, then rounded and
+ * saturated once. Each product is added to a 64-bit sum 's', which may wrap,
+ * and its upper 32-bits to a second sum 'h'. The exact sum of 'n' products
+ * lies in '[h, h + n) * 2^32', so if 'h' is near zero 's' has not lost
+ * anything, otherwise the result is out of range and 'h' is enough to
+ * saturate it. The SIMD accumulators ('qv_acc_t') keep the same pair of
+ * sums per lane, and the lanes can be added together afterwards. */
+static inline void wide_add(lu_t *s, ld_t *h, const ld_t p) {
+	assert(s);
+	assert(h);
+	*s += (lu_t)p;
+	*h += (d_t)(u_t)((lu_t)p >> 32);
+}
+
+static q_t wide_result(const lu_t s, const ld_t h, const size_t n) {
+	const ld_t limit = (ld_t)1 << (QBITS - 1);
+	if (h >= limit || h < -limit - (ld_t)n) {
+		const ld_t c = MAX(MIN(h, (ld_t)DMAX), (ld_t)DMIN);
+		return qsat(QSTAT_SUM, c * ((ld_t)1 << QBITS));
+	}
+	return qsat(QSTAT_SUM, ldivn((ld_t)s + QHIGH, QBITS));
+}
+
+/* 'qacc_t' is the public form of the accumulator, the partial sums of a
+ * long vector can be computed separately (by different threads, perhaps)
+ * and merged, the result is the same as if it had been done in one go. */
+void qacc_dot(qacc_t *acc, const q_t *a, const q_t *b, const size_t n) {
+	assert(acc);
+	assert(a);
+	assert(b);
+	lu_t s = acc->s;
+	ld_t h = acc->h;
+	size_t i = 0;
+#ifdef QV_LANES
+	if (n >= QV_LANES) {
+		lu_t vs[QV_LANES];
+		ld_t vh[QV_LANES];
+		qv_acc_t c;
+		qv_acc_zero(&c);
+		for (; (i + QV_LANES) <= n; i += QV_LANES)
+			qv_acc_mac(&c, qv_load(&a[i]), qv_load(&b[i]));
+		qv_acc_store(&c, vs, vh);
+		for (size_t j = 0; j < QV_LANES; j++)
+			s += vs[j], h += vh[j];
+	}
+#endif
+	for (; i < n; i++)
+		wide_add(&s, &h, (ld_t)a[i] * b[i]);
+	acc->s = s;
+	acc->h = h;
+	acc->n += n;
+}
+
+void qacc_sum(qacc_t *acc, const q_t *a, const size_t n) { /* each element is multiplied by one */
+	assert(acc);
+	assert(a);
+	lu_t s = acc->s;
+	ld_t h = acc->h;
+	size_t i = 0;
+#ifdef QV_LANES
+	if (n >= QV_LANES) {
+		lu_t vs[QV_LANES];
+		ld_t vh[QV_LANES];
+		const qv_t one = qv_dup(QINT(1));
+		qv_acc_t c;
+		qv_acc_zero(&c);
+		for (; (i + QV_LANES) <= n; i += QV_LANES)
+			qv_acc_mac(&c, qv_load(&a[i]), one);
+		qv_acc_store(&c, vs, vh);
+		for (size_t j = 0; j < QV_LANES; j++)
+			s += vs[j], h += vh[j];
+	}
+#endif
+	for (; i < n; i++)
+		wide_add(&s, &h, (ld_t)a[i] * QINT(1));
+	acc->s = s;
+	acc->h = h;
+	acc->n += n;
+}
+
+void qacc_merge(qacc_t *acc, const qacc_t *other) {
+	assert(acc);
+	assert(other);
+	acc->s += other->s;
+	acc->h += other->h;
+	acc->n += other->n;
+}
+
+q_t qacc_result(const qacc_t *acc) {
+	assert(acc);
+	return wide_result(acc->s, acc->h, acc->n);
+}
+
+static q_t wide_dot(const q_t *a, const q_t *b, const size_t n) {
+	qacc_t acc = { 0, 0, 0, };
+	qacc_dot(&acc, a, b, n);
+	return qacc_result(&acc);
+}
+
+q_t qdot(const q_t *a, const q_t *b, const size_t n) { return wide_dot(a, b, n); }
+q_t qsumsq(const q_t *a, const size_t n)             { return wide_dot(a, a, n); }
+
+q_t qsum(const q_t *a, const size_t n) {
+	qacc_t acc = { 0, 0, 0, };
+	qacc_sum(&acc, a, n);
+	return qacc_result(&acc);
+}
+
+void qaxpy(q_t *y, const q_t alpha, const q_t *x, const size_t n) {
+	qfma_scalar_n(y, x, alpha, y, n);
+}
+
+/* The extreme value is found first, which can use SIMD, and then the first
+ * index holding it; an empty array gives an index of zero. */
+static q_t extreme_n(const q_t *a, const size_t n, const int maximum) {
+	assert(a);
+	assert(n);
+	q_t r = a[0];
+	size_t i = 0;
+#ifdef QV_LANES
+	if (n >= QV_LANES) {
+		q_t v[QV_LANES];
+		qv_t m = qv_load(&a[0]);
+		for (i = QV_LANES; (i + QV_LANES) <= n; i += QV_LANES)
+			m = maximum ? qv_max(m, qv_load(&a[i])) : qv_min(m, qv_load(&a[i]));
+		qv_store(v, m);
+		for (size_t j = 0; j < QV_LANES; j++)
+			r = maximum ? qmax(r, v[j]) : qmin(r, v[j]);
+	}
+#endif
+	for (; i < n; i++)
+		r = maximum ? qmax(r, a[i]) : qmin(r, a[i]);
+	return r;
+}
+
+static size_t extreme_index(const q_t *a, const size_t n, const int maximum) {
+	assert(a);
+	if (!n)
+		return 0;
+	const q_t e = extreme_n(a, n, maximum);
+	size_t i = 0;
+	while (a[i] != e)
+		i++;
+	return i;
+}
+
+size_t qargmin(const q_t *a, const size_t n) { return extreme_index(a, n, 0); }
+size_t qargmax(const q_t *a, const size_t n) { return extreme_index(a, n, 1); }
+
 static char itoch(const unsigned ch) {
 	assert(ch < 36);
 	if (ch <= 9)
@@ -357,12 +1152,22 @@ int qsprintbdp(q_t p, char *s, size_t length, const u_t base, const d_t idp) {
 	return i + hisz;
 }
 
+int qsprintb_ctx(const qctx_t *c, q_t p, char *s, size_t length, const u_t base) {
+	assert(c);
+	return qsprintbdp(p, s, length, base, c->dp);
+}
+
+int qsprint_ctx(const qctx_t *c, const q_t p, char *s, const size_t length) {
+	assert(c);
+	return qsprintb_ctx(c, p, s, length, c->base);
+}
+
 int qsprintb(q_t p, char *s, size_t length, const u_t base) {
-	return qsprintbdp(p, s, length, base, qconf.dp);
+	return qsprintb_ctx(&qconf, p, s, length, base);
 }
 
 int qsprint(const q_t p, char *s, const size_t length) {
-	return qsprintb(p, s, length, qconf.base); 
+	return qsprint_ctx(&qconf, p, s, length);
 }
 
 static inline int extract(unsigned char c, const int radix) {
@@ -458,22 +1263,276 @@ done:
 	return 0;
 }
 
-int qnconvb(q_t *q, const char *s, size_t length, const d_t base) {
-	return qnconvbdp(q, s, length, base, qconf.dp);
+int qnconvb_ctx(const qctx_t *c, q_t *q, const char *s, size_t length, const d_t base) {
+	assert(c);
+	return qnconvbdp(q, s, length, base, c->dp);
 }
 
-int qnconv(q_t *q, const char *s, size_t length) {
-	return qnconvb(q, s, length, qconf.base);
+int qnconv_ctx(const qctx_t *c, q_t *q, const char *s, size_t length) {
+	assert(c);
+	return qnconvb_ctx(c, q, s, length, c->base);
 }
 
-int qconv(q_t *q, const char * const s) {
+int qconv_ctx(const qctx_t *c, q_t *q, const char * const s) {
 	assert(s);
-	return qnconv(q, s, strlen(s));
+	return qnconv_ctx(c, q, s, strlen(s));
+}
+
+int qconvb_ctx(const qctx_t *c, q_t *q, const char * const s, const d_t base) {
+	assert(s);
+	return qnconvb_ctx(c, q, s, strlen(s), base);
+}
+
+int qnconvb(q_t *q, const char *s, size_t length, const d_t base) {
+	return qnconvb_ctx(&qconf, q, s, length, base);
+}
+
+int qnconv(q_t *q, const char *s, size_t length) {
+	return qnconv_ctx(&qconf, q, s, length);
+}
+
+int qconv(q_t *q, const char * const s) {
+	return qconv_ctx(&qconf, q, s);
 }
 
 int qconvb(q_t *q, const char * const s, const d_t base) {
+	return qconvb_ctx(&qconf, q, s, base);
+}
+
+/* Bulk conversion of many numbers, for reading and writing large data
+ * sets as text. Numbers are separated by runs of white space or commas,
+ * and the input can be given to 'qparse' in chunks of any size; a number
+ * split over the end of a chunk is kept in the parser state and finished
+ * with the next. Everything else converts straight from the input. In base
+ * ten the digits are converted four at a time within a 32-bit word (if
+ * the machine is little endian), the output is the same as 'qnconvbdp'
+ * except that integer parts out of range saturate correctly. */
+
+static inline int separator(const unsigned char ch) {
+	return ch == ' ' || ch == ',' || (ch >= '\t' && ch <= '\r');
+}
+
+static inline int digits4(const char *s, u_t *value) { /* four decimal digits at once, SWAR */
+	assert(s);
+	assert(value);
+	u_t v = 0;
+	memcpy(&v, s, sizeof (v));
+	if ((v & 0xF0F0F0F0ul) != 0x30303030ul || ((v + 0x06060606ul) & 0xF0F0F0F0ul) != 0x30303030ul)
+		return 0;
+	v -= 0x30303030ul;
+	v = ((v * 10) + (v >> 8)) & 0x00FF00FFul;
+	v = ((v * 100) + (v >> 16)) & 0xFFFFul;
+	*value = v;
+	return 1;
+}
+
+/* Converts a base ten number ending at a separator or at 'length', the
+ * number of characters converted is put in 'end' */
+static int decimal(q_t *q, const char *s, const size_t length, const u_t idp, size_t *end) {
+	assert(q);
+	assert(s);
+	assert(end);
+	*q = QINT(0);
+	*end = 0;
+	if (length < 1)
+		return -1;
+	const int swar = little_endian();
+	size_t i = 0;
+	u_t hi = 0, lo = 0, places = 1, value = 0;
+	const int negative = s[0] == '-';
+	if (negative && (length < 2 || separator(s[1])))
+		return -1;
+	i += negative;
+	for (; swar && (i + 4) <= length && hi <= MULTIPLIER && digits4(&s[i], &value); i += 4)
+		hi = (hi * 10000) + value;
+	for (; i < length && (u_t)(s[i] - '0') < 10; i++)
+		if (hi <= MULTIPLIER)
+			hi = (hi * 10) + (s[i] - '0');
+	if (i < length && !separator(s[i])) {
+		if (s[i] != '.')
+			return -2;
+		i++;
+		const u_t max = MIN(idp, 4u); /* 'integer_logarithm(0x10000, 10)' */
+		u_t dp = 0;
+		if (swar && max == 4 && (i + 4) <= length && digits4(&s[i], &value)) {
+			lo = value, places = 10000, dp = 4;
+			i += 4;
+		}
+		for (; i < length && !separator(s[i]); i++, dp++) {
+			if ((u_t)(s[i] - '0') >= 10)
+				return -3;
+			if (dp < max) {
+				lo = (lo * 10) + (s[i] - '0');
+				places *= 10;
+			}
+		}
+		lo = places == 10000 ? (lo << QBITS) / 10000 : (lo << QBITS) / places; /* constant division is cheaper */
+	}
+	const ld_t magnitude = ((ld_t)hi << QBITS) | lo;
+	*q = qsat(QSTAT_CONVERT, negative ? -magnitude : magnitude);
+	*end = i;
+	return 0;
+}
+
+static int parse_token(qparse_t *p, q_t *q, const char *s, const size_t length) {
+	assert(p);
+	assert(q);
+	assert(s);
+	int r = 0;
+	size_t end = 0;
+	if (p->base == 10)
+		r = decimal(q, s, length, p->dp, &end);
+	else if ((r = qnconvbdp(q, s, length, p->base, p->dp)) == -6)
+		r = 0; /* saturated */
+	if (r < 0)
+		p->error = r;
+	return r;
+}
+
+void qparse_init(qparse_t *p, const d_t base, const u_t dp) {
+	assert(p);
+	assert(base >= 2 && base <= 36);
+	memset(p, 0, sizeof (*p));
+	p->base = base;
+	p->dp = dp;
+}
+
+int qparse(qparse_t *p, const char *s, const size_t length, q_t *q, size_t n, size_t *used) {
+	assert(p);
+	assert(s);
+	assert(q);
+	assert(used);
+	*used = 0;
+	if (p->error)
+		return p->error;
+	if (!n)
+		return 0;
+	n = MIN(n, (size_t)INT_MAX);
+	size_t i = 0, stored = 0;
+	if (p->length) { /* finish off the number from the last chunk */
+		for (; i < length && !separator(s[i]); i++) {
+			if (p->length >= sizeof (p->token))
+				return p->error = -7;
+			p->token[p->length++] = s[i];
+		}
+		if (i == length) {
+			*used = i;
+			return 0;
+		}
+		const int r = parse_token(p, &q[stored++], p->token, p->length);
+		p->length = 0;
+		if (r < 0)
+			return r;
+	}
+	while (stored < n) {
+		while (i < length && separator(s[i]))
+			i++;
+		if (i == length)
+			break;
+		const size_t start = i;
+		int r = 0;
+		if (p->base == 10) { /* scans and converts in one go */
+			size_t end = 0;
+			r = decimal(&q[stored], &s[start], length - start, p->dp, &end);
+			i += end;
+		}
+		if (p->base != 10 || r < 0 || i == length) {
+			for (i = start; i < length && !separator(s[i]);)
+				i++;
+			if (i == length) { /* may continue in the next chunk */
+				if ((i - start) > sizeof (p->token))
+					return p->error = -7;
+				memcpy(p->token, &s[start], i - start);
+				p->length = i - start;
+				break;
+			}
+			if (p->base != 10 || r < 0)
+				r = parse_token(p, &q[stored], &s[start], i - start);
+		}
+		if (r < 0)
+			return r;
+		stored++;
+	}
+	*used = i;
+	return stored;
+}
+
+int qparse_end(qparse_t *p, q_t *q) {
+	assert(p);
+	assert(q);
+	if (p->error)
+		return p->error;
+	if (!p->length)
+		return 0;
+	const int r = parse_token(p, q, p->token, p->length);
+	p->length = 0;
+	return r < 0 ? r : 1;
+}
+
+static const char digit_pairs[] =
+	"00010203040506070809101112131415161718192021222324"
+	"25262728293031323334353637383940414243444546474849"
+	"50515253545556575859606162636465666768697071727374"
+	"75767778798081828384858687888990919293949596979899";
+
+/* Writes the same characters as 'qsprintbdp' in base ten, 's' must have room
+ * for 'QBITS + 8' characters; returns the number written */
+static size_t format_decimal(char *s, const q_t p, const d_t idp) {
+	assert(s);
+	const int negative = qisnegative(p);
+	const u_t magnitude = negative ? -(u_t)p : (u_t)p;
+	u_t hi = magnitude >> QBITS, lo = magnitude & QMASK;
+	size_t i = 0;
+	if (negative)
+		s[i++] = '-';
+	const size_t digits = hi < 10 ? 1 : hi < 100 ? 2 : hi < 1000 ? 3 : hi < 10000 ? 4 : 5;
+	size_t j = i + digits;
+	for (; hi >= 10; hi /= 100) {
+		j -= 2;
+		memcpy(&s[j], &digit_pairs[(hi % 100) * 2], 2);
+	}
+	if (j > i)
+		s[i] = '0' + hi;
+	i += digits;
+	s[i++] = '.';
+	for (d_t dp = 0; lo && (idp < 0 || dp < idp);) {
+		if (idp >= 0 && (idp - dp) == 1) {
+			lo *= 10;
+			s[i++] = '0' + (lo >> QBITS);
+			break;
+		}
+		lo *= 100;
+		const u_t pair = lo >> QBITS;
+		lo &= QMASK;
+		memcpy(&s[i], &digit_pairs[pair * 2], 2);
+		/* a zero second digit with nothing left over means the fraction
+		 * ended on the first digit, where 'qsprintbdp' stops */
+		i += 2 - (!lo && !(pair % 10));
+		dp += 2;
+	}
+	return i;
+}
+
+size_t qsprint_n(char *s, const size_t length, const q_t *q, const size_t n, const d_t dp, const char separator, size_t *used) {
 	assert(s);
-	return qnconvb(q, s, strlen(s), base);
+	assert(q);
+	assert(used);
+	char scratch[QBITS + 8];
+	size_t i = 0, j = 0;
+	for (; j < n; j++) {
+		if ((length - i) >= (sizeof (scratch) + 1)) {
+			i += format_decimal(&s[i], q[j], dp);
+		} else { /* close to the end of the buffer */
+			const size_t l = format_decimal(scratch, q[j], dp);
+			if ((l + 1) > (length - i))
+				break;
+			memcpy(&s[i], scratch, l);
+			i += l;
+		}
+		s[i++] = separator;
+	}
+	*used = i;
+	return j;
 }
 
 typedef enum {
@@ -488,7 +1547,81 @@ typedef enum {
 } cordic_coordinates_e;
 
 static const d_t cordic_circular_inverse_scaling   = 0x9B74; /* 1/scaling-factor */
-static const d_t cordic_hyperbolic_inverse_scaling = 0x13520; /* 1/scaling-factor */
+static const d_t cordic_hyperbolic_inverse_scaling = 0x1351F; /* 1/scaling-factor */
+
+/* The CORDIC tables are X-Macros, 'X(SHIFT, ANGLE)' is expanded for each
+ * iteration and 'R(SHIFT, ANGLE)' for each repeated iteration (hyperbolic
+ * iterations 4, 13, 40, ... must be repeated for the method to converge).
+ * They are used to make the tables for 'cordic' and to generate the unrolled
+ * kernels for each coordinate system and mode, see 'CORDIC_KERNEL'. */
+#define CORDIC_ARCTANS(X, R) /* atan(2^0), atan(2^-1), atan(2^-2), ... */\
+	X( 0, 0xC90FuL) X( 1, 0x76B1uL) X( 2, 0x3EB6uL) X( 3, 0x1FD5uL)\
+	X( 4, 0x0FFAuL) X( 5, 0x07FFuL) X( 6, 0x03FFuL) X( 7, 0x01FFuL)\
+	X( 8, 0x00FFuL) X( 9, 0x007FuL) X(10, 0x003FuL) X(11, 0x001FuL)\
+	X(12, 0x000FuL) X(13, 0x0007uL) X(14, 0x0003uL) X(15, 0x0001uL)\
+	X(16, 0x0000uL)
+
+#define CORDIC_ARCTANHS(X, R) /* atanh(2^-1), atanh(2^-2), ..., rounded to nearest */\
+	X( 1, 0x8c9fuL) X( 2, 0x4163uL) X( 3, 0x202buL) X( 4, 0x1005uL) R( 4, 0x1005uL)\
+	X( 5, 0x0801uL) X( 6, 0x0400uL) X( 7, 0x0200uL) X( 8, 0x0100uL)\
+	X( 9, 0x0080uL) X(10, 0x0040uL) X(11, 0x0020uL) X(12, 0x0010uL)\
+	X(13, 0x0008uL) R(13, 0x0008uL) X(14, 0x0004uL) X(15, 0x0002uL) X(16, 0x0001uL)\
+	X(17, 0x0001uL)
+
+#define CORDIC_HALFS(X, R) /* 2^0, 2^-1, 2^-2, ..*/\
+	X( 0, 0x10000uL)\
+	X( 1, 0x8000uL) X( 2, 0x4000uL) X( 3, 0x2000uL) X( 4, 0x1000uL)\
+	X( 5, 0x0800uL) X( 6, 0x0400uL) X( 7, 0x0200uL) X( 8, 0x0100uL)\
+	X( 9, 0x0080uL) X(10, 0x0040uL) X(11, 0x0020uL) X(12, 0x0010uL)\
+	X(13, 0x0008uL) X(14, 0x0004uL) X(15, 0x0002uL) X(16, 0x0001uL)
+
+#define CORDIC_ENTRY(SHIFT, ANGLE) ANGLE,
+#define CORDIC_NONE(SHIFT, ANGLE)
+
+static const u_t cordic_arctans[]  = { CORDIC_ARCTANS(CORDIC_ENTRY, CORDIC_NONE) };
+static const u_t cordic_arctanhs[] = { CORDIC_ARCTANHS(CORDIC_ENTRY, CORDIC_NONE) };
+static const u_t cordic_halfs[]    = { CORDIC_HALFS(CORDIC_ENTRY, CORDIC_NONE) };
+
+/* A single CORDIC iteration, see 'cordic' for an explanation of the terms,
+ * 'XOP' is '-=' for circular and linear and '+=' for hyperbolic coordinates */
+#define CORDIC_STEP(M, XS, YS, ANGLE, XOP) {\
+	const d_t  d = -!!((M) < 0);\
+	const d_t xs = ((XS) ^ d) - d;\
+	const d_t ys = ((YS) ^ d) - d;\
+	const d_t zs = (((u_t)(ANGLE)) ^ d) - d;\
+	x XOP xs;\
+	y += ys;\
+	z -= zs;\
+}
+
+#define CORDIC_CIRCULAR_ROTATE(SHIFT, ANGLE)   CORDIC_STEP( z, divn(y, SHIFT), divn(x, SHIFT), ANGLE, -=)
+#define CORDIC_CIRCULAR_VECTOR(SHIFT, ANGLE)   CORDIC_STEP(-y, divn(y, SHIFT), divn(x, SHIFT), ANGLE, -=)
+#define CORDIC_HYPERBOLIC_ROTATE(SHIFT, ANGLE) CORDIC_STEP( z, divn(y, SHIFT), divn(x, SHIFT), ANGLE, +=)
+#define CORDIC_HYPERBOLIC_VECTOR(SHIFT, ANGLE) CORDIC_STEP(-y, divn(y, SHIFT), divn(x, SHIFT), ANGLE, +=)
+#define CORDIC_LINEAR_ROTATE(SHIFT, ANGLE)     CORDIC_STEP( z, 0,              divn(x, SHIFT), ANGLE, -=)
+#define CORDIC_LINEAR_VECTOR(SHIFT, ANGLE)     CORDIC_STEP(-y, 0,              divn(x, SHIFT), ANGLE, -=)
+
+/* Generate a straight line CORDIC kernel, all shifts and angles are
+ * constants, these give the same results as 'cordic' with the default
+ * number of iterations and take the same time to run for any input. */
+#define CORDIC_KERNEL(NAME, TABLE, STEP)\
+	static inline void NAME(d_t *x0, d_t *y0, d_t *z0) {\
+		assert(x0);\
+		assert(y0);\
+		assert(z0);\
+		d_t x = *x0, y = *y0, z = *z0;\
+		TABLE(STEP, STEP)\
+		*x0 = x;\
+		*y0 = y;\
+		*z0 = z;\
+	}
+
+CORDIC_KERNEL(cordic_circular_rotate,   CORDIC_ARCTANS,  CORDIC_CIRCULAR_ROTATE)
+CORDIC_KERNEL(cordic_circular_vector,   CORDIC_ARCTANS,  CORDIC_CIRCULAR_VECTOR)
+CORDIC_KERNEL(cordic_hyperbolic_rotate, CORDIC_ARCTANHS, CORDIC_HYPERBOLIC_ROTATE)
+CORDIC_KERNEL(cordic_hyperbolic_vector, CORDIC_ARCTANHS, CORDIC_HYPERBOLIC_VECTOR)
+CORDIC_KERNEL(cordic_linear_rotate,     CORDIC_HALFS,    CORDIC_LINEAR_ROTATE)
+CORDIC_KERNEL(cordic_linear_vector,     CORDIC_HALFS,    CORDIC_LINEAR_VECTOR)
 
 static inline int mulsign(d_t a, d_t b) { /* sign(a*b) */
 	const int aneg = a < 0;
@@ -522,33 +1655,9 @@ static int cordic(const cordic_coordinates_e coord, const cordic_mode_e mode, in
 	BUILD_BUG_ON(sizeof(d_t) != sizeof(uint32_t));
 	BUILD_BUG_ON(sizeof(u_t) != sizeof(uint32_t));
 
-	static const u_t arctans[] = { /* atan(2^0), atan(2^-1), atan(2^-2), ... */
-		0xC90FuL, 0x76B1uL, 0x3EB6uL, 0x1FD5uL,
-		0x0FFAuL, 0x07FFuL, 0x03FFuL, 0x01FFuL,
-		0x00FFuL, 0x007FuL, 0x003FuL, 0x001FuL,
-		0x000FuL, 0x0007uL, 0x0003uL, 0x0001uL,
-		0x0000uL, // 0x0000uL,
-	};
-	static const size_t arctans_length = sizeof arctans / sizeof arctans[0];
-
-	static const u_t arctanhs[] = { /* atanh(2^-1), atanh(2^-2), ... */
-		0x8c9fuL, 0x4162uL, 0x202buL, 0x1005uL,
-		0x0800uL, 0x0400uL, 0x0200uL, 0x0100uL,
-		0x0080uL, 0x0040uL, 0x0020uL, 0x0010uL,
-		0x0008uL, 0x0004uL, 0x0002uL, 0x0001uL,
-		0x0000uL, // 0x0000uL,
-	};
-	static const size_t arctanhs_length = sizeof arctanhs / sizeof arctanhs[0];
-
-	static const u_t halfs[] = { /* 2^0, 2^-1, 2^-2, ..*/
-		0x10000uL,
-		0x8000uL, 0x4000uL, 0x2000uL, 0x1000uL,
-		0x0800uL, 0x0400uL, 0x0200uL, 0x0100uL,
-		0x0080uL, 0x0040uL, 0x0020uL, 0x0010uL,
-		0x0008uL, 0x0004uL, 0x0002uL, 0x0001uL,
-		//0x0000uL, // 0x0000uL,
-	};
-	static const size_t halfs_length = sizeof halfs / sizeof halfs[0];
+	static const size_t arctans_length  = sizeof cordic_arctans  / sizeof cordic_arctans[0];
+	static const size_t arctanhs_length = sizeof cordic_arctanhs / sizeof cordic_arctanhs[0];
+	static const size_t halfs_length    = sizeof cordic_halfs    / sizeof cordic_halfs[0];
 
 	const u_t *lookup = NULL;
 	size_t i = 0, j = 0, k = 0, length = 0;
@@ -557,14 +1666,14 @@ static int cordic(const cordic_coordinates_e coord, const cordic_mode_e mode, in
 
 	switch (coord) {
 	case CORDIC_COORD_CIRCULAR_E:
-		lookup = arctans;
+		lookup = cordic_arctans;
 		length = arctans_length;
 		i = 0;
 		shifty = &i;
 		shiftx = &i;
 		break;
 	case CORDIC_COORD_HYPERBOLIC_E:
-		lookup = arctanhs;
+		lookup = cordic_arctanhs;
 		length = arctanhs_length;
 		hyperbolic = 1;
 		i = 1;
@@ -572,7 +1681,7 @@ static int cordic(const cordic_coordinates_e coord, const cordic_mode_e mode, in
 		shiftx = &i;
 		break;
 	case CORDIC_COORD_LINEAR_E:
-		lookup = halfs;
+		lookup = cordic_halfs;
 		length = halfs_length;
 		shifty = &j;
 		shiftx = NULL;
@@ -603,24 +1712,13 @@ static int cordic(const cordic_coordinates_e coord, const cordic_mode_e mode, in
 			y = yn; /*   sine, in circular, rotation mode   */
 			z = zn;
 		}
-		if (hyperbolic) { /* Experimental/Needs bug fixing */
-			switch (1) { // TODO: Correct hyperbolic redo of iteration
-			case 0: break;
-			case 1: if (k++ >= 3) { k = 0; goto again; } break;
-			case 2: {
-				assert(j <= 120);
-				size_t cmp = j + 1;
-				if (cmp == 4 || cmp == 13 /*|| cmp == 40 || cmp == 121 || cmp == floor(pow(3,i-1)/2) */) {
-					if (k) {
-						k = 0;
-					} else {
-						k = 1;
-						goto again;
-					}
-				}
-				break;
-			}
+		if (hyperbolic) { /* repeat iterations 4, 13, 40, ..., once each */
+			const size_t shift = j + 1;
+			if (!k && (shift == 4 || shift == 13 || shift == 40)) {
+				k = 1;
+				goto again;
 			}
+			k = 0;
 		}
 	}
 	*x0 = x;
@@ -632,49 +1730,48 @@ static int cordic(const cordic_coordinates_e coord, const cordic_mode_e mode, in
 
 /* See: - <https://dspguru.com/dsp/faqs/cordic/>
  *      - <https://en.wikipedia.org/wiki/CORDIC> */
-static int qcordic(q_t theta, const int iterations, q_t *sine, q_t *cosine) {
-	assert(sine);
-	assert(cosine);
+static q_t cordic_fold(q_t theta, int *negate, int *shift) {
+	assert(negate);
+	assert(shift);
 
 	static const q_t   pi =   QPI,    npi =  -QPI;
 	static const q_t  hpi =   QPI/2, hnpi = -(QPI/2);
 	static const q_t  qpi =   QPI/4, qnpi = -(QPI/4);
-	static const q_t  dpi =   QPI*2, dnpi = -(QPI*2);
+	static const ld_t tau = 26986075409l, turns = 683565276l; /* 2pi and 1/2pi, in Q.32 */
 
-	/* Convert to range -pi   to pi, we could use qmod,
-	 * however that uses multiplication and division, and
-	 * if we can use those operators freely then there are
-	 * other, better algorithms we can use instead of CORDIC
-	 * for sine/cosine calculation. */
-	while (qless(theta, npi)) theta = qadd(theta,  dpi);
-	while (qmore(theta,  pi)) theta = qadd(theta, dnpi);
+	/* Convert to range -pi to pi in a fixed number of operations, the
+	 * nearest whole number of turns 'k' is found with a multiply and
+	 * 'k*2pi' is subtracted with 2pi held to 32 fractional bits, so large
+	 * arguments do not pick up the rounding error of 2pi in Q16.16. */
+	const ld_t k = ldivn(((ld_t)theta * turns) + (1ll << 47), 48);
+	theta = ldivn((((ld_t)theta * 65536) - (k * tau)) + (1l << 15), 16);
 
-	int negate = 0, shift = 0;
+	*negate = 0;
+	*shift = 0;
 
 	/* convert to range -pi/2 to pi/2 */
 	if (qless(theta, hnpi)) {
 		theta = qadd(theta,  pi);
-		negate = 1;
+		*negate = 1;
 	} else if (qmore(theta, hpi)) {
 		theta = qadd(theta, npi);
-		negate = 1;
+		*negate = 1;
 	}
 
 	/* convert to range -pi/4 to pi/4 */
 	if (qless(theta, qnpi)) {
 		theta = qadd(theta,  hpi);
-		shift = -1;
+		*shift = -1;
 	} else if (qmore(theta, qpi)) {
 		theta = qadd(theta, hnpi);
-		shift =  1;
+		*shift =  1;
 	}
+	return theta;
+}
 
-	d_t x = cordic_circular_inverse_scaling, y = 0, z = theta /* no theta scaling needed */;
-
-	/* CORDIC in Q2.16 format */
-	if (cordic(CORDIC_COORD_CIRCULAR_E, CORDIC_MODE_ROTATE_E, iterations, &x, &y, &z) < 0)
-		return -1;
-
+static void cordic_unfold(d_t x, d_t y, const int negate, const int shift, q_t *sine, q_t *cosine) {
+	assert(sine);
+	assert(cosine);
 	/* undo shifting and quadrant changes */
 	if (shift > 0) {
 		const d_t yt = y;
@@ -693,12 +1790,72 @@ static int qcordic(q_t theta, const int iterations, q_t *sine, q_t *cosine) {
 	/* set output; no scaling needed */
 	*cosine = x;
 	  *sine = y;
-	return 0;
+}
+
+static void qcordic(q_t theta, q_t *sine, q_t *cosine) {
+	assert(sine);
+	assert(cosine);
+	int negate = 0, shift = 0;
+	theta = cordic_fold(theta, &negate, &shift);
+
+	d_t x = cordic_circular_inverse_scaling, y = 0, z = theta /* no theta scaling needed */;
+
+	/* CORDIC in Q2.16 format */
+	cordic_circular_rotate(&x, &y, &z);
+
+	cordic_unfold(x, y, negate, shift, sine, cosine);
+}
+
+/* Batched CORDIC, vectors are processed 'QV_LANES' at a time with the same
+ * fixed iteration count as 'cordic' uses by default, the direction of each
+ * rotation is computed as a mask so there is no branching within the loop.
+ * The results are identical to 'cordic'. Elements that do not fill a whole
+ * set of lanes, or all of them if there is no SIMD support, use 'cordic'. */
+#ifdef QV_LANES
+static inline void cordic_circular_lanes(const cordic_mode_e mode, d_t *x0, d_t *y0, d_t *z0) {
+	static const size_t length = sizeof cordic_arctans / sizeof cordic_arctans[0];
+	const qv_t zero = qv_dup(0);
+	qv_t x = qv_load(x0), y = qv_load(y0), z = qv_load(z0);
+	for (unsigned j = 0; j < length; j++) {
+		const qv_t  d = qv_sign(mode == CORDIC_MODE_ROTATE_E ? z : qv_wsub(zero, y));
+		const qv_t xs = qv_wsub(qv_xor(qv_sra(y, j), d), d);
+		const qv_t ys = qv_wsub(qv_xor(qv_sra(x, j), d), d);
+		const qv_t zs = qv_wsub(qv_xor(qv_dup(cordic_arctans[j]), d), d);
+		x = qv_wsub(x, xs);
+		y = qv_wadd(y, ys);
+		z = qv_wsub(z, zs);
+	}
+	qv_store(x0, x);
+	qv_store(y0, y);
+	qv_store(z0, z);
+}
+#endif
+
+static void cordic_circular_n(const cordic_mode_e mode, d_t *x, d_t *y, d_t *z, const size_t n) {
+	assert(x);
+	assert(y);
+	assert(z);
+	assert(mode == CORDIC_MODE_VECTOR_E || mode == CORDIC_MODE_ROTATE_E);
+	size_t i = 0;
+#ifdef QV_LANES
+	if (mode == CORDIC_MODE_ROTATE_E)
+		for (; (i + QV_LANES) <= n; i += QV_LANES)
+			cordic_circular_lanes(CORDIC_MODE_ROTATE_E, &x[i], &y[i], &z[i]);
+	else
+		for (; (i + QV_LANES) <= n; i += QV_LANES)
+			cordic_circular_lanes(CORDIC_MODE_VECTOR_E, &x[i], &y[i], &z[i]);
+#endif
+	for (; i < n; i++) {
+		if (mode == CORDIC_MODE_ROTATE_E)
+			cordic_circular_rotate(&x[i], &y[i], &z[i]);
+		else
+			cordic_circular_vector(&x[i], &y[i], &z[i]);
+	}
 }
 
 q_t qatan(const q_t t) {
 	q_t x = qint(1), y = t, z = QINT(0);
-	cordic(CORDIC_COORD_CIRCULAR_E, CORDIC_MODE_VECTOR_E, -1, &x, &y, &z);
+	cordic_circular_vector(&x, &y, &z);
 	return z;
 }
 
@@ -714,15 +1871,14 @@ q_t qatan2(const q_t a, const q_t b) {
 			return qadd(qatan(qdiv(a, b)), QPI);
 		return qsub(qatan(qdiv(a, b)), QPI);
 	}
-	cordic(CORDIC_COORD_CIRCULAR_E, CORDIC_MODE_VECTOR_E, -1, &x, &y, &z);
+	cordic_circular_vector(&x, &y, &z);
 	return z;
 }
 
 void qsincos(q_t theta, q_t *sine, q_t *cosine) {
 	assert(sine);
 	assert(cosine);
-	const int r = qcordic(theta, -1, sine, cosine);
-	assert(r >= 0);
+	qcordic(theta, sine, cosine);
 }
 
 q_t qsin(const q_t theta) {
@@ -751,15 +1907,13 @@ q_t qcot(const q_t theta) {
 
 q_t qcordic_mul(const q_t a, const q_t b) { /* works for small values; result < 4 */
 	q_t x = a, y = QINT(0), z = b;
-	const int r = cordic(CORDIC_COORD_LINEAR_E, CORDIC_MODE_ROTATE_E, -1, &x, &y, &z);
-	assert(r >= 0);
+	cordic_linear_rotate(&x, &y, &z);
 	return y;
 }
 
 q_t qcordic_div(const q_t a, const q_t b) {
 	q_t x = b, y = a, z = QINT(0);
-	const int r = cordic(CORDIC_COORD_LINEAR_E, CORDIC_MODE_VECTOR_E, -1, &x, &y, &z);
-	assert(r >= 0);
+	cordic_linear_vector(&x, &y, &z);
 	return z;
 }
 
@@ -767,8 +1921,7 @@ void qsincosh(const q_t a, q_t *sinh, q_t *cosh) {
 	assert(sinh);
 	assert(cosh);
 	q_t x = cordic_hyperbolic_inverse_scaling, y = QINT(0), z = a; /* (e^2x - 1) / (e^2x + 1) */
-	const int r = cordic(CORDIC_COORD_HYPERBOLIC_E, CORDIC_MODE_ROTATE_E, -1, &x, &y, &z);
-	assert(r >= 0);
+	cordic_hyperbolic_rotate(&x, &y, &z);
 	*sinh = y;
 	*cosh = x;
 }
@@ -799,8 +1952,7 @@ q_t qcordic_exp(const q_t e) {
 
 q_t qcordic_ln(const q_t d) {
 	q_t x = qadd(d, QINT(1)), y = qsub(d, QINT(1)), z = QINT(0);
-	const int r = cordic(CORDIC_COORD_HYPERBOLIC_E, CORDIC_MODE_VECTOR_E, -1, &x, &y, &z);
-	assert(r >= 0);
+	cordic_hyperbolic_vector(&x, &y, &z);
 	return qadd(z, z);
 }
 
@@ -809,25 +1961,90 @@ q_t qcordic_sqrt(const q_t n) {  /* testing only; works for 0 < x < 2 */
 	q_t x = qadd(n, quarter),
 	    y = qsub(n, quarter),
 	    z = 0;
-	const int r = cordic(CORDIC_COORD_HYPERBOLIC_E, CORDIC_MODE_VECTOR_E, -1, &x, &y, &z);
-	assert(r >= 0);
+	cordic_hyperbolic_vector(&x, &y, &z);
 	return qmul(x, cordic_hyperbolic_inverse_scaling);
 }
 
-q_t qhypot(const q_t a, const q_t b) {
-	q_t x = qabs(a), y = qabs(b), z = QINT(0); /* abs() should not be needed? */
-	const int r = cordic(CORDIC_COORD_CIRCULAR_E, CORDIC_MODE_VECTOR_E, -1, &x, &y, &z);
-	assert(r >= 0);
-	return qmul(x, cordic_circular_inverse_scaling);
+q_t qhypot(const q_t a, const q_t b) { /* a^2 + b^2 fits in Q32.32 without overflow */
+	const ld_t x = a, y = b;
+	return qsat(QSTAT_OTHER, isqrt((lu_t)(x * x) + (lu_t)(y * y)));
+}
+
+/* Both 'qexp' and 'qlog' reduce their argument with a single shift by a power
+ * of two and then evaluate a short fixed polynomial in Q2.30, so they take the
+ * same number of operations whatever the input. Each is split into the range
+ * reduction, the polynomial and a final step so that 'qexp_n' and 'qlog_n' can
+ * run each part over a block of numbers. */
+
+static const ld_t log_c[] = { /* 1/(2n+1), Q2.30 */
+	1073741824l, 357913941l, 214748365l, 153391689l, 119304647l, 97612893l,
+};
+
+static const ld_t exp_c[] = { /* 1/n!, Q2.30 */
+	1073741824l, 1073741824l, 536870912l, 178956971l, 44739243l,
+	8947849l, 1491308l, 213044l, 26631l,
+};
+
+static inline ld_t log_reduce(const q_t x, ld_t *e) { /* x = m * 2^e, returns 's' for log(m) = 2*atanh(s) */
+	static const ld_t one = (ld_t)1 << 30, sqrt2 = 1518500250l; /* Q2.30 */
+	assert(x > 0);
+	assert(e);
+	const unsigned msb = 31u - qclz(x);
+	const ld_t m = (ld_t)((u_t)x << (30u - msb)); /* m in [1, 2) */
+	const ld_t h = m > sqrt2 ? 2 * one : one;  /* m/h in [sqrt(0.5), sqrt(2)) */
+	*e = ((ld_t)msb - QBITS) + (m > sqrt2);
+	return ((m - h) * one) / (m + h);
+}
+
+static inline ld_t log_finish(const ld_t s, const ld_t p, const ld_t e) { /* result in Q.30 */
+	static const ld_t ln2 = 744261118l; /* Q2.30 */
+	return (e * ln2) + ldivn(s * p, 29);
+}
+
+static ld_t log_q30(const q_t x) { /* log(x) = log(m * 2^e), result in Q.30 */
+	ld_t e = 0;
+	const ld_t s = log_reduce(x, &e);
+	const ld_t z = ldivn(s * s, 30);
+	ld_t p = log_c[5];
+	for (int i = 4; i >= 0; i--)
+		p = log_c[i] + ldivn(p * z, 30);
+	return log_finish(s, p, e);
+}
+
+static inline ld_t exp_reduce(ld_t x, ld_t *k) { /* exp(x) = 2^k * exp(r), returns 'r' */
+	static const ld_t ln2 = 744261118l, log2e = 94548l; /* Q2.30, Q16.16 */
+	assert(k);
+	x = MAX(MIN(x, (ld_t)12 << 30), -((ld_t)13 << 30)); /* saturates or 0 */
+	*k = ldivn((x * log2e) + ((ld_t)1 << 45), 46);
+	return x - (*k * ln2); /* |r| <= ln(2)/2 */
+}
+
+static inline q_t exp_finish(const ld_t p, const ld_t k) { /* p * 2^k, Q2.30 to Q16.16 */
+	if (k >= 14)
+		return qsat(QSTAT_EXP, p << (k - 14));
+	const ld_t shift = 14 - k;
+	if (shift > 31)
+		return 0;
+	return (p + ((ld_t)1 << (shift - 1))) >> shift;
+}
+
+static q_t exp_q30(const ld_t x) { /* exp(x) = 2^k * exp(r), 'x' in Q.30 */
+	ld_t k = 0;
+	const ld_t r = exp_reduce(x, &k);
+	ld_t p = exp_c[8];
+	for (int i = 7; i >= 0; i--)
+		p = exp_c[i] + ldivn(p * r, 30);
+	return exp_finish(p, k);
 }
 
 q_t qatanh(q_t x) {
 	assert(qabs(qless(x, QINT(1))));
-	return qmul(qlog(qdiv(qadd(QINT(1), x), qsub(QINT(1), x))), QMK(0, 0x8000, 16));
+	return q30toq(ldivn(log_q30(qdiv(qadd(QINT(1), x), qsub(QINT(1), x))), 1));
 }
 
-q_t qasinh(q_t x) {
-	return qlog(qadd(x, qsqrt(qadd(qmul(x, x), QINT(1)))));
+q_t qasinh(q_t x) { /* odd, so use |x| where 'x + sqrt(x*x + 1)' does not cancel */
+	const q_t a = x == DMIN ? DMAX : qabs(x), r = qlog(qadd(a, qsqrt(qadd(qmul(a, a), QINT(1)))));
+	return qless(x, QINT(0)) ? qnegate(r) : r;
 }
 
 q_t qacosh(q_t x) {
@@ -849,18 +2066,184 @@ void qrec2pol(const q_t i, const q_t j, q_t *magnitude, q_t *theta) {
 	assert(theta);
 	const int is = qisnegative(i), js = qisnegative(j);
 	q_t x = qabs(i), y = qabs(j), z = QINT(0);
-	const int r = cordic(CORDIC_COORD_CIRCULAR_E, CORDIC_MODE_VECTOR_E, -1, &x, &y, &z);
-	assert(r >= 0);
+	cordic_circular_vector(&x, &y, &z);
 	*magnitude = qmul(x, cordic_circular_inverse_scaling);
-	if (is && js)
+	if (is && js) /* 'z' is the angle from the 'i' axis folded into the first quadrant */
 		z = qadd(z, QPI);
 	else if (js)
-		z = qadd(z, QPI/2l);
+		z = qsub(2l*QPI, z);
 	else if (is)
-		z = qadd(z, (3l*QPI)/2l);
+		z = qsub(QPI, z);
 	*theta = z;
 }
 
+#define CORDIC_BLOCK (64) /* elements per batch, limits stack usage */
+
+void qsincos_n(const q_t *theta, q_t *sine, q_t *cosine, const size_t n) {
+	assert(theta);
+	assert(sine);
+	assert(cosine);
+	for (size_t i = 0; i < n; i += CORDIC_BLOCK) {
+		const size_t m = MIN(n - i, (size_t)CORDIC_BLOCK);
+		d_t x[CORDIC_BLOCK], y[CORDIC_BLOCK], z[CORDIC_BLOCK];
+		signed char negate[CORDIC_BLOCK], shift[CORDIC_BLOCK];
+		for (size_t k = 0; k < m; k++) {
+			int ng = 0, sh = 0;
+			z[k] = cordic_fold(theta[i + k], &ng, &sh);
+			x[k] = cordic_circular_inverse_scaling;
+			y[k] = 0;
+			negate[k] = ng;
+			shift[k]  = sh;
+		}
+		cordic_circular_n(CORDIC_MODE_ROTATE_E, x, y, z, m);
+		for (size_t k = 0; k < m; k++)
+			cordic_unfold(x[k], y[k], negate[k], shift[k], &sine[i + k], &cosine[i + k]);
+	}
+}
+
+void qatan2_n(q_t *r, const q_t *a, const q_t *b, const size_t n) {
+	assert(r);
+	assert(a);
+	assert(b);
+	enum { ATAN2_NONE, ATAN2_ADD_PI, ATAN2_SUB_PI, ATAN2_HALF_PI, ATAN2_NEG_HALF_PI, };
+	for (size_t i = 0; i < n; i += CORDIC_BLOCK) {
+		const size_t m = MIN(n - i, (size_t)CORDIC_BLOCK);
+		d_t x[CORDIC_BLOCK], y[CORDIC_BLOCK], z[CORDIC_BLOCK];
+		signed char adjust[CORDIC_BLOCK];
+		for (size_t k = 0; k < m; k++) { /* same special cases as 'qatan2' */
+			const q_t ak = a[i + k], bk = b[i + k];
+			x[k] = bk;
+			y[k] = ak;
+			z[k] = QINT(0);
+			adjust[k] = ATAN2_NONE;
+			if (qequal(bk, QINT(0))) {
+				assert(qunequal(ak, QINT(0)));
+				x[k] = QINT(1);
+				y[k] = QINT(0);
+				adjust[k] = qmore(ak, QINT(0)) ? ATAN2_HALF_PI : ATAN2_NEG_HALF_PI;
+			} else if (qless(bk, QINT(0))) {
+				x[k] = QINT(1);
+				y[k] = qdiv(ak, bk);
+				adjust[k] = qeqmore(ak, QINT(0)) ? ATAN2_ADD_PI : ATAN2_SUB_PI;
+			}
+		}
+		cordic_circular_n(CORDIC_MODE_VECTOR_E, x, y, z, m);
+		for (size_t k = 0; k < m; k++) {
+			switch (adjust[k]) {
+			case ATAN2_ADD_PI:      r[i + k] = qadd(z[k], QPI); break;
+			case ATAN2_SUB_PI:      r[i + k] = qsub(z[k], QPI); break;
+			case ATAN2_HALF_PI:     r[i + k] =  (QPI/2);        break;
+			case ATAN2_NEG_HALF_PI: r[i + k] = -(QPI/2);        break;
+			default:                r[i + k] = z[k];
+			}
+		}
+	}
+}
+
+/* 'isqrt' over many numbers, in place. Without SIMD each step is applied to
+ * every element before the next, so the elements are still independent. */
+static void isqrt_n(lu_t *v, const size_t m) {
+	assert(v);
+	size_t i = 0;
+#if defined(QV_LANES) && defined(QV_ISQRT)
+	for (; (i + (QV_LANES / 2)) <= m; i += (QV_LANES / 2))
+		qv_isqrt(&v[i]);
+#endif
+	lu_t r[CORDIC_BLOCK] = { 0, }, bit = 1ull << 62;
+	assert((m - i) <= CORDIC_BLOCK);
+	for (int s = 0; s < 32; s++, bit >>= 2)
+		for (size_t k = i; k < m; k++) {
+			const lu_t t = r[k - i] + bit, mask = -(lu_t)(v[k] >= t);
+			v[k] -= t & mask;
+			r[k - i] = (r[k - i] >> 1) + (bit & mask);
+		}
+	for (size_t k = i; k < m; k++)
+		v[k] = r[k - i] + (v[k] > r[k - i]);
+}
+
+void qsqrt_n(q_t *r, const q_t *a, const size_t n) {
+	assert(r);
+	assert(a);
+	for (size_t i = 0; i < n; i += CORDIC_BLOCK) { /* as 'qsqrt' */
+		const size_t m = MIN(n - i, (size_t)CORDIC_BLOCK);
+		lu_t v[CORDIC_BLOCK];
+		for (size_t k = 0; k < m; k++) {
+			assert(qeqmore(a[i + k], 0));
+			v[k] = qmore(a[i + k], 0) ? ((lu_t)a[i + k]) << QBITS : 0;
+		}
+		isqrt_n(v, m);
+		for (size_t k = 0; k < m; k++)
+			r[i + k] = v[k];
+	}
+}
+
+void qrsqrt_n(q_t *r, const q_t *a, const size_t n) {
+	assert(r);
+	assert(a);
+	for (size_t i = 0; i < n; i += CORDIC_BLOCK) { /* as 'qrsqrt' */
+		const size_t m = MIN(n - i, (size_t)CORDIC_BLOCK);
+		lu_t v[CORDIC_BLOCK];
+		unsigned char e[CORDIC_BLOCK];
+		for (size_t k = 0; k < m; k++) {
+			const q_t x = a[i + k];
+			assert(qmore(x, 0));
+			e[k] = qclz(x) & ~1u;
+			v[k] = qmore(x, 0) ? ((lu_t)x << e[k]) << 32 : 1;
+		}
+		isqrt_n(v, m);
+		for (size_t k = 0; k < m; k++)
+			r[i + k] = qmore(a[i + k], 0) ? (q_t)((((lu_t)1 << (40 + (e[k] / 2))) + (v[k] >> 1)) / v[k]) : qinfo.max;
+	}
+}
+
+void qhypot_n(q_t *r, const q_t *a, const q_t *b, const size_t n) {
+	assert(r);
+	assert(a);
+	assert(b);
+	for (size_t i = 0; i < n; i += CORDIC_BLOCK) { /* as 'qhypot' */
+		const size_t m = MIN(n - i, (size_t)CORDIC_BLOCK);
+		lu_t v[CORDIC_BLOCK];
+		for (size_t k = 0; k < m; k++) {
+			const ld_t x = a[i + k], y = b[i + k];
+			v[k] = (lu_t)(x * x) + (lu_t)(y * y);
+		}
+		isqrt_n(v, m);
+		for (size_t k = 0; k < m; k++)
+			r[i + k] = qsat(QSTAT_OTHER, v[k]);
+	}
+}
+
+void qrec2pol_n(const q_t *i, const q_t *j, q_t *magnitude, q_t *theta, const size_t n) {
+	assert(i);
+	assert(j);
+	assert(magnitude);
+	assert(theta);
+	for (size_t o = 0; o < n; o += CORDIC_BLOCK) {
+		const size_t m = MIN(n - o, (size_t)CORDIC_BLOCK);
+		d_t x[CORDIC_BLOCK], y[CORDIC_BLOCK], z[CORDIC_BLOCK];
+		signed char is[CORDIC_BLOCK], js[CORDIC_BLOCK];
+		for (size_t k = 0; k < m; k++) {
+			is[k] = BOOLIFY(qisnegative(i[o + k]));
+			js[k] = BOOLIFY(qisnegative(j[o + k]));
+			x[k] = qabs(i[o + k]);
+			y[k] = qabs(j[o + k]);
+			z[k] = QINT(0);
+		}
+		cordic_circular_n(CORDIC_MODE_VECTOR_E, x, y, z, m);
+		for (size_t k = 0; k < m; k++) { /* same quadrant correction as 'qrec2pol' */
+			q_t t = z[k];
+			if (is[k] && js[k])
+				t = qadd(t, QPI);
+			else if (js[k])
+				t = qsub(2l*QPI, t);
+			else if (is[k])
+				t = qsub(QPI, t);
+			magnitude[o + k] = qmul(x[k], cordic_circular_inverse_scaling);
+			theta[o + k] = t;
+		}
+	}
+}
+
 q_t qcordic_hyperbolic_gain(const int n) {
 	q_t x = QINT(1), y = QINT(0), z = QINT(0);
 	const int r = cordic(CORDIC_COORD_HYPERBOLIC_E, CORDIC_MODE_ROTATE_E, n, &x, &y, &z);
@@ -875,6 +2258,18 @@ q_t qcordic_circular_gain(const int n) {
 	return x;
 }
 
+void qcordic_sincos(q_t theta, q_t *sine, q_t *cosine, const int iterations) { /* as 'qcordic' */
+	assert(sine);
+	assert(cosine);
+	int negate = 0, shift = 0;
+	theta = cordic_fold(theta, &negate, &shift);
+	d_t x = cordic_circular_inverse_scaling, y = 0, z = theta;
+	const int r = cordic(CORDIC_COORD_CIRCULAR_E, CORDIC_MODE_ROTATE_E, iterations, &x, &y, &z);
+	assert(r >= 0);
+	UNUSED(r);
+	cordic_unfold(x, y, negate, shift, sine, cosine);
+}
+
 static inline int isodd(const unsigned n) {
 	return n & 1;
 }
@@ -900,23 +2295,60 @@ d_t dlog(d_t x, const unsigned base) { /* rounds up, look at remainder to round
 	return b;
 }
 
-q_t qlog(q_t x) {
-	q_t logs = 0;
+q_t qlog(const q_t x) {
 	assert(qmore(x, 0));
-	static const q_t lmax = QMK(9, 0x8000, 16); /* 9.5, lower limit needs checking */
-	for (; qmore(x, lmax); x = divn(x, 1))
-		logs = qadd(logs, qinfo.ln2);
-	return qadd(logs, qcordic_ln(x));
+	if (x <= 0)
+		return qinfo.min;
+	return q30toq(log_q30(x));
 }
 
 q_t qsqr(const q_t x) {
 	return qmul(x, x);
 }
 
-q_t qexp(const q_t e) { /* exp(e) = exp(e/2)*exp(e/2) */
-	if (qless(e, QINT(1))) /* 1.1268 is approximately the limit for qcordic_exp */
-		return qcordic_exp(e);
-	return qsqr(qexp(divn(e, 1)));
+q_t qexp(const q_t e) {
+	return exp_q30((ld_t)e * (1l << 14));
+}
+
+/* As 'qexp' and 'qlog', the argument reduction of a whole block is done
+ * first, as independent lanes, then the polynomials. For 'qlog' each step of
+ * the polynomial is applied to the block before the next, for 'qexp' that was
+ * no faster than evaluating each one in turn. */
+void qexp_n(q_t *r, const q_t *a, const size_t n) {
+	assert(r);
+	assert(a);
+	for (size_t i = 0; i < n; i += CORDIC_BLOCK) {
+		const size_t m = MIN(n - i, (size_t)CORDIC_BLOCK);
+		ld_t k[CORDIC_BLOCK], x[CORDIC_BLOCK];
+		for (size_t j = 0; j < m; j++)
+			x[j] = exp_reduce((ld_t)a[i + j] * (1l << 14), &k[j]);
+		for (size_t j = 0; j < m; j++) {
+			ld_t p = exp_c[8];
+			for (int c = 7; c >= 0; c--)
+				p = exp_c[c] + ldivn(p * x[j], 30);
+			r[i + j] = exp_finish(p, k[j]);
+		}
+	}
+}
+
+void qlog_n(q_t *r, const q_t *a, const size_t n) {
+	assert(r);
+	assert(a);
+	for (size_t i = 0; i < n; i += CORDIC_BLOCK) {
+		const size_t m = MIN(n - i, (size_t)CORDIC_BLOCK);
+		ld_t e[CORDIC_BLOCK], s[CORDIC_BLOCK], z[CORDIC_BLOCK], p[CORDIC_BLOCK];
+		for (size_t j = 0; j < m; j++) {
+			assert(qmore(a[i + j], 0));
+			s[j] = log_reduce(a[i + j] > 0 ? a[i + j] : 1, &e[j]);
+			z[j] = ldivn(s[j] * s[j], 30);
+			p[j] = log_c[5];
+		}
+		for (int c = 4; c >= 0; c--)
+			for (size_t j = 0; j < m; j++)
+				p[j] = log_c[c] + ldivn(p[j] * z[j], 30);
+		for (size_t j = 0; j < m; j++)
+			r[i + j] = a[i + j] > 0 ? q30toq(log_finish(s[j], p[j], e[j])) : qinfo.min;
+	}
 }
 
 q_t qpow(q_t n, q_t exp) {
@@ -928,40 +2360,50 @@ q_t qpow(q_t n, q_t exp) {
 		const q_t abspow = qpow(qabs(n), exp);
 		return qisodd(exp) ? qnegate(abspow) : abspow;
 	}
-	if (qisnegative(exp))
-		return qdiv(QINT(1), qpow(n, qabs(exp)));
-	return qexp(multiply(qlog(n), exp));
+	return exp_q30(ldivn(ldivn(log_q30(n), 6) * exp, 10)); /* Q.24 * Q.16 */
 }
 
-q_t qsqrt(const q_t x) { /* Newton-Rhaphson method */
+q_t qsqrt(const q_t x) { /* sqrt(x) = sqrt(x * 2^16) / 2^16 */
 	assert(qeqmore(x, 0));
-	const q_t difference = qmore(x, QINT(100)) ? 0x0100 : 0x0010;
-	if (qequal(QINT(0), x))
-		return QINT(0);
-	q_t guess = qmore(x, qinfo.sqrt2) ? divn(x, 1) : QINT(1);
-	while (qmore(qabs(qsub(qmul(guess, guess), x)), difference))
-		guess = divn(qadd(qdiv(x, guess), guess), 1);
-	return qabs(guess); /* correct for overflow int very large numbers */
+	return qmore(x, 0) ? (q_t)isqrt(((lu_t)x) << QBITS) : QINT(0);
+}
+
+q_t qrsqrt(const q_t x) { /* 1/sqrt(x), 'x' normalised so 'isqrt' keeps 32 bits */
+	assert(qmore(x, 0));
+	if (qeqless(x, 0))
+		return qinfo.max;
+	const unsigned e = qclz(x) & ~1u;
+	const lu_t s = isqrt(((lu_t)x << e) << 32); /* sqrt(x) * 2^(16 + e/2) */
+	return (((lu_t)1 << (40 + (e / 2))) + (s >> 1)) / s;
+}
+
+
+static inline q_t sqrt_one_minus_sqr(const q_t t) { /* sqrt(1 - t^2), |t| <= 1 */
+	assert(qeqless(qabs(t), QINT(1)));
+	return isqrt((lu_t)(((ld_t)1 << (2 * QBITS)) - ((ld_t)t * t)));
 }
 
 q_t qasin(const q_t t) {
-	assert(qless(qabs(t), QINT(1)));
+	assert(qeqless(qabs(t), QINT(1)));
 	/* can also use: return qatan(qdiv(t, qsqrt(qsub(QINT(1), qmul(t, t))))); */
-	return qatan2(t, qsqrt(qsub(QINT(1), qmul(t, t))));
+	return qatan2(t, sqrt_one_minus_sqr(t));
 }
 
 q_t qacos(const q_t t) {
 	assert(qeqless(qabs(t), QINT(1)));
 	/* can also use: return qatan(qdiv(qsqrt(qsub(QINT(1), qmul(t, t))), t)); */
-	return qatan2(qsqrt(qsub(QINT(1), qmul(t, t))), t);
+	return qatan2(sqrt_one_minus_sqr(t), t);
 }
 
+static const qrecip_t recip_180 = { .reciprocal = 0x0000016C16C16C16ull, .divisor = QINT(180), };
+static const qrecip_t recip_pi  = { .reciprocal = 0x0000517CCC827152ull, .divisor = QPI, };
+
 q_t qdeg2rad(const q_t deg) {
-	return qdiv(qmul(QPI, deg), QINT(180));
+	return qdiv_by(&recip_180, qmul(QPI, deg));
 }
 
 q_t qrad2deg(const q_t rad) {
-	return qdiv(qmul(QINT(180), rad), QPI);
+	return qdiv_by(&recip_pi, qmul(QINT(180), rad));
 }
 
 void qfilter_init(qfilter_t *f, const q_t time, const q_t rc, const q_t seed) {
@@ -973,13 +2415,22 @@ void qfilter_init(qfilter_t *f, const q_t time, const q_t rc, const q_t seed) {
 	f->raw = seed;
 }
 
+/* If the calling rate is constant (for example the function is guaranteed
+ * to be always called at a rate of 5 milliseconds) we can avoid the costly
+ * alpha calculation, 'qfilter_init_fixed' computes it once and the time
+ * given to the filter functions is then only recorded. */
+void qfilter_init_fixed(qfilter_t *f, const q_t dt, const q_t rc, const q_t seed) {
+	assert(f);
+	qfilter_init(f, QINT(0), rc, seed);
+	f->dt   = dt;
+	f->low  = qdiv(dt, qadd(rc, dt));
+	f->high = qdiv(rc, qadd(rc, dt));
+}
+
 q_t qfilter_low_pass(qfilter_t *f, const q_t time, const q_t data) {
 	assert(f);
-	/* If the calling rate is constant (for example the function is
-	 * guaranteed to be always called at a rate of 5 milliseconds) we
-	 * can avoid the costly alpha calculation! */
 	const q_t dt = (u_t)time - (u_t)f->time;
-	const q_t alpha = qdiv(dt, qadd(f->rc, dt));
+	const q_t alpha = f->dt ? f->low : qdiv(dt, qadd(f->rc, dt));
 	f->filtered = qfma(alpha, qsub(data, f->filtered), f->filtered);
 	f->time = time;
 	f->raw  = data;
@@ -989,7 +2440,7 @@ q_t qfilter_low_pass(qfilter_t *f, const q_t time, const q_t data) {
 q_t qfilter_high_pass(qfilter_t *f, const q_t time, const q_t data) {
 	assert(f);
 	const q_t dt = (u_t)time - (u_t)f->time;
-	const q_t alpha = qdiv(f->rc, qadd(f->rc, dt));
+	const q_t alpha = f->dt ? f->high : qdiv(f->rc, qadd(f->rc, dt));
 	f->filtered = qmul(alpha, qadd(f->filtered, qsub(data, f->raw)));
 	f->time = time;
 	f->raw  = data;
@@ -1001,47 +2452,332 @@ q_t qfilter_value(const qfilter_t *f) {
 	return f->filtered;
 }
 
-/* Must be called at a constant rate; perhaps a PID which takes call time
- * into account could be made, but that would complicate things. Differentiator
- * term needs filtering also. It would be nice to create a version that took
- * into account the time delta, see
- * <https://www.quora.com/Do-I-need-to-sample-at-a-constant-rate-for-PID-control-or-is-it-sufficient-to-know-the-time-at-which-my-sample-was-taken-even-if-the-increment-varies>
- * */
-q_t qpid_update(qpid_t *pid, const q_t error, const q_t position) {
-	assert(pid);
-	const q_t p  = qmul(pid->p_gain, error);
-	pid->i_state = qadd(pid->i_state, error);
-	pid->i_state = qmax(pid->i_state, pid->i_min);
-	pid->i_state = qmin(pid->i_state, pid->i_max);
-	const q_t i  = qmul(pid->i_state, pid->i_gain);
-	const q_t d  = qmul(pid->d_gain, qsub(position, pid->d_state));
-	pid->d_state = position;
-	return qsub(qadd(p, i), d);
+/* The block functions advance 'time' by 'dt' for each sample, as if the
+ * per sample functions had been called. */
+int qfilter_low_pass_block(qfilter_t *f, q_t *data, const size_t n) {
+	assert(f);
+	assert(data);
+	if (!f->dt)
+		return -1;
+	const q_t alpha = f->low;
+	q_t filtered = f->filtered, raw = f->raw;
+	for (size_t i = 0; i < n; i++) {
+		raw = data[i];
+		data[i] = filtered = qfma(alpha, qsub(raw, filtered), filtered);
+	}
+	f->raw = raw;
+	f->filtered = filtered;
+	f->time = (u_t)f->time + ((u_t)f->dt * (u_t)n);
+	return 0;
 }
 
-/* Simpsons method for numerical integration, from "Math Toolkit for 
- * Real-Time Programming" by Jack Crenshaw */
-q_t qsimpson(q_t (*f)(q_t), const q_t x1, const q_t x2, const unsigned n) {
+int qfilter_high_pass_block(qfilter_t *f, q_t *data, const size_t n) {
 	assert(f);
-	assert((n & 1) == 0);
-	const q_t h = qdiv(qsub(x2, x1), QINT(n));
-	q_t sum = 0, x = x1;
-	for (unsigned i = 0; i < (n / 2u); i++){
-		sum = qadd(sum, qadd(f(x), qmul(QINT(2), f(qadd(x,h)))));
-		x   = qadd(x, qmul(QINT(2), h));
+	assert(data);
+	if (!f->dt)
+		return -1;
+	const q_t alpha = f->high;
+	q_t filtered = f->filtered, raw = f->raw;
+	for (size_t i = 0; i < n; i++) {
+		const q_t x = data[i];
+		data[i] = filtered = qmul(alpha, qadd(filtered, qsub(x, raw)));
+		raw = x;
 	}
-	sum = qsub(qmul(QINT(2), sum), qadd(f(x1), f(x2)));
-	return qdiv(qmul(h, sum), QINT(3));
+	f->raw = raw;
+	f->filtered = filtered;
+	f->time = (u_t)f->time + ((u_t)f->dt * (u_t)n);
+	return 0;
 }
 
-/* The matrix meta-data field is not used at the moment, but could be
- * used for things like versioning, determining whether the matrix is
- * all zeros, or is the identify matrix, whether it contains valid data,
- * and more. Some common matrix operations are missing, such as factorization 
- *
- * A function for image kernels might be useful. */
-
-enum { METADATA, LENGTH, ROW, COLUMN, DATA, };
+/* The biquad and FIR filters accumulate their sums of products exactly and
+ * round once per output sample (see 'wide_result'). Coefficients are in
+ * the same Q format as the samples, which limits how close to the unit
+ * circle the poles of a biquad can be placed accurately; cascading
+ * sections of low order is the usual remedy. */
+void qbiquad_init(qbiquad_t *f, const q_t b0, const q_t b1, const q_t b2, const q_t a1, const q_t a2) {
+	assert(f);
+	memset(f, 0, sizeof (*f));
+	f->b0 = b0;
+	f->b1 = b1;
+	f->b2 = b2;
+	f->a1 = a1;
+	f->a2 = a2;
+}
+
+q_t qbiquad_update(qbiquad_t *f, const q_t x) {
+	assert(f);
+	lu_t s = 0;
+	ld_t h = 0;
+	wide_add(&s, &h, (ld_t)f->b0 * x);
+	wide_add(&s, &h, (ld_t)f->b1 * f->x1);
+	wide_add(&s, &h, (ld_t)f->b2 * f->x2);
+	wide_add(&s, &h, -((ld_t)f->a1 * f->y1));
+	wide_add(&s, &h, -((ld_t)f->a2 * f->y2));
+	const q_t y = wide_result(s, h, 5);
+	f->x2 = f->x1;
+	f->x1 = x;
+	f->y2 = f->y1;
+	f->y1 = y;
+	return y;
+}
+
+void qbiquad_block(qbiquad_t *f, const size_t stages, q_t *data, const size_t n) {
+	assert(f);
+	assert(data);
+	for (size_t j = 0; j < stages; j++) /* each stage runs over the whole block, whilst it is in cache */
+		for (size_t i = 0; i < n; i++)
+			data[i] = qbiquad_update(&f[j], data[i]);
+}
+
+/* The history is kept twice over, each sample being written at 'index' and
+ * 'index + length', so that the last 'length' inputs are always contiguous,
+ * newest first, from 'index'. The dot product with the taps can then be
+ * done in one pass, which uses SIMD if available. */
+void qfir_init(qfir_t *f, const q_t *taps, const size_t length, q_t *history) {
+	assert(f);
+	assert(taps);
+	assert(history);
+	assert(length);
+	f->taps = taps;
+	f->history = history;
+	f->length = length;
+	f->index = 0;
+	memset(history, 0, 2 * length * sizeof (*history));
+}
+
+q_t qfir_update(qfir_t *f, const q_t x) {
+	assert(f);
+	const size_t length = f->length;
+	f->index = f->index ? f->index - 1 : length - 1;
+	f->history[f->index] = x;
+	f->history[f->index + length] = x;
+	return wide_dot(f->taps, &f->history[f->index], length);
+}
+
+void qfir_block(qfir_t *f, q_t *data, const size_t n) {
+	assert(f);
+	assert(data);
+	for (size_t i = 0; i < n; i++)
+		data[i] = qfir_update(f, data[i]);
+}
+
+/* Must be called at a constant rate, see 'qpid_update_dt' for a version
+ * which takes the time delta into account and filters the differentiator. */
+q_t qpid_update(qpid_t *pid, const q_t error, const q_t position) {
+	assert(pid);
+	const q_t p  = qmul(pid->p_gain, error);
+	pid->i_state = qadd(pid->i_state, error);
+	pid->i_state = qmax(pid->i_state, pid->i_min);
+	pid->i_state = qmin(pid->i_state, pid->i_max);
+	const q_t i  = qmul(pid->i_state, pid->i_gain);
+	const q_t d  = qmul(pid->d_gain, qsub(position, pid->d_state));
+	pid->d_state = position;
+	return qsub(qadd(p, i), d);
+}
+
+/* The integrator accumulates 'error*dt' and the differentiator uses the
+ * rate of change of 'position', '(position - previous)/dt', so the gains are
+ * independent of the calling rate, see
+ * <https://www.quora.com/Do-I-need-to-sample-at-a-constant-rate-for-PID-control-or-is-it-sufficient-to-know-the-time-at-which-my-sample-was-taken-even-if-the-increment-varies>.
+ * The rate is then passed through a first order low pass filter with the
+ * coefficient 'd_alpha', which is disabled if that is zero. */
+q_t qpid_update_dt(qpid_t *pid, const q_t error, const q_t position, const q_t dt) {
+	assert(pid);
+	assert(dt > 0);
+	const q_t p  = qmul(pid->p_gain, error);
+	pid->i_state = qadd(pid->i_state, qmul(error, dt));
+	pid->i_state = qmax(pid->i_state, pid->i_min);
+	pid->i_state = qmin(pid->i_state, pid->i_max);
+	const q_t i  = qmul(pid->i_state, pid->i_gain);
+	q_t rate = qdiv(qsub(position, pid->d_state), dt);
+	if (pid->d_alpha)
+		rate = pid->d_filtered = qfma(pid->d_alpha, qsub(rate, pid->d_filtered), pid->d_filtered);
+	const q_t d  = qmul(pid->d_gain, rate);
+	pid->d_state = position;
+	return qsub(qadd(p, i), d);
+}
+
+static void clamp_n(q_t *r, const q_t *lo, const q_t *hi, const size_t n) {
+	assert(r);
+	assert(lo);
+	assert(hi);
+	size_t i = 0;
+#ifdef QV_LANES
+	for (; (i + QV_LANES) <= n; i += QV_LANES)
+		qv_store(&r[i], qv_min(qv_max(qv_load(&r[i]), qv_load(&lo[i])), qv_load(&hi[i])));
+#endif
+	for (; i < n; i++)
+		r[i] = qmin(qmax(r[i], lo[i]), hi[i]);
+}
+
+/* A bank of controllers is updated 'CONFIG_Q_PID_BLOCK' at a time, one
+ * bulk operation after another, each giving the same result as the
+ * controller functions above would for each element. 'outputs' may be the
+ * same array as 'errors' or 'positions'. */
+static void pid_bank_update(qpid_bank_t *b, const q_t *errors, const q_t *positions, q_t *outputs, const q_t dt, const size_t n) {
+	assert(b);
+	assert(errors);
+	assert(positions);
+	assert(outputs);
+	for (size_t j = 0; j < n; j += CONFIG_Q_PID_BLOCK) {
+		q_t p[CONFIG_Q_PID_BLOCK], i[CONFIG_Q_PID_BLOCK], d[CONFIG_Q_PID_BLOCK];
+		const size_t m = MIN((size_t)CONFIG_Q_PID_BLOCK, n - j);
+		const q_t *e = &errors[j], *x = &positions[j];
+		q_t *is = &b->i_state[j], *ds = &b->d_state[j];
+		qmul_n(p, &b->p_gain[j], e, m);
+		if (dt) {
+			qmul_scalar_n(i, e, dt, m);
+			qadd_n(is, is, i, m);
+		} else {
+			qadd_n(is, is, e, m);
+		}
+		clamp_n(is, &b->i_min[j], &b->i_max[j], m);
+		qmul_n(i, is, &b->i_gain[j], m);
+		qsub_n(d, x, ds, m);
+		memcpy(ds, x, m * sizeof (*ds));
+		if (dt) {
+			qdiv_scalar_n(d, d, dt, m);
+			if (b->d_alpha && b->d_filtered) { /* see 'qpid_update_dt' for the zero 'd_alpha' case */
+				q_t *df = &b->d_filtered[j];
+				q_t t[CONFIG_Q_PID_BLOCK];
+				qsub_n(t, d, df, m);
+				for (size_t k = 0; k < m; k++)
+					d[k] = b->d_alpha[j + k] ? (df[k] = qfma(b->d_alpha[j + k], t[k], df[k])) : d[k];
+			}
+		}
+		qmul_n(d, &b->d_gain[j], d, m);
+		qadd_n(p, p, i, m);
+		qsub_n(&outputs[j], p, d, m);
+	}
+}
+
+void qpid_bank_update(qpid_bank_t *bank, const q_t *errors, const q_t *positions, q_t *outputs, const size_t n) {
+	pid_bank_update(bank, errors, positions, outputs, 0, n);
+}
+
+void qpid_bank_update_dt(qpid_bank_t *bank, const q_t *errors, const q_t *positions, q_t *outputs, const q_t dt, const size_t n) {
+	assert(dt > 0);
+	pid_bank_update(bank, errors, positions, outputs, dt, n);
+}
+
+/* Rounded 'width * sum / (divisor * 2^QBITS)' for the integrators, 'sum'
+ * being a (weighted) sum of samples and 'width' the span they cover. The
+ * division is split in two so nothing overflows, an area too large for
+ * any 'q_t' is clamped to '+/-2^47' so that it still saturates. */
+static ld_t wide_area(const ld_t width, const ld_t sum, const ld_t divisor) {
+	assert(divisor > 0 && divisor < (1ll << 30));
+	assert(width > -(1ll << 33) && width < (1ll << 33));
+	const ld_t g = sum / divisor, r = sum % divisor;
+	const ld_t mg = g < 0 ? -g : g, mw = width < 0 ? -width : width;
+	if (mg && mw > ((ld_t)1 << 62) / mg)
+		return (width < 0) != (g < 0) ? -((ld_t)1 << 47) : (ld_t)1 << 47;
+	const ld_t p = (width * g) + ((width * r) / divisor); /* Q32.32 */
+	return ldivn(p + (ld_t)QHIGH, QBITS);
+}
+
+/* Simpsons method for numerical integration, from "Math Toolkit for 
+ * Real-Time Programming" by Jack Crenshaw */
+q_t qsimpson(q_t (*f)(q_t), const q_t x1, const q_t x2, const unsigned n) {
+	assert(f);
+	assert((n & 1) == 0);
+	assert(n < (1u << 28));
+	if (n == 0)
+		return 0;
+	/* The step 'h' is never rounded and stored, instead each abscissa and
+	 * the final '(h/3) * sum' are computed from the exact width. */
+	const ld_t width = (ld_t)x2 - (ld_t)x1;
+	ld_t sum = 0; /* weighted sum of 'f(x1) + 4f(x1+h) + 2f(x1+2h) + ... + f(x2)' */
+	for (unsigned i = 0; i <= n; i++) {
+		const q_t x = qsat(QSTAT_SUM, x1 + wide_area(width, (ld_t)i * QINT(1), n));
+		const ld_t w = i == 0 || i == n ? 1 : i & 1 ? 4 : 2;
+		sum += w * f(x);
+	}
+	return qsat(QSTAT_SUM, wide_area(width, sum, 3ll * n));
+}
+
+/* Integrators over 'n' samples already taken at intervals of 'h', the sums
+ * are exact and rounded once. The Simpson rule needs an odd number of
+ * samples (an even number of intervals). */
+q_t qtrapezoid_array(const q_t *y, const size_t n, const q_t h) {
+	assert(y);
+	assert(n < (1ull << 30));
+	if (n < 2)
+		return 0;
+	ld_t sum = 0;
+	for (size_t i = 1; i < (n - 1); i++)
+		sum += y[i];
+	sum = (2 * sum) + y[0] + y[n - 1];
+	return qsat(QSTAT_SUM, wide_area(h, sum, 2));
+}
+
+q_t qsimpson_array(const q_t *y, const size_t n, const q_t h) {
+	assert(y);
+	assert(n & 1);
+	assert(n < (1ull << 28));
+	if (n < 3)
+		return 0;
+	ld_t odd = 0, even = 0;
+	for (size_t i = 1; i < (n - 1); i += 2) {
+		odd  += y[i];
+		even += y[i + 1];
+	}
+	const ld_t sum = (4 * odd) + (2 * even) + y[0] - y[n - 1];
+	return qsat(QSTAT_SUM, wide_area(h, sum, 3));
+}
+
+typedef struct {
+	q_t (*f)(q_t);
+	unsigned evaluations, limit;
+} adaptive_t;
+
+/* Each call is given the function values at both ends and the middle of
+ * its segment, so only the two quarter points are new. The recursion
+ * stops when the segment can no longer be halved, which bounds the depth
+ * to about 32 even with a tolerance of zero. */
+static ld_t adaptive_simpson(adaptive_t *a, const q_t x1, const q_t x2, const q_t f1, const q_t fm, const q_t f2, const ld_t whole, const ld_t tolerance) {
+	assert(a);
+	const q_t xm  = (q_t)ldivn((ld_t)x1 + x2, 1);
+	const q_t xlm = (q_t)ldivn((ld_t)x1 + xm, 1);
+	const q_t xrm = (q_t)ldivn((ld_t)xm + x2, 1);
+	if (xlm == x1 || xlm == xm || xrm == xm || xrm == x2 || (a->evaluations + 2) > a->limit)
+		return whole;
+	const q_t flm = a->f(xlm), frm = a->f(xrm);
+	a->evaluations += 2;
+	const ld_t left  = wide_area((ld_t)xm - x1, (ld_t)f1 + (4ll * flm) + fm, 6);
+	const ld_t right = wide_area((ld_t)x2 - xm, (ld_t)fm + (4ll * frm) + f2, 6);
+	const ld_t delta = left + right - whole;
+	if ((delta < 0 ? -delta : delta) <= (15 * tolerance))
+		return left + right + (delta / 15); /* Richardson extrapolation */
+	return adaptive_simpson(a, x1, xm, f1, flm, fm, left, tolerance / 2)
+		+ adaptive_simpson(a, xm, x2, fm, frm, f2, right, tolerance / 2);
+}
+
+/* Adaptive Simpsons method, the interval is only subdivided where the
+ * estimate has not yet converged to within 'tolerance', which usually
+ * needs far fewer evaluations of 'f' than 'qsimpson' for the same error.
+ * No more than 'evaluations' calls of 'f' are made (at least three). */
+q_t qsimpson_adaptive(q_t (*f)(q_t), const q_t x1, const q_t x2, const q_t tolerance, const unsigned evaluations) {
+	assert(f);
+	assert(tolerance >= 0);
+	assert(evaluations >= 3);
+	if (x1 == x2)
+		return 0;
+	adaptive_t a = { .f = f, .evaluations = 3, .limit = evaluations, };
+	const q_t xm = (q_t)ldivn((ld_t)x1 + x2, 1);
+	const q_t f1 = f(x1), fm = f(xm), f2 = f(x2);
+	const ld_t whole = wide_area((ld_t)x2 - x1, (ld_t)f1 + (4ll * fm) + f2, 6);
+	return qsat(QSTAT_SUM, adaptive_simpson(&a, x1, x2, f1, fm, f2, whole, tolerance));
+}
+
+/* The matrix meta-data field is not used at the moment, but could be
+ * used for things like versioning, determining whether the matrix is
+ * all zeros, or is the identify matrix, whether it contains valid data,
+ * and more. Most operations work on views (see 'qview_t'), the 'qmatrix_'
+ * functions are wrappers around them that also resize their result.
+ *
+ * A function for image kernels might be useful. */
+
+enum { METADATA, LENGTH, ROW, COLUMN, DATA, };
 
 int qmatrix_is_valid(const q_t *m) {
 	const size_t size = m[LENGTH], row = m[ROW], column = m[COLUMN];
@@ -1065,21 +2801,306 @@ int qmatrix_resize(q_t *m, const size_t row, const size_t column) {
 	return 0;
 }
 
+/* A view is a window onto matrix elements held elsewhere, either in a matrix
+ * or in any other buffer, with element (i, j) found at
+ * 'data[i*row_stride + j*column_stride]'. Sub-matrices, rows, columns and
+ * transpositions are all views onto the same elements, and no copy is made.
+ * A view cannot be resized, so the result views given to the operations
+ * below must already be the right shape, they return -1 if not. The
+ * 'qmatrix_' functions resize their result and then call the view
+ * equivalent. Unless an operation says otherwise a result may be one of its
+ * operands but must not partially overlap them. */
+
+qview_t qview(q_t *data, const size_t rows, const size_t columns, const size_t row_stride) {
+	assert(data || !(rows && columns));
+	const qview_t v = { data, rows, columns, row_stride, 1, };
+	return v;
+}
+
+qview_t qview_matrix(q_t *m) {
+	assert(m);
+	assert(qmatrix_is_valid(m));
+	return qview(&m[DATA], m[ROW], m[COLUMN], m[COLUMN]);
+}
+
+static qview_t view_const(const q_t *m) { /* views of operands are only ever read from */
+	return qview_matrix((q_t*)m);
+}
+
+qview_t qview_block(const qview_t v, const size_t row, const size_t column, const size_t rows, const size_t columns) {
+	assert(row <= v.rows && rows <= (v.rows - row));
+	assert(column <= v.columns && columns <= (v.columns - column));
+	qview_t r = v;
+	r.rows = 0;
+	r.columns = 0;
+	if (row > v.rows || rows > (v.rows - row))
+		return r;
+	if (column > v.columns || columns > (v.columns - column))
+		return r;
+	if (rows && columns)
+		r.data = &v.data[(row * v.row_stride) + (column * v.column_stride)];
+	r.rows = rows;
+	r.columns = columns;
+	return r;
+}
+
+qview_t qview_row(const qview_t v, const size_t row) { return qview_block(v, row, 0, 1, v.columns); }
+qview_t qview_column(const qview_t v, const size_t column) { return qview_block(v, 0, column, v.rows, 1); }
+
+qview_t qview_transpose(const qview_t v) {
+	const qview_t r = { v.data, v.columns, v.rows, v.column_stride, v.row_stride, };
+	return r;
+}
+
+static inline q_t *view_at(const qview_t *v, const size_t i, const size_t j) {
+	assert(v);
+	assert(i < v->rows && j < v->columns);
+	return &v->data[(i * v->row_stride) + (j * v->column_stride)];
+}
+
+static inline int view_same_shape(const qview_t *a, const qview_t *b) {
+	assert(a);
+	assert(b);
+	return a->rows == b->rows && a->columns == b->columns;
+}
+
+int qview_apply_unary(const qview_t r, const qview_t a, q_t (*func)(q_t)) {
+	assert(func);
+	if (!view_same_shape(&r, &a))
+		return -1;
+	for (size_t i = 0; i < a.rows; i++)
+		for (size_t j = 0; j < a.columns; j++)
+			*view_at(&r, i, j) = func(*view_at(&a, i, j));
+	return 0;
+}
+
+int qview_apply_scalar(const qview_t r, const qview_t a, q_t (*func)(q_t, q_t), const q_t c) {
+	assert(func);
+	if (!view_same_shape(&r, &a))
+		return -1;
+	for (size_t i = 0; i < a.rows; i++)
+		for (size_t j = 0; j < a.columns; j++)
+			*view_at(&r, i, j) = func(*view_at(&a, i, j), c);
+	return 0;
+}
+
+int qview_apply_binary(const qview_t r, const qview_t a, const qview_t b, q_t (*func)(q_t, q_t)) {
+	assert(func);
+	if (!view_same_shape(&a, &b) || !view_same_shape(&r, &a))
+		return -1;
+	for (size_t i = 0; i < a.rows; i++)
+		for (size_t j = 0; j < a.columns; j++)
+			*view_at(&r, i, j) = func(*view_at(&a, i, j), *view_at(&b, i, j));
+	return 0;
+}
+
+int qview_copy(const qview_t r, const qview_t a) {
+	if (!view_same_shape(&r, &a))
+		return -1;
+	if (r.column_stride == 1 && a.column_stride == 1) {
+		for (size_t i = 0; i < a.rows && a.columns; i++)
+			memmove(view_at(&r, i, 0), view_at(&a, i, 0), a.columns * sizeof (q_t));
+		return 0;
+	}
+	for (size_t i = 0; i < a.rows; i++)
+		for (size_t j = 0; j < a.columns; j++)
+			*view_at(&r, i, j) = *view_at(&a, i, j);
+	return 0;
+}
+
+/* The built in elementwise operations are instantiated from these macros,
+ * rather than calling 'qview_apply_unary' and friends, so that 'OP' can be
+ * inlined into the loop. Rows that are contiguous in every operand are
+ * handed to 'ROW' instead, which is either a bulk function (which may use
+ * SIMD) or a loop generated by 'MATRIX_*_ROW'. The function pointer
+ * versions are for user supplied callbacks only. */
+#define MATRIX_UNARY_ROW(NAME, OP)\
+	static void NAME(q_t *r, const q_t *a, const size_t n) {\
+		for (size_t i = 0; i < n; i++)\
+			r[i] = OP(a[i]);\
+	}
+
+#define MATRIX_SCALAR_ROW(NAME, OP)\
+	static void NAME(q_t *r, const q_t *a, const q_t s, const size_t n) {\
+		for (size_t i = 0; i < n; i++)\
+			r[i] = OP(a[i], s);\
+	}
+
+#define MATRIX_BINARY_ROW(NAME, OP)\
+	static void NAME(q_t *r, const q_t *a, const q_t *b, const size_t n) {\
+		for (size_t i = 0; i < n; i++)\
+			r[i] = OP(a[i], b[i]);\
+	}
+
+#define VIEW_UNARY(NAME, OP, ROW)\
+	int NAME(const qview_t r, const qview_t a) {\
+		if (!view_same_shape(&r, &a))\
+			return -1;\
+		const size_t rs = r.column_stride, as = a.column_stride;\
+		for (size_t i = 0; i < a.rows && a.columns; i++) {\
+			q_t *ri = view_at(&r, i, 0);\
+			const q_t *ai = view_at(&a, i, 0);\
+			if (rs == 1 && as == 1) {\
+				ROW(ri, ai, a.columns);\
+				continue;\
+			}\
+			for (size_t j = 0; j < a.columns; j++)\
+				ri[j * rs] = OP(ai[j * as]);\
+		}\
+		return 0;\
+	}
+
+#define VIEW_SCALAR(NAME, OP, ROW)\
+	int NAME(const qview_t r, const qview_t a, const q_t scalar) {\
+		if (!view_same_shape(&r, &a))\
+			return -1;\
+		const size_t rs = r.column_stride, as = a.column_stride;\
+		for (size_t i = 0; i < a.rows && a.columns; i++) {\
+			q_t *ri = view_at(&r, i, 0);\
+			const q_t *ai = view_at(&a, i, 0);\
+			if (rs == 1 && as == 1) {\
+				ROW(ri, ai, scalar, a.columns);\
+				continue;\
+			}\
+			for (size_t j = 0; j < a.columns; j++)\
+				ri[j * rs] = OP(ai[j * as], scalar);\
+		}\
+		return 0;\
+	}
+
+#define VIEW_BINARY(NAME, OP, ROW)\
+	int NAME(const qview_t r, const qview_t a, const qview_t b) {\
+		if (!view_same_shape(&a, &b) || !view_same_shape(&r, &a))\
+			return -1;\
+		const size_t rs = r.column_stride, as = a.column_stride, bs = b.column_stride;\
+		for (size_t i = 0; i < a.rows && a.columns; i++) {\
+			q_t *ri = view_at(&r, i, 0);\
+			const q_t *ai = view_at(&a, i, 0), *bi = view_at(&b, i, 0);\
+			if (rs == 1 && as == 1 && bs == 1) {\
+				ROW(ri, ai, bi, a.columns);\
+				continue;\
+			}\
+			for (size_t j = 0; j < a.columns; j++)\
+				ri[j * rs] = OP(ai[j * as], bi[j * bs]);\
+		}\
+		return 0;\
+	}
+
+static q_t qfz(q_t a) { UNUSED(a); return QINT(0); }
+static q_t qf1(q_t a) { UNUSED(a); return QINT(1); }
+
+MATRIX_UNARY_ROW(qzero_row,    qfz)
+MATRIX_UNARY_ROW(qone_row,     qf1)
+MATRIX_UNARY_ROW(qlogical_row, qlogical)
+MATRIX_UNARY_ROW(qnot_row,     qnot)
+MATRIX_UNARY_ROW(qsignum_row,  qsignum)
+MATRIX_UNARY_ROW(qinvert_row,  qinvert)
+MATRIX_BINARY_ROW(qand_row, qand)
+MATRIX_BINARY_ROW(qor_row,  qor)
+MATRIX_BINARY_ROW(qxor_row, qxor)
+MATRIX_SCALAR_ROW(qmod_scalar_row, qmod)
+MATRIX_SCALAR_ROW(qrem_scalar_row, qrem)
+MATRIX_SCALAR_ROW(qand_scalar_row, qand)
+MATRIX_SCALAR_ROW(qor_scalar_row,  qor)
+MATRIX_SCALAR_ROW(qxor_scalar_row, qxor)
+
+static VIEW_UNARY(view_zero, qfz, qzero_row)
+static VIEW_UNARY(view_one,  qf1, qone_row)
+int qview_zero(const qview_t r) { return view_zero(r, r); }
+int qview_one(const qview_t r)  { return view_one(r, r); }
+VIEW_UNARY(qview_logical, qlogical, qlogical_row)
+VIEW_UNARY(qview_not,     qnot,     qnot_row)
+VIEW_UNARY(qview_signum,  qsignum,  qsignum_row)
+VIEW_UNARY(qview_invert,  qinvert,  qinvert_row)
+VIEW_BINARY(qview_add, qadd, qadd_n)
+VIEW_BINARY(qview_sub, qsub, qsub_n)
+VIEW_BINARY(qview_and, qand, qand_row)
+VIEW_BINARY(qview_or,  qor,  qor_row)
+VIEW_BINARY(qview_xor, qxor, qxor_row)
+
+VIEW_SCALAR(qview_scalar_add, qadd, qadd_scalar_n)
+VIEW_SCALAR(qview_scalar_sub, qsub, qsub_scalar_n)
+VIEW_SCALAR(qview_scalar_mul, qmul, qmul_scalar_n)
+VIEW_SCALAR(qview_scalar_div, qdiv, qdiv_scalar_n)
+VIEW_SCALAR(qview_scalar_mod, qmod, qmod_scalar_row)
+VIEW_SCALAR(qview_scalar_rem, qrem, qrem_scalar_row)
+VIEW_SCALAR(qview_scalar_and, qand, qand_scalar_row)
+VIEW_SCALAR(qview_scalar_or,  qor,  qor_scalar_row)
+VIEW_SCALAR(qview_scalar_xor, qxor, qxor_scalar_row)
+
+int qview_fma(const qview_t r, const qview_t a, const qview_t b, const qview_t c) {
+	if (!view_same_shape(&a, &b) || !view_same_shape(&a, &c) || !view_same_shape(&r, &a))
+		return -1;
+	const size_t rs = r.column_stride, as = a.column_stride, bs = b.column_stride, cs = c.column_stride;
+	for (size_t i = 0; i < a.rows && a.columns; i++) {
+		q_t *ri = view_at(&r, i, 0);
+		const q_t *ai = view_at(&a, i, 0), *bi = view_at(&b, i, 0), *ci = view_at(&c, i, 0);
+		if (rs == 1 && as == 1 && bs == 1 && cs == 1) {
+			qfma_n(ri, ai, bi, ci, a.columns);
+			continue;
+		}
+		for (size_t j = 0; j < a.columns; j++)
+			ri[j * rs] = qfma(ai[j * as], bi[j * bs], ci[j * cs]);
+	}
+	return 0;
+}
+
+int qview_scalar_fma(const qview_t r, const qview_t a, const q_t scalar, const qview_t c) {
+	if (!view_same_shape(&a, &c) || !view_same_shape(&r, &a))
+		return -1;
+	const size_t rs = r.column_stride, as = a.column_stride, cs = c.column_stride;
+	for (size_t i = 0; i < a.rows && a.columns; i++) {
+		q_t *ri = view_at(&r, i, 0);
+		const q_t *ai = view_at(&a, i, 0), *ci = view_at(&c, i, 0);
+		if (rs == 1 && as == 1 && cs == 1) {
+			qfma_scalar_n(ri, ai, scalar, ci, a.columns);
+			continue;
+		}
+		for (size_t j = 0; j < a.columns; j++)
+			ri[j * rs] = qfma(ai[j * as], scalar, ci[j * cs]);
+	}
+	return 0;
+}
+
+int qview_is_square(const qview_t m) { return m.rows == m.columns; }
+
+int qview_identity(const qview_t r) {
+	if (!qview_is_square(r))
+		return -1;
+	for (size_t i = 0; i < r.rows; i++)
+		for (size_t j = 0; j < r.columns; j++)
+			*view_at(&r, i, j) = i == j ? QINT(1) : QINT(0);
+	return 0;
+}
+
+q_t qview_trace(const qview_t m) {
+	assert(qview_is_square(m));
+	lu_t s = 0;
+	ld_t h = 0;
+	for (size_t i = 0; i < m.rows; i++)
+		wide_add(&s, &h, (ld_t)*view_at(&m, i, i) * QINT(1));
+	return wide_result(s, h, m.rows);
+}
+
+q_t qview_equal(const qview_t a, const qview_t b) {
+	if (!view_same_shape(&a, &b))
+		return QINT(0);
+	for (size_t i = 0; i < a.rows; i++)
+		for (size_t j = 0; j < a.columns; j++)
+			if (*view_at(&a, i, j) != *view_at(&b, i, j))
+				return QINT(0);
+	return QINT(1);
+}
+
 int qmatrix_apply_unary(q_t *r, const q_t *a, q_t (*func)(q_t)) {
 	assert(r);
 	assert(qmatrix_is_valid(r));
 	assert(a);
 	assert(qmatrix_is_valid(a));
 	assert(func);
-       	const q_t *ma = &a[DATA];
-	q_t *mr = &r[DATA];
-	const size_t arows = a[ROW], acolumns = a[COLUMN];
-	if (qmatrix_resize(r, arows, acolumns) < 0)
+	if (qmatrix_resize(r, a[ROW], a[COLUMN]) < 0)
 		return -1;
-	for (size_t i = 0; i < arows; i++)
-		for (size_t j = 0; j < acolumns; j++)
-			mr[i*acolumns + j] = func(ma[i*acolumns + j]);
-	return 0;
+	return qview_apply_unary(qview_matrix(r), view_const(a), func);
 }
 
 int qmatrix_apply_scalar(q_t *r, const q_t *a, q_t (*func)(q_t, q_t), const q_t c) {
@@ -1088,15 +3109,9 @@ int qmatrix_apply_scalar(q_t *r, const q_t *a, q_t (*func)(q_t, q_t), const q_t
 	assert(a);
 	assert(qmatrix_is_valid(a));
 	assert(func);
-       	const q_t *ma = &a[DATA];
-	q_t *mr = &r[DATA];
-	const size_t arows = a[ROW], acolumns = a[COLUMN];
-	if (qmatrix_resize(r, arows, acolumns) < 0)
+	if (qmatrix_resize(r, a[ROW], a[COLUMN]) < 0)
 		return -1;
-	for (size_t i = 0; i < arows; i++)
-		for (size_t j = 0; j < acolumns; j++)
-			mr[i*acolumns + j] = func(ma[i*acolumns + j], c);
-	return 0;
+	return qview_apply_scalar(qview_matrix(r), view_const(a), func, c);
 }
 
 int qmatrix_apply_binary(q_t *r, const q_t *a, const q_t *b, q_t (*func)(q_t, q_t)) {
@@ -1107,47 +3122,80 @@ int qmatrix_apply_binary(q_t *r, const q_t *a, const q_t *b, q_t (*func)(q_t, q_
 	assert(r);
 	assert(qmatrix_is_valid(r));
 	assert(func);
-       	const q_t *ma = &a[DATA], *mb = &b[DATA];
-	q_t *mr = &r[DATA];
-	const size_t arows = a[ROW], acolumns = a[COLUMN];
-	const size_t brows = b[ROW], bcolumns = b[COLUMN];
-	const size_t rrows = r[ROW], rcolumns = r[COLUMN];
-	if (arows != brows || acolumns != bcolumns)
-		return -1;
-	if (arows != rrows || acolumns != rcolumns)
-		return -1;
-	for (size_t i = 0; i < arows; i++)
-		for (size_t j = 0; j < acolumns; j++) {
-			const size_t idx = (i*acolumns) + j;
-			mr[idx] = func(ma[idx], mb[idx]); 
-		}
-	return 0;
-}
+	return qview_apply_binary(qview_matrix(r), view_const(a), view_const(b), func);
+}
+
+#define MATRIX_UNARY(NAME)\
+	int qmatrix_##NAME(q_t *r, const q_t *a) {\
+		assert(r);\
+		assert(qmatrix_is_valid(r));\
+		assert(a);\
+		assert(qmatrix_is_valid(a));\
+		if (qmatrix_resize(r, a[ROW], a[COLUMN]) < 0)\
+			return -1;\
+		return qview_##NAME(qview_matrix(r), view_const(a));\
+	}
 
-static q_t qfz(q_t a) { UNUSED(a); return QINT(0); }
-static q_t qf1(q_t a) { UNUSED(a); return QINT(1); }
+#define MATRIX_SCALAR(NAME)\
+	int qmatrix_##NAME(q_t *r, const q_t *a, const q_t scalar) {\
+		assert(r);\
+		assert(qmatrix_is_valid(r));\
+		assert(a);\
+		assert(qmatrix_is_valid(a));\
+		if (qmatrix_resize(r, a[ROW], a[COLUMN]) < 0)\
+			return -1;\
+		return qview_##NAME(qview_matrix(r), view_const(a), scalar);\
+	}
 
-int qmatrix_zero(q_t *r)    { return qmatrix_apply_unary(r, r, qfz); }
-int qmatrix_one(q_t *r)     { return qmatrix_apply_unary(r, r, qf1); }
-int qmatrix_logical(q_t *r, const q_t *a) { return qmatrix_apply_unary(r, a, qlogical); }
-int qmatrix_not(q_t *r, const q_t *a)     { return qmatrix_apply_unary(r, a, qnot); }
-int qmatrix_signum(q_t *r, const q_t *a)  { return qmatrix_apply_unary(r, a, qsignum); }
-int qmatrix_invert(q_t *r, const q_t *a)  { return qmatrix_apply_unary(r, a, qinvert); }
-int qmatrix_add(q_t *r, const q_t *a, const q_t *b) { return qmatrix_apply_binary(r, a, b, qadd); }
-int qmatrix_sub(q_t *r, const q_t *a, const q_t *b) { return qmatrix_apply_binary(r, a, b, qsub); }
-int qmatrix_and(q_t *r, const q_t *a, const q_t *b) { return qmatrix_apply_binary(r, a, b, qand); }
-int qmatrix_or (q_t *r, const q_t *a, const q_t *b) { return qmatrix_apply_binary(r, a, b, qor); }
-int qmatrix_xor(q_t *r, const q_t *a, const q_t *b) { return qmatrix_apply_binary(r, a, b, qxor); }
-
-int qmatrix_scalar_add(q_t *r, const q_t *a, const q_t scalar) { return qmatrix_apply_scalar(r, a, qadd, scalar); }
-int qmatrix_scalar_sub(q_t *r, const q_t *a, const q_t scalar) { return qmatrix_apply_scalar(r, a, qsub, scalar); }
-int qmatrix_scalar_mul(q_t *r, const q_t *a, const q_t scalar) { return qmatrix_apply_scalar(r, a, qmul, scalar); }
-int qmatrix_scalar_div(q_t *r, const q_t *a, const q_t scalar) { return qmatrix_apply_scalar(r, a, qdiv, scalar); }
-int qmatrix_scalar_mod(q_t *r, const q_t *a, const q_t scalar) { return qmatrix_apply_scalar(r, a, qmod, scalar); }
-int qmatrix_scalar_rem(q_t *r, const q_t *a, const q_t scalar) { return qmatrix_apply_scalar(r, a, qrem, scalar); }
-int qmatrix_scalar_and(q_t *r, const q_t *a, const q_t scalar) { return qmatrix_apply_scalar(r, a, qand, scalar); }
-int qmatrix_scalar_or (q_t *r, const q_t *a, const q_t scalar) { return qmatrix_apply_scalar(r, a, qor,  scalar); }
-int qmatrix_scalar_xor(q_t *r, const q_t *a, const q_t scalar) { return qmatrix_apply_scalar(r, a, qxor, scalar); }
+#define MATRIX_BINARY(NAME)\
+	int qmatrix_##NAME(q_t *r, const q_t *a, const q_t *b) {\
+		assert(r);\
+		assert(qmatrix_is_valid(r));\
+		assert(a);\
+		assert(qmatrix_is_valid(a));\
+		assert(b);\
+		assert(qmatrix_is_valid(b));\
+		return qview_##NAME(qview_matrix(r), view_const(a), view_const(b));\
+	}
+
+int qmatrix_zero(q_t *r) { assert(r); return qview_zero(qview_matrix(r)); }
+int qmatrix_one(q_t *r)  { assert(r); return qview_one(qview_matrix(r)); }
+MATRIX_UNARY(logical)
+MATRIX_UNARY(not)
+MATRIX_UNARY(signum)
+MATRIX_UNARY(invert)
+MATRIX_BINARY(add)
+MATRIX_BINARY(sub)
+MATRIX_BINARY(and)
+MATRIX_BINARY(or)
+MATRIX_BINARY(xor)
+
+MATRIX_SCALAR(scalar_add)
+MATRIX_SCALAR(scalar_sub)
+MATRIX_SCALAR(scalar_mul)
+MATRIX_SCALAR(scalar_div)
+MATRIX_SCALAR(scalar_mod)
+MATRIX_SCALAR(scalar_rem)
+MATRIX_SCALAR(scalar_and)
+MATRIX_SCALAR(scalar_or)
+MATRIX_SCALAR(scalar_xor)
+
+int qmatrix_fma(q_t *r, const q_t *a, const q_t *b, const q_t *c) {
+	assert(r);
+	assert(qmatrix_is_valid(r));
+	assert(a);
+	assert(b);
+	assert(c);
+	return qview_fma(qview_matrix(r), view_const(a), view_const(b), view_const(c));
+}
+
+int qmatrix_scalar_fma(q_t *r, const q_t *a, const q_t scalar, const q_t *c) {
+	assert(r);
+	assert(qmatrix_is_valid(r));
+	assert(a);
+	assert(c);
+	return qview_scalar_fma(qview_matrix(r), view_const(a), scalar, view_const(c));
+}
 
 int qmatrix_is_square(const q_t *m) {
 	assert(m);
@@ -1158,17 +3206,10 @@ int qmatrix_is_square(const q_t *m) {
 int qmatrix_identity(q_t *r) {
 	assert(r);
 	assert(qmatrix_is_valid(r));
-	if (!qmatrix_is_square(r))
-		return -1;
-	q_t *mr = &r[DATA];
-	const size_t length = r[ROW];
-	for (size_t i = 0; i < length; i++)
-		for (size_t j = 0; j < length; j++)
-			mr[i*length + j] = i == j ? QINT(1) : QINT(0);
-	return 0;
+	return qview_identity(qview_matrix(r));
 }
 
-int qmatrix_copy(q_t *r, const q_t *a)  { 
+int qmatrix_copy(q_t *r, const q_t *a)  {
 	assert(r);
 	assert(qmatrix_is_valid(r));
 	assert(a);
@@ -1179,21 +3220,13 @@ int qmatrix_copy(q_t *r, const q_t *a)  {
 		return -1;
 	if (qmatrix_resize(r, arows, acolumns) < 0)
 		return -1;
-	memcpy(&r[DATA], &a[DATA], copy);
-	return 0;
+	return qview_copy(qview_matrix(r), view_const(a));
 }
 
 q_t qmatrix_trace(const q_t *m) {
 	assert(m);
 	assert(qmatrix_is_square(m));
-	const size_t length = m[ROW];
-	const q_t *mm = &m[DATA];
-	q_t tr = QINT(0);
-	for (size_t i = 0; i < length; i++)
-		for (size_t j = 0; j < length; j++)
-			if (i == j)
-				tr = qadd(tr, mm[i*length + j]);
-	return tr;
+	return qview_trace(view_const(m));
 }
 
 q_t qmatrix_equal(const q_t *a, const q_t *b) {
@@ -1201,69 +3234,105 @@ q_t qmatrix_equal(const q_t *a, const q_t *b) {
 	assert(qmatrix_is_valid(a));
 	assert(b);
 	assert(qmatrix_is_valid(b));
-	const size_t arow = a[ROW], acolumn = a[COLUMN];
-	const size_t brow = b[ROW], bcolumn = b[COLUMN];
-	const q_t *ma = &a[DATA];
-	const q_t *mb = &a[DATA];
 	if (a == b)
 		return QINT(1);
-	if (arow != brow && acolumn != bcolumn)
-		return QINT(0);
-	return !memcmp(ma, mb, sizeof(q_t) * arow * brow);
+	return qview_equal(view_const(a), view_const(b));
 }
 
-static q_t determine(const q_t *m, const size_t length) {
+int qmatrix_transpose(q_t *r, const q_t *m) {
+	assert(r);
+	assert(qmatrix_is_valid(r));
 	assert(m);
-	if (length == 1)
-		return m[0];
-	if (length == 2)
-		return qsub(qmul(m[0], m[3]), qmul(m[1], m[2]));
-	size_t co1 = 0, co2 = 0;
-	q_t det = QINT(0), sgn = QINT(1);
-	q_t co[length*length]; /* This should really be passed in */
-	for (size_t i = 0; i < length; i++) {
-		for (size_t j = 0; j < length; j++)
-			for (size_t k = 0; k < length; k++)
-				if (j && k != i) {
-					co[co1*length + co2] = m[j*length + k];
-					if (++co2 > (length - 2)) {
-						co1++;
-						co2 = 0;
-					}
-				}
-		det = qadd(det, qcopysign(qmul(m[(0*length) + i], determine(co, length - 1)), sgn));
-		sgn = qnegate(sgn);	
+	assert(qmatrix_is_valid(m));
+	if (qmatrix_resize(r, m[COLUMN], m[ROW]) < 0)
+		return -1;
+	return qview_copy(qview_matrix(r), qview_transpose(view_const(m)));
+}
+
+/* The sum of products in 'qview_mul' is accumulated exactly, see
+ * 'wide_result', and then rounded and saturated once per element. The
+ * output is computed in strips of 'QMATRIX_STRIP' columns, keeping those
+ * columns of 'b' in the L1 cache whilst 'CONFIG_Q_MATRIX_BLOCK' rows of 'a'
+ * are run over them. */
+#ifdef QV_LANES
+#define QMATRIX_STRIP (QV_LANES)
+#else
+#define QMATRIX_STRIP (4)
+#endif
+
+/* 'w' elements of a row of the result, 'r', from row 'a' and 'w' columns
+ * of 'b', each pointer being followed by the stride between elements */
+static void matrix_strip(q_t *r, const size_t rs, const q_t *a, const size_t as, const q_t *b, const size_t brs, const size_t bcs, const size_t n, const size_t w) {
+	assert(r);
+	assert(a);
+	assert(b);
+	assert(w <= QMATRIX_STRIP);
+	lu_t s[QMATRIX_STRIP] = { 0, };
+	ld_t h[QMATRIX_STRIP] = { 0, };
+#ifdef QV_LANES
+	if (w == QV_LANES && bcs == 1) {
+		qv_acc_t c;
+		qv_acc_zero(&c);
+		for (size_t k = 0; k < n; k++)
+			qv_acc_mac(&c, qv_dup(a[k * as]), qv_load(&b[k * brs]));
+		qv_acc_store(&c, s, h);
+	} else
+#endif
+	if (w == QMATRIX_STRIP && bcs == 1) { /* fixed width, so it can be unrolled */
+		for (size_t k = 0; k < n; k++) {
+			const ld_t x = a[k * as];
+			const q_t *bk = &b[k * brs];
+			for (size_t j = 0; j < QMATRIX_STRIP; j++) {
+				wide_add(&s[j], &h[j], x * bk[j]);
+			}
+		}
+	} else {
+		for (size_t k = 0; k < n; k++) {
+			const ld_t x = a[k * as];
+			const q_t *bk = &b[k * brs];
+			for (size_t j = 0; j < w; j++) {
+				wide_add(&s[j], &h[j], x * bk[j * bcs]);
+			}
+		}
 	}
-	return det;
+	for (size_t j = 0; j < w; j++)
+		r[j * rs] = wide_result(s[j], h[j], n);
 }
 
-q_t qmatrix_determinant(const q_t *m) {
-	assert(m);
-	assert(qmatrix_is_square(m));
-	assert(m[ROW] < 16);
-	const size_t length = m[ROW];
-	const q_t *mm = &m[DATA];
-	return determine(mm, length);
+int qview_mul(const qview_t r, const qview_t a, const qview_t b) {
+	if (a.columns != b.rows || r.rows != a.rows || r.columns != b.columns)
+		return -1;
+	for (size_t ii = 0; ii < a.rows; ii += CONFIG_Q_MATRIX_BLOCK) {
+		const size_t iend = MIN(a.rows, ii + CONFIG_Q_MATRIX_BLOCK);
+		for (size_t j = 0; j < b.columns; j += QMATRIX_STRIP) {
+			const size_t w = MIN((size_t)QMATRIX_STRIP, b.columns - j);
+			const q_t *bj = &b.data[j * b.column_stride];
+			for (size_t i = ii; i < iend; i++) {
+				q_t *rij = view_at(&r, i, j);
+				const q_t *ai = &a.data[i * a.row_stride];
+				matrix_strip(rij, r.column_stride, ai, a.column_stride, bj, b.row_stride, b.column_stride, a.columns, w);
+			}
+		}
+	}
+	return 0;
 }
 
-int qmatrix_transpose(q_t *r, const q_t *m) {
+int qmatrix_mul_rows(q_t *r, const q_t *a, const q_t *b, const size_t first, const size_t last) {
+	assert(a);
+	assert(qmatrix_is_valid(a));
+	assert(b);
+	assert(qmatrix_is_valid(b));
 	assert(r);
 	assert(qmatrix_is_valid(r));
-	assert(m);
-	assert(qmatrix_is_valid(m));
-	q_t *mr = &r[DATA];
-	const q_t *mm = &m[DATA];
-	const size_t mrows = m[ROW], mcolumns = m[COLUMN];
-	const size_t msize = mrows * mcolumns;
-	const size_t rsize = r[LENGTH];
-	if (msize > rsize)
-		return -1;
-	for (size_t i = 0; i < mrows; i++)
-		for (size_t j = 0; j < mcolumns; j++)
-			mr[i*mcolumns + j] = mm[j*mcolumns + i];
-	r[ROW]    = mcolumns;
-	r[COLUMN] = mrows;
-	return 0;
+	const qview_t vr = qview_matrix(r), va = view_const(a);
+	if (va.columns != (size_t)b[ROW])
+		return -1;
+	if (vr.rows != va.rows || vr.columns != (size_t)b[COLUMN])
+		return -1;
+	if (first > last || last > va.rows)
+		return -1;
+	const size_t rows = last - first;
+	return qview_mul(qview_block(vr, first, 0, rows, vr.columns), qview_block(va, first, 0, rows, va.columns), view_const(b));
 }
 
 int qmatrix_mul(q_t *r, const q_t *a, const q_t *b) {
@@ -1273,24 +3342,190 @@ int qmatrix_mul(q_t *r, const q_t *a, const q_t *b) {
 	assert(qmatrix_is_valid(b));
 	assert(r);
 	assert(qmatrix_is_valid(r));
-	q_t *mr = &r[DATA];
-	const q_t *ma = &a[DATA], *mb = &b[DATA];
-	const size_t arows = a[ROW], acolumns = a[COLUMN];
-	const size_t brows = b[ROW], bcolumns = b[COLUMN];
-	if (acolumns != brows)
+	if (a[COLUMN] != b[ROW])
+		return -1;
+	if (qmatrix_resize(r, a[ROW], b[COLUMN]) < 0)
+		return -1;
+	return qview_mul(qview_matrix(r), view_const(a), view_const(b));
+}
+
+/* LU decomposition with partial pivoting, 'P*A = L*U', computed in place
+ * column by column (Crout's ordering). Each element of 'L' and 'U' is a
+ * single dot product accumulated exactly as in 'qview_mul' and rounded
+ * once. 'L' has a unit diagonal which is not stored. The row swaps are
+ * stored after the 'n*n' elements of the decomposition, the row swapped
+ * with row 'j' in step 'j' being at index 'j', so a workspace for an 'n*n'
+ * matrix needs 'n*(n+1)' elements. */
+static q_t matrix_dot_sub(const q_t a, const q_t *x, const size_t xs, const q_t *y, const size_t ys, const size_t n) {
+	assert(x);
+	assert(y);
+	lu_t s = 0; /* round(a - sum x[k]*y[k]) */
+	ld_t h = 0;
+	wide_add(&s, &h, a * ((ld_t)1 << QBITS));
+	for (size_t k = 0; k < n; k++)
+		wide_add(&s, &h, -((ld_t)x[k * xs] * y[k * ys]));
+	return wide_result(s, h, n + 1);
+}
+
+int qview_lu(q_t *lu, const qview_t m) {
+	assert(lu);
+	if (!qview_is_square(m))
+		return -1;
+	const size_t n = m.rows;
+	if ((size_t)lu[LENGTH] < (n * (n + 1)))
+		return -1;
+	lu[ROW] = n;
+	lu[COLUMN] = n;
+	const qview_t v = qview_matrix(lu);
+	q_t *a = v.data, *pivot = &v.data[n * n];
+	if (qview_copy(v, m) < 0)
+		return -1;
+	int r = 0;
+	for (size_t j = 0; j < n; j++) {
+		for (size_t i = 0; i < j; i++)
+			a[i*n + j] = matrix_dot_sub(a[i*n + j], &a[i*n], 1, &a[j], n, i);
+		size_t best = j;
+		ld_t largest = -1;
+		for (size_t i = j; i < n; i++) {
+			const q_t e = matrix_dot_sub(a[i*n + j], &a[i*n], 1, &a[j], n, j);
+			const ld_t magnitude = e < 0 ? -(ld_t)e : e;
+			a[i*n + j] = e;
+			if (magnitude > largest) {
+				largest = magnitude;
+				best = i;
+			}
+		}
+		if (best != j)
+			for (size_t k = 0; k < n; k++) {
+				const q_t t = a[j*n + k];
+				a[j*n + k] = a[best*n + k];
+				a[best*n + k] = t;
+			}
+		pivot[j] = best;
+		const q_t d = a[j*n + j];
+		if (d == 0) { /* singular, the column below is zero as well */
+			r = -1;
+			continue;
+		}
+		for (size_t i = j + 1; i < n; i++)
+			a[i*n + j] = qdiv(a[i*n + j], d);
+	}
+	return r;
+}
+
+int qmatrix_lu(q_t *lu, const q_t *m) {
+	assert(lu);
+	assert(m);
+	assert(lu != m);
+	assert(qmatrix_is_valid(m));
+	return qview_lu(lu, view_const(m));
+}
+
+q_t qmatrix_lu_determinant(const q_t *lu) {
+	assert(lu);
+	assert(qmatrix_is_square(lu));
+	const size_t n = lu[ROW];
+	const q_t *a = &lu[DATA], *pivot = &lu[DATA + (n * n)];
+	q_t det = QINT(1);
+	for (size_t j = 0; j < n; j++) {
+		det = qmul(det, a[j*n + j]);
+		if ((size_t)pivot[j] != j)
+			det = qnegate(det);
+	}
+	return det;
+}
+
+int qview_determinant(q_t *det, const qview_t m, q_t *workspace) {
+	assert(det);
+	assert(workspace);
+	*det = QINT(0);
+	if (!qview_is_square(m))
 		return -1;
-	if (qmatrix_resize(r, arows, bcolumns) < 0)
+	const size_t n = m.rows;
+	if ((size_t)workspace[LENGTH] < (n * (n + 1)))
 		return -1;
-	for (size_t i = 0; i < arows; i++)
-		for (size_t j = 0; j < bcolumns; j++) {
-			q_t s = QINT(0);
-			for (size_t k = 0; k < brows; k++)
-				s = qadd(s, qmul(ma[i*acolumns + k], mb[k*bcolumns + j]));
-			mr[i*arows + j] = s;
+	if (qview_lu(workspace, m) < 0)
+		return 0; /* singular, the determinant is zero */
+	*det = qmatrix_lu_determinant(workspace);
+	return 0;
+}
+
+int qmatrix_determinant(q_t *det, const q_t *m, q_t *workspace) {
+	assert(m);
+	assert(qmatrix_is_valid(m));
+	return qview_determinant(det, view_const(m), workspace);
+}
+
+int qview_solve(const qview_t x, const q_t *lu, const qview_t b) {
+	assert(lu);
+	assert(qmatrix_is_valid(lu));
+	assert(x.data != &lu[DATA]);
+	if (!qmatrix_is_square(lu))
+		return -1;
+	const size_t n = lu[ROW], columns = b.columns;
+	const q_t *a = &lu[DATA], *pivot = &lu[DATA + (n * n)];
+	if (b.rows != n)
+		return -1;
+	if (qview_copy(x, b) < 0)
+		return -1;
+	for (size_t j = 0; j < n; j++) {
+		const size_t p = pivot[j];
+		if (p != j)
+			for (size_t k = 0; k < columns; k++) {
+				q_t *xj = view_at(&x, j, k), *xp = view_at(&x, p, k);
+				const q_t t = *xj;
+				*xj = *xp;
+				*xp = t;
+			}
+	}
+	for (size_t k = 0; k < columns; k++) {
+		const qview_t c = qview_column(x, k);
+		for (size_t i = 0; i < n; i++) {
+			q_t *xi = view_at(&c, i, 0);
+			*xi = matrix_dot_sub(*xi, &a[i*n], 1, c.data, c.row_stride, i);
+		}
+		for (size_t i = n; i-- > 0;) {
+			const q_t d = a[i*n + i];
+			if (d == 0)
+				return -1;
+			q_t *xi = view_at(&c, i, 0);
+			const q_t y = matrix_dot_sub(*xi, &a[i*n + i + 1], 1, xi + c.row_stride, c.row_stride, n - i - 1);
+			*xi = qdiv(y, d);
 		}
+	}
 	return 0;
 }
 
+int qmatrix_solve(q_t *x, const q_t *lu, const q_t *b) {
+	assert(x);
+	assert(lu);
+	assert(b);
+	assert(qmatrix_is_valid(b));
+	assert(x != lu);
+	if (qmatrix_resize(x, b[ROW], b[COLUMN]) < 0)
+		return -1;
+	return qview_solve(qview_matrix(x), lu, view_const(b));
+}
+
+int qview_inverse(const qview_t r, const qview_t a, q_t *workspace) {
+	assert(workspace);
+	if (qview_lu(workspace, a) < 0)
+		return -1;
+	if (!view_same_shape(&r, &a) || qview_identity(r) < 0)
+		return -1;
+	return qview_solve(r, workspace, r);
+}
+
+int qmatrix_inverse(q_t *r, const q_t *a, q_t *workspace) {
+	assert(r);
+	assert(a);
+	assert(workspace);
+	assert(qmatrix_is_valid(a));
+	if (qmatrix_resize(r, a[ROW], a[COLUMN]) < 0)
+		return -1;
+	return qview_inverse(qview_matrix(r), view_const(a), workspace);
+}
+
 static int addchar(char **str, size_t *length, const int ch) {
 	assert(str && *str);
 	assert(length);
@@ -1314,20 +3549,16 @@ static int addstr(char **str, size_t *length, char *addme) {
 	return 0;
 }
 
-int qmatrix_sprintb(const q_t *m, char *str, size_t length, unsigned base) {
+int qview_sprintb(const qview_t m, char *str, size_t length, unsigned base) {
 	assert(str);
-	assert(m);
-       	const q_t *mm = &m[DATA];
-	const size_t rows = m[ROW], columns = m[COLUMN];
+	const size_t rows = m.rows, columns = m.columns;
 	if (base < 2 || base > 36)
 		return -1;
-	if (!qmatrix_is_valid(m))
-		return addstr(&str, &length, "[ INVALID ]");
 	if (addstr(&str, &length, "[ ") < 0)
 		return -1;
 	for (size_t i = 0; i < rows; i++) {
 		for (size_t j = 0; j < columns; j++) {
-			const int r = qsprintb(mm[i*columns + j], str, length, base);
+			const int r = qsprintb(*view_at(&m, i, j), str, length, base);
 			if (r < 0)
 				return -1;
 			if ((length - r) > length)
@@ -1347,53 +3578,816 @@ int qmatrix_sprintb(const q_t *m, char *str, size_t length, unsigned base) {
 	return 0;
 }
 
-size_t qmatrix_string_length(const q_t *m) {
+int qmatrix_sprintb(const q_t *m, char *str, size_t length, unsigned base) {
+	assert(str);
 	assert(m);
+	if (base < 2 || base > 36)
+		return -1;
 	if (!qmatrix_is_valid(m))
-		return 128; /* space for invalid matrix message */
-	const size_t msize = m[LENGTH];
-	const size_t r = (msize * 
-			(32 /*max length if base 2 used)*/ 
+		return addstr(&str, &length, "[ INVALID ]");
+	return qview_sprintb(view_const(m), str, length, base);
+}
+
+static size_t matrix_string_length(const size_t elements) {
+	return (elements *
+			(32 /*max length if base 2 used)*/
 			+ 2 /* '-' and '.' */
 			+ 2 /* space and comma/semi colon separator */
 			)) + 16 /* space for extra formatting */;
-	return r;
 }
 
-/* See <https://github.com/jamesbowman/sincos> 
- * and "Math Toolkit for Real-Time Programming" by Jack Crenshaw 
- *
- * The naming of these functions ('furman_') is incorrect, they do their
- * computation on numbers represented in Furmans but they do not use a 'Furman
- * algorithm'. As I do not have a better name, the name shall stick. */
-static int16_t _sine(const int16_t y) {
-	const int16_t s1 = 0x6487, s3 = -0x2953, s5 = 0x04f8;
-	const int16_t z = arshift((int32_t)y * y, 12);
-	int16_t prod = arshift((int32_t)z * s5, 16);
-	int16_t sum = s3 + prod;
-	prod = arshift((int32_t)z * sum, 16);
-	sum = s1 + prod;
-	return arshift((int32_t)y * sum,  13);
+size_t qview_string_length(const qview_t m) {
+	return matrix_string_length(m.rows * m.columns);
+}
+
+size_t qmatrix_string_length(const q_t *m) {
+	assert(m);
+	if (!qmatrix_is_valid(m))
+		return 128; /* space for invalid matrix message */
+	return matrix_string_length(m[LENGTH]);
+}
+
+/* See the description of the format in 'q.h', the fields are read and
+ * written a byte at a time so the buffer need not be aligned. */
+
+enum { FILE_HEADER = 64, FILE_MATRIX = 48, FILE_VERSION = 1, };
+
+static void put_le(char *b, lu_t v, const size_t bytes) {
+	assert(b);
+	for (size_t i = 0; i < bytes; i++, v >>= CHAR_BIT)
+		b[i] = (char)(v & 0xFFu);
+}
+
+static lu_t get_le(const char *b, const size_t bytes) {
+	assert(b);
+	lu_t v = 0;
+	for (size_t i = bytes; i > 0; i--)
+		v = (v << CHAR_BIT) | (unsigned char)b[i - 1];
+	return v;
+}
+
+static lu_t fletcher64(const char *data, const size_t words) {
+	assert(data || !words);
+	lu_t a = 0, b = 0;
+	for (size_t i = 0; i < words;) { /* reduce rarely, 'b' cannot overflow in 1024 words */
+		const size_t block = MIN(words - i, (size_t)1024);
+		for (size_t j = 0; j < block; j++, i++) {
+			a += get_le(&data[i * sizeof (q_t)], sizeof (q_t));
+			b += a;
+		}
+		a %= 0xFFFFFFFFull;
+		b %= 0xFFFFFFFFull;
+	}
+	return (b << 32) | a;
+}
+
+size_t qfile_size(const size_t rows, const size_t columns) {
+	const size_t elements = rows * columns;
+	if (rows && elements / rows != columns)
+		return 0;
+	if (elements > (size_t)DMAX || elements > ((SIZE_MAX - FILE_HEADER) / sizeof (q_t)))
+		return 0;
+	return FILE_HEADER + (elements * sizeof (q_t));
+}
+
+int qfile_pack(char *file, const size_t length, const qview_t m) {
+	assert(file);
+	const size_t size = qfile_size(m.rows, m.columns);
+	if (!size || size > length)
+		return -1;
+	memset(file, 0, FILE_HEADER);
+	memcpy(file, "QARR", 4);
+	put_le(&file[4], FILE_VERSION, 2);
+	put_le(&file[6], QBITS, 1);
+	put_le(&file[7], QBITS, 1);
+	put_le(&file[8], FILE_HEADER, 4);
+	put_le(&file[16], m.rows, 4);
+	put_le(&file[20], m.columns, 4);
+	const q_t header[] = { 0, m.rows * m.columns, m.rows, m.columns, };
+	if (qpack_n(header, 4, &file[FILE_MATRIX], sizeof (header)) < 0)
+		return -1;
+	char *data = &file[FILE_HEADER];
+	for (size_t i = 0; i < m.rows; i++) {
+		char *row = &data[i * m.columns * sizeof (q_t)];
+		if (m.column_stride == 1) {
+			if (qpack_n(view_at(&m, i, 0), m.columns, row, m.columns * sizeof (q_t)) < 0)
+				return -1;
+			continue;
+		}
+		for (size_t j = 0; j < m.columns; j++)
+			qpack(view_at(&m, i, j), &row[j * sizeof (q_t)], sizeof (q_t));
+	}
+	put_le(&file[24], fletcher64(data, m.rows * m.columns), 8);
+	return 0;
+}
+
+int qfile_check(const char *file, const size_t length, size_t *rows, size_t *columns) {
+	assert(file);
+	if (length < FILE_HEADER || memcmp(file, "QARR", 4))
+		return -1;
+	if (get_le(&file[4], 2) != FILE_VERSION || get_le(&file[6], 1) != QBITS || get_le(&file[7], 1) != QBITS)
+		return -1;
+	const size_t offset = get_le(&file[8], 4), r = get_le(&file[16], 4), c = get_le(&file[20], 4);
+	const size_t size = qfile_size(r, c);
+	if (offset != FILE_HEADER || !size || size > length)
+		return -1; /* larger headers are allowed by the format, but not produced yet */
+	if (get_le(&file[FILE_MATRIX + 4], 4) != r * c || get_le(&file[FILE_MATRIX + 8], 4) != r || get_le(&file[FILE_MATRIX + 12], 4) != c)
+		return -1;
+	if (rows)
+		*rows = r;
+	if (columns)
+		*columns = c;
+	return 0;
+}
+
+int qfile_verify(const char *file, const size_t length) {
+	assert(file);
+	size_t rows = 0, columns = 0;
+	if (qfile_check(file, length, &rows, &columns) < 0)
+		return -1;
+	return fletcher64(&file[FILE_HEADER], rows * columns) == get_le(&file[24], 8) ? 0 : -1;
+}
+
+q_t *qfile_matrix(char *file, const size_t length) {
+	assert(file);
+	if (!little_endian() || ((uintptr_t)file % sizeof (q_t)))
+		return NULL;
+	if (qfile_check(file, length, NULL, NULL) < 0)
+		return NULL;
+	return (q_t*)&file[FILE_MATRIX];
+}
+
+int qfile_view(char *file, const size_t length, qview_t *v) {
+	assert(v);
+	q_t *m = qfile_matrix(file, length);
+	if (!m)
+		return -1;
+	*v = qview_matrix(m);
+	return 0;
+}
+
+int qfile_unpack(q_t *m, const char *file, const size_t length) {
+	assert(m);
+	assert(file);
+	size_t rows = 0, columns = 0;
+	if (qfile_check(file, length, &rows, &columns) < 0)
+		return -1;
+	if (qmatrix_resize(m, rows, columns) < 0)
+		return -1;
+	return qunpack_n(&m[DATA], rows * columns, &file[FILE_HEADER], length - FILE_HEADER) < 0 ? -1 : 0;
+}
+
+/* See <https://github.com/jamesbowman/sincos> 
+ * and "Math Toolkit for Real-Time Programming" by Jack Crenshaw 
+ *
+ * The naming of these functions ('furman_') is incorrect, they do their
+ * computation on numbers represented in Furmans but they do not use a 'Furman
+ * algorithm'. As I do not have a better name, the name shall stick. */
+enum { /* polynomial coefficients, shared with the SIMD version */
+	FURMAN_S1 = 0x6487, FURMAN_S3 = -0x2953, FURMAN_S5 = 0x04f8,
+	FURMAN_C0 = 0x7fff, FURMAN_C2 = -0x4ee9, FURMAN_C4 = 0x0fbd,
+};
+
+static int16_t _sine(const int16_t y) {
+	const int16_t s1 = FURMAN_S1, s3 = FURMAN_S3, s5 = FURMAN_S5;
+	const int16_t z = arshift((int32_t)y * y, 12);
+	int16_t prod = arshift((int32_t)z * s5, 16);
+	int16_t sum = s3 + prod;
+	prod = arshift((int32_t)z * sum, 16);
+	sum = s1 + prod;
+	return arshift((int32_t)y * sum,  13);
+}
+
+static int16_t _cosine(int16_t y) {
+	const int16_t c0 = FURMAN_C0, c2 = FURMAN_C2, c4 = FURMAN_C4;
+	const int16_t z = arshift((int32_t)y * y, 12);
+	int16_t prod = arshift((int32_t)z * c4,  16);
+	const int16_t sum = c2 + prod;
+	prod = arshift((int32_t)z * sum, 15);
+	return c0 + prod;
+}
+
+int16_t furman_sin(int16_t x) {
+	const int16_t n = 3 & arshift(x + 0x2000, 14);
+	x -= n << 14;
+	const int16_t r = (n & 1) ? _cosine(x) : _sine(x);
+	return (n & 2) ? -r : r;
+}
+
+int16_t furman_cos(int16_t x) {
+	return furman_sin(x + 0x4000);
+}
+
+/* A numerically controlled oscillator keeps its phase in 1/2^32 of a circle
+ * and adds the increment after each sample, so the frequency is exact to
+ * 'rate/2^32' and the phase never drifts. Samples are 'furman_sin' of the
+ * phase rounded to 16 bits, or, if a table is given, linearly interpolated
+ * between its entries; the phase wraps for free in unsigned arithmetic
+ * instead of being folded into range as 'qsincos' must. Without a table the
+ * polynomial is evaluated for a whole vector of phases at a time where there
+ * are SIMD instructions, all of its intermediate values fit in 32-bit lanes,
+ * so the results are identical to the scalar version. */
+
+#define NCO_QUARTER (0x40000000uL)
+
+static inline q_t nco_sine(const u_t phase) {
+	return (q_t)furman_sin((int16_t)((phase + 0x8000uL) >> 16)) * 2;
+}
+
+static inline q_t nco_table(const qnco_t *o, const u_t phase) {
+	const u_t mask = (1uL << o->bits) - 1uL;
+	const u_t i = phase >> (32 - o->bits), frac = (u_t)(phase << o->bits) >> 16;
+	const ld_t a = o->table[i], b = o->table[(i + 1) & mask];
+	return a + ldivn(((b - a) * frac) + 0x8000, 16);
+}
+
+#ifdef QV_LANES
+static inline qv_t qv_furman_sin(const qv_t x) { /* 'furman_sin' of sign extended 16-bit lanes */
+	const qv_t n = qv_and(qv_sra(qv_wadd(x, qv_dup(0x2000)), 14), qv_dup(3));
+	const qv_t y = qv_sra(qv_sll(qv_wsub(x, qv_sll(n, 14)), 16), 16); /* 'x -= n << 14' in 16 bits */
+	const qv_t z = qv_sra(qv_wmul(y, y), 12);
+	qv_t prod = qv_sra(qv_wmul(z, qv_dup(FURMAN_S5)), 16);
+	prod = qv_sra(qv_wmul(z, qv_wadd(qv_dup(FURMAN_S3), prod)), 16);
+	const qv_t sine = qv_sra(qv_wmul(y, qv_wadd(qv_dup(FURMAN_S1), prod)), 13);
+	prod = qv_sra(qv_wmul(z, qv_dup(FURMAN_C4)), 16);
+	prod = qv_sra(qv_wmul(z, qv_wadd(qv_dup(FURMAN_C2), prod)), 15);
+	const qv_t cosine = qv_wadd(qv_dup(FURMAN_C0), prod);
+	const qv_t zero = qv_dup(0);
+	const qv_t r = qv_select(qv_wsub(zero, qv_and(n, qv_dup(1))), cosine, sine);
+	return qv_select(qv_wsub(zero, qv_sra(n, 1)), qv_wsub(zero, r), r);
+}
+#endif
+
+static void nco_fill(const qnco_t *o, u_t phase, q_t *r, const size_t n) {
+	assert(o);
+	assert(r);
+	implies(o->table != NULL, o->bits >= 1 && o->bits <= 16);
+	size_t i = 0;
+	if (o->table) {
+		for (; i < n; i++, phase += o->increment)
+			r[i] = nco_table(o, phase);
+		return;
+	}
+#ifdef QV_LANES
+	if (n >= QV_LANES) {
+		q_t lanes[QV_LANES];
+		for (size_t k = 0; k < QV_LANES; k++) /* with the rounding of the phase to 16 bits */
+			lanes[k] = (q_t)(phase + (u_t)k * o->increment + 0x8000uL);
+		const qv_t step = qv_dup((q_t)((u_t)QV_LANES * o->increment));
+		qv_t p = qv_load(lanes);
+		for (; (i + QV_LANES) <= n; i += QV_LANES) {
+			qv_store(&r[i], qv_sll(qv_furman_sin(qv_sra(p, 16)), 1));
+			p = qv_wadd(p, step);
+		}
+		phase += (u_t)i * o->increment;
+	}
+#endif
+	for (; i < n; i++, phase += o->increment)
+		r[i] = nco_sine(phase);
+}
+
+void qnco_init(qnco_t *o, const q_t frequency, const q_t rate) {
+	assert(o);
+	assert(qmore(rate, QINT(0)));
+	const lu_t f = frequency < 0 ? -(lu_t)(ld_t)frequency : (lu_t)frequency;
+	const u_t increment = ((f << 32) + ((lu_t)rate / 2)) / (lu_t)rate;
+	o->phase = 0;
+	o->increment = frequency < 0 ? -increment : increment;
+	o->table = NULL;
+	o->bits = 0;
+}
+
+void qnco_sin_n(qnco_t *o, q_t *sine, const size_t n) {
+	assert(o);
+	assert(sine);
+	nco_fill(o, o->phase, sine, n);
+	o->phase += (u_t)n * o->increment;
+}
+
+void qnco_cos_n(qnco_t *o, q_t *cosine, const size_t n) {
+	assert(o);
+	assert(cosine);
+	nco_fill(o, o->phase + NCO_QUARTER, cosine, n);
+	o->phase += (u_t)n * o->increment;
+}
+
+void qnco_iq_n(qnco_t *o, q_t *i, q_t *q, const size_t n) {
+	assert(o);
+	assert(i);
+	assert(q);
+	nco_fill(o, o->phase + NCO_QUARTER, i, n);
+	nco_fill(o, o->phase, q, n);
+	o->phase += (u_t)n * o->increment;
+}
+
+/********* Fast Fourier Transform ********************************************/
+/* The transforms work in place on interleaved complex numbers (real then
+ * imaginary). The input is put into bit reversed order and then combined in
+ * passes, each of which does two radix-2 stages at once (a radix-4 butterfly
+ * on four points at a time, in what is sometimes called radix-2^2), with a
+ * single radix-2 pass first if the size is an odd power of two. The twiddle
+ * factors come from the plan, 'cos' and '-sin' of '2*pi*k/n' for k < n/2,
+ * the transforms of smaller sizes use every 'n/m'th one.
+ *
+ * Scaling is block floating point: each pass keeps track of the largest
+ * magnitude it produces, and the next pass halves its inputs as it reads them
+ * as many times as needed to make room for its growth, at most '1 + sqrt(2)'
+ * for a radix-2 stage and its square for a radix-4 pass. The results are in
+ * range as long as that holds, so nothing saturates, and the number of
+ * halvings is returned as an exponent, the true result being the output
+ * times '2^exponent'. Inputs of small magnitude are not scaled up. The real
+ * transforms do a complex transform of half the size on the even and odd
+ * samples and then separate the two, see "Numerical Recipes", 12.3. */
+
+#define FFT_LIMIT2 (1uL << 29) /* largest magnitude before a radix-2 stage */
+#define FFT_LIMIT4 (1uL << 28) /* largest magnitude before a radix-4 pass */
+
+typedef struct { q_t lo, hi; } fft_range_t;
+
+static inline void fft_track(fft_range_t *r, const q_t v) {
+	r->lo = MIN(r->lo, v);
+	r->hi = MAX(r->hi, v);
+}
+
+static inline void fft_range_init(fft_range_t *r) {
+	r->lo = DMAX;
+	r->hi = DMIN;
+}
+
+static unsigned fft_shift(const fft_range_t *r, const lu_t limit) { /* halvings needed to be under 'limit' */
+	const lu_t m = MAX((ld_t)r->hi, -(ld_t)r->lo);
+	unsigned s = 0;
+	while ((m >> s) >= (limit - 1))
+		s++;
+	return s;
+}
+
+static inline q_t fft_scale(const q_t v, const unsigned s) { /* divide by 2^s, rounding */
+	return s ? arshift(v, s) + (arshift(v, s - 1) & 1) : v;
+}
+
+static inline q_t fft_half(const ld_t v) { return ldivn(v + 1, 1); }
+
+static inline void fft_cmul(const q_t ar, const q_t ai, const q_t wr, const q_t wi, q_t *r, q_t *i) {
+	*r = (q_t)ldivn(((ld_t)ar * wr) - ((ld_t)ai * wi) + (ld_t)QHIGH, QBITS);
+	*i = (q_t)ldivn(((ld_t)ar * wi) + ((ld_t)ai * wr) + (ld_t)QHIGH, QBITS);
+}
+
+static void fft_range(fft_range_t *r, const q_t *x, const size_t n) {
+	fft_range_init(r);
+	for (size_t i = 0; i < n; i++)
+		fft_track(r, x[i]);
+}
+
+static void fft_reverse(q_t *x, const size_t m) { /* bit reverse the order of 'm' complex numbers */
+	for (size_t i = 0, j = 0; i < m; i++) {
+		if (i < j) {
+			const q_t r = x[2*i], im = x[2*i + 1];
+			x[2*i] = x[2*j], x[2*i + 1] = x[2*j + 1];
+			x[2*j] = r, x[2*j + 1] = im;
+		}
+		size_t bit = m >> 1;
+		for (; j & bit; bit >>= 1)
+			j ^= bit;
+		j |= bit;
+	}
+}
+
+static void fft_radix2(q_t *x, const size_t m, const unsigned s, fft_range_t *r) { /* first stage, all twiddles are one */
+	for (size_t i = 0; i < (2 * m); i += 4) {
+		const q_t ar = fft_scale(x[i],     s), ai = fft_scale(x[i + 1], s);
+		const q_t br = fft_scale(x[i + 2], s), bi = fft_scale(x[i + 3], s);
+		x[i] = ar + br, x[i + 1] = ai + bi;
+		x[i + 2] = ar - br, x[i + 3] = ai - bi;
+		fft_track(r, x[i]), fft_track(r, x[i + 1]), fft_track(r, x[i + 2]), fft_track(r, x[i + 3]);
+	}
+}
+
+static inline void fft_butterfly4(q_t *x, const size_t h, const q_t *w1, const q_t *w2, const unsigned s, fft_range_t *r) {
+	q_t *a = &x[0], *b = &x[2 * h], *c = &x[4 * h], *d = &x[6 * h];
+	const q_t ar = fft_scale(a[0], s), ai = fft_scale(a[1], s), br = fft_scale(b[0], s), bi = fft_scale(b[1], s);
+	const q_t cr = fft_scale(c[0], s), ci = fft_scale(c[1], s), dr = fft_scale(d[0], s), di = fft_scale(d[1], s);
+	q_t tr = 0, ti = 0;
+	fft_cmul(br, bi, w1[0], w1[1], &tr, &ti);
+	const q_t a1r = ar + tr, a1i = ai + ti, b1r = ar - tr, b1i = ai - ti;
+	fft_cmul(dr, di, w1[0], w1[1], &tr, &ti);
+	const q_t c1r = cr + tr, c1i = ci + ti, d1r = cr - tr, d1i = ci - ti;
+	fft_cmul(c1r, c1i, w2[0], w2[1], &tr, &ti);
+	a[0] = a1r + tr, a[1] = a1i + ti, c[0] = a1r - tr, c[1] = a1i - ti;
+	fft_cmul(d1r, d1i, w2[0], w2[1], &tr, &ti); /* times -i, 'W(4h)^(j+h)' is 'W(4h)^j * -i' */
+	b[0] = b1r + ti, b[1] = b1i - tr, d[0] = b1r - ti, d[1] = b1i + tr;
+	fft_track(r, a[0]), fft_track(r, a[1]), fft_track(r, b[0]), fft_track(r, b[1]);
+	fft_track(r, c[0]), fft_track(r, c[1]), fft_track(r, d[0]), fft_track(r, d[1]);
+}
+
+#if defined(QV_LANES) && defined(QV_COMPLEX)
+static inline qv_t qv_fft_scale(const qv_t v, const unsigned s) {
+	return s ? qv_wadd(qv_sra(v, s), qv_and(qv_sra(v, s - 1), qv_dup(1))) : v;
+}
+#endif
+
+static void fft_radix4(const qfft_t *p, q_t *x, const size_t m, const size_t h, const unsigned s, fft_range_t *r) {
+	const size_t s1 = p->n / (2 * h), s2 = p->n / (4 * h); /* twiddle strides for 'W(2h)' and 'W(4h)' */
+	const q_t *t = p->twiddle;
+	for (size_t g = 0; g < m; g += 4 * h) {
+		size_t j = 0;
+#if defined(QV_LANES) && defined(QV_COMPLEX)
+		enum { LANES = QV_LANES / 2, };
+		if (h >= LANES) {
+			qv_t lo = qv_dup(r->lo), hi = qv_dup(r->hi);
+			for (; (j + LANES) <= h; j += LANES) {
+				q_t w1[QV_LANES], w2[QV_LANES];
+				for (size_t k = 0; k < LANES; k++) {
+					w1[2*k] = t[2*(j + k)*s1], w1[2*k + 1] = t[2*(j + k)*s1 + 1];
+					w2[2*k] = t[2*(j + k)*s2], w2[2*k + 1] = t[2*(j + k)*s2 + 1];
+				}
+				q_t *a = &x[2*(g + j)], *b = &a[2 * h], *c = &a[4 * h], *d = &a[6 * h];
+				const qv_t va = qv_fft_scale(qv_load(a), s), vb = qv_fft_scale(qv_load(b), s);
+				const qv_t vc = qv_fft_scale(qv_load(c), s), vd = qv_fft_scale(qv_load(d), s);
+				const qv_t vw1 = qv_load(w1), vw2 = qv_load(w2);
+				qv_t vt = qv_cmul(vb, vw1);
+				const qv_t a1 = qv_wadd(va, vt), b1 = qv_wsub(va, vt);
+				vt = qv_cmul(vd, vw1);
+				const qv_t c1 = qv_wadd(vc, vt), d1 = qv_wsub(vc, vt);
+				vt = qv_cmul(c1, vw2);
+				const qv_t a2 = qv_wadd(a1, vt), c2 = qv_wsub(a1, vt);
+				vt = qv_rot(qv_cmul(d1, vw2));
+				const qv_t b2 = qv_wadd(b1, vt), d2 = qv_wsub(b1, vt);
+				qv_store(a, a2), qv_store(b, b2), qv_store(c, c2), qv_store(d, d2);
+				lo = qv_min(qv_min(qv_min(lo, a2), qv_min(b2, c2)), d2);
+				hi = qv_max(qv_max(qv_max(hi, a2), qv_max(b2, c2)), d2);
+			}
+			q_t l[QV_LANES], u[QV_LANES];
+			qv_store(l, lo), qv_store(u, hi);
+			for (size_t k = 0; k < QV_LANES; k++)
+				fft_track(r, l[k]), fft_track(r, u[k]);
+		}
+#endif
+		for (; j < h; j++)
+			fft_butterfly4(&x[2*(g + j)], h, &t[2*j*s1], &t[2*j*s2], s, r);
+	}
+}
+
+static int fft_complex(const qfft_t *p, q_t *x, const size_t m) { /* returns the exponent */
+	assert(p);
+	assert(x);
+	assert(m && m <= p->n && !(m & (m - 1)));
+	fft_reverse(x, m);
+	fft_range_t r;
+	fft_range(&r, x, 2 * m);
+	int exponent = 0;
+	size_t h = 1, bits = 0;
+	while (((size_t)1 << bits) < m)
+		bits++;
+	if (bits & 1) {
+		const unsigned s = fft_shift(&r, FFT_LIMIT2);
+		fft_range_init(&r);
+		fft_radix2(x, m, s, &r);
+		exponent += s;
+		h = 2;
+	}
+	for (; h < m; h *= 4) {
+		const unsigned s = fft_shift(&r, FFT_LIMIT4);
+		fft_range_init(&r);
+		fft_radix4(p, x, m, h, s, &r);
+		exponent += s;
+	}
+	return exponent;
+}
+
+static void fft_conjugate(q_t *x, const size_t m) {
+	for (size_t i = 0; i < m; i++)
+		x[2*i + 1] = -x[2*i + 1];
+}
+
+int qfft_init(qfft_t *p, q_t *twiddle, const size_t n) {
+	assert(p);
+	assert(twiddle);
+	if (n < 2 || (n & (n - 1)) || n > ((size_t)1 << 24))
+		return -1;
+	p->n = n;
+	p->twiddle = twiddle;
+	const size_t quarter = n / 4, eighth = n / 8;
+	for (size_t k = 0; k < (n / 2); k++) { /* first octant only, the rest by symmetry so 1, -i, etc. are exact */
+		size_t a = k;
+		const int flip = a > quarter;
+		if (flip)
+			a = (n / 2) - a;
+		const int swap = a > eighth;
+		if (swap)
+			a = quarter - a;
+		q_t sine = QINT(0), cosine = QINT(1);
+		if (a) {
+			const q_t theta = (((ld_t)2 * QPI * (ld_t)a) + (ld_t)(n / 2)) / (ld_t)n;
+			qsincos(theta, &sine, &cosine);
+		}
+		if (swap) {
+			const q_t t = sine;
+			sine = cosine;
+			cosine = t;
+		}
+		twiddle[2*k] = flip ? -cosine : cosine;
+		twiddle[2*k + 1] = -sine;
+	}
+	return 0;
+}
+
+int qfft(const qfft_t *p, q_t *x, int *exponent) {
+	assert(p);
+	assert(x);
+	assert(exponent);
+	*exponent = fft_complex(p, x, p->n);
+	return 0;
+}
+
+int qifft(const qfft_t *p, q_t *x, int *exponent) {
+	assert(p);
+	assert(x);
+	assert(exponent);
+	int bits = 0;
+	while (((size_t)1 << bits) < p->n)
+		bits++;
+	fft_conjugate(x, p->n);
+	*exponent = fft_complex(p, x, p->n) - bits;
+	fft_conjugate(x, p->n);
+	return 0;
+}
+
+int qfft_real(const qfft_t *p, q_t *x, int *exponent) {
+	assert(p);
+	assert(x);
+	assert(exponent);
+	const size_t m = p->n / 2;
+	const int e = fft_complex(p, x, m);
+	fft_range_t r;
+	fft_range(&r, x, p->n);
+	const unsigned s = fft_shift(&r, FFT_LIMIT2);
+	const q_t r0 = fft_scale(x[0], s), i0 = fft_scale(x[1], s);
+	x[0] = r0 + i0; /* DC and Nyquist are both real, they share the first bin */
+	x[1] = r0 - i0;
+	for (size_t k = 1; k <= (m / 2); k++) {
+		q_t *a = &x[2 * k], *b = &x[2 * (m - k)];
+		const q_t ar = fft_scale(a[0], s), ai = fft_scale(a[1], s), br = fft_scale(b[0], s), bi = fft_scale(b[1], s);
+		const q_t er = fft_half((ld_t)ar + br), ei = fft_half((ld_t)ai - bi); /* even samples */
+		const q_t odr = fft_half((ld_t)ai + bi), odi = fft_half((ld_t)br - ar); /* odd samples */
+		q_t tr = 0, ti = 0;
+		fft_cmul(odr, odi, p->twiddle[2 * k], p->twiddle[2 * k + 1], &tr, &ti);
+		a[0] = er + tr, a[1] = ei + ti;
+		b[0] = er - tr, b[1] = ti - ei;
+	}
+	*exponent = e + (int)s;
+	return 0;
+}
+
+int qifft_real(const qfft_t *p, q_t *x, int *exponent) {
+	assert(p);
+	assert(x);
+	assert(exponent);
+	const size_t m = p->n / 2;
+	int bits = 0;
+	while (((size_t)1 << bits) < m)
+		bits++;
+	fft_range_t r;
+	fft_range(&r, x, p->n);
+	const unsigned s = fft_shift(&r, FFT_LIMIT2);
+	const q_t dc = fft_scale(x[0], s), nyquist = fft_scale(x[1], s);
+	x[0] = fft_half((ld_t)dc + nyquist);
+	x[1] = fft_half((ld_t)dc - nyquist);
+	for (size_t k = 1; k <= (m / 2); k++) {
+		q_t *a = &x[2 * k], *b = &x[2 * (m - k)];
+		const q_t ar = fft_scale(a[0], s), ai = fft_scale(a[1], s), br = fft_scale(b[0], s), bi = fft_scale(b[1], s);
+		const q_t er = fft_half((ld_t)ar + br), ei = fft_half((ld_t)ai - bi);
+		const q_t dr = fft_half((ld_t)ar - br), di = fft_half((ld_t)ai + bi);
+		q_t odr = 0, odi = 0;
+		fft_cmul(dr, di, p->twiddle[2 * k], -p->twiddle[2 * k + 1], &odr, &odi);
+		a[0] = er - odi, a[1] = ei + odr; /* even + i * odd */
+		b[0] = er + odi, b[1] = odr - ei;
+	}
+	fft_conjugate(x, m);
+	const int e = fft_complex(p, x, m);
+	fft_conjugate(x, m);
+	*exponent = e + (int)s - bits;
+	return 0;
+}
+
+void qfft_polar(const q_t *x, q_t *magnitude, q_t *phase, const size_t n) {
+	assert(x);
+	assert(magnitude);
+	assert(phase);
+	for (size_t o = 0; o < n; o += CORDIC_BLOCK) {
+		const size_t m = MIN(n - o, (size_t)CORDIC_BLOCK);
+		q_t re[CORDIC_BLOCK], im[CORDIC_BLOCK];
+		for (size_t k = 0; k < m; k++) {
+			re[k] = x[2 * (o + k)];
+			im[k] = x[2 * (o + k) + 1];
+		}
+		qrec2pol_n(re, im, &magnitude[o], &phase[o], m);
+	}
+}
+
+/********* Table Driven Functions ********************************************/
+/* A cheaper alternative to the CORDIC routines when a documented error bound
+ * is good enough; a table lookup and one multiply. Each table has 256
+ * segments (and an end point) in Q2.30 and the result is linearly
+ * interpolated between neighbouring entries. The measured error of each
+ * function is given in the readme. */
+
+#define LUT_BITS (8)             /* log2 of number of segments in each table */
+#define LUT_FRAC (30 - LUT_BITS) /* Q2.30 bits left over for interpolation */
+#define LUT_MASK ((1uL << LUT_FRAC) - 1uL)
+
+static const u_t lut_sine[] = { /* sin((pi/2)*(i/256)) in Q2.30 */
+	0x00000000uL, 0x006487C4uL, 0x00C90E90uL, 0x012D936CuL, 0x0192155FuL, 0x01F69373uL,
+	0x025B0CAFuL, 0x02BF801AuL, 0x0323ECBEuL, 0x038851A2uL, 0x03ECADCFuL, 0x0451004DuL,
+	0x04B54825uL, 0x0519845EuL, 0x057DB403uL, 0x05E1D61BuL, 0x0645E9AFuL, 0x06A9EDC9uL,
+	0x070DE172uL, 0x0771C3B3uL, 0x07D59396uL, 0x08395024uL, 0x089CF867uL, 0x09008B6AuL,
+	0x09640837uL, 0x09C76DD8uL, 0x0A2ABB59uL, 0x0A8DEFC3uL, 0x0AF10A22uL, 0x0B540982uL,
+	0x0BB6ECEFuL, 0x0C19B374uL, 0x0C7C5C1EuL, 0x0CDEE5F9uL, 0x0D415013uL, 0x0DA39978uL,
+	0x0E05C135uL, 0x0E67C65AuL, 0x0EC9A7F3uL, 0x0F2B650FuL, 0x0F8CFCBEuL, 0x0FEE6E0DuL,
+	0x104FB80EuL, 0x10B0D9D0uL, 0x1111D263uL, 0x1172A0D7uL, 0x11D3443FuL, 0x1233BBACuL,
+	0x1294062FuL, 0x12F422DBuL, 0x135410C3uL, 0x13B3CEFAuL, 0x14135C94uL, 0x1472B8A5uL,
+	0x14D1E242uL, 0x1530D881uL, 0x158F9A76uL, 0x15EE2738uL, 0x164C7DDDuL, 0x16AA9D7EuL,
+	0x17088531uL, 0x1766340FuL, 0x17C3A931uL, 0x1820E3B0uL, 0x187DE2A7uL, 0x18DAA52FuL,
+	0x19372A64uL, 0x19937161uL, 0x19EF7944uL, 0x1A4B4128uL, 0x1AA6C82BuL, 0x1B020D6CuL,
+	0x1B5D100AuL, 0x1BB7CF23uL, 0x1C1249D8uL, 0x1C6C7F4AuL, 0x1CC66E99uL, 0x1D2016E9uL,
+	0x1D79775CuL, 0x1DD28F15uL, 0x1E2B5D38uL, 0x1E83E0EBuL, 0x1EDC1953uL, 0x1F340596uL,
+	0x1F8BA4DCuL, 0x1FE2F64CuL, 0x2039F90FuL, 0x2090AC4DuL, 0x20E70F32uL, 0x213D20E8uL,
+	0x2192E09BuL, 0x21E84D76uL, 0x223D66A8uL, 0x22922B5EuL, 0x22E69AC8uL, 0x233AB414uL,
+	0x238E7673uL, 0x23E1E117uL, 0x2434F332uL, 0x2487ABF7uL, 0x24DA0A9AuL, 0x252C0E4FuL,
+	0x257DB64CuL, 0x25CF01C8uL, 0x261FEFFAuL, 0x2670801AuL, 0x26C0B162uL, 0x2710830CuL,
+	0x275FF452uL, 0x27AF0472uL, 0x27FDB2A7uL, 0x284BFE2FuL, 0x2899E64AuL, 0x28E76A37uL,
+	0x29348937uL, 0x2981428CuL, 0x29CD9578uL, 0x2A19813FuL, 0x2A650525uL, 0x2AB02071uL,
+	0x2AFAD269uL, 0x2B451A55uL, 0x2B8EF77DuL, 0x2BD8692BuL, 0x2C216EAAuL, 0x2C6A0746uL,
+	0x2CB2324CuL, 0x2CF9EF09uL, 0x2D413CCDuL, 0x2D881AE8uL, 0x2DCE88AAuL, 0x2E148566uL,
+	0x2E5A1070uL, 0x2E9F291BuL, 0x2EE3CEBEuL, 0x2F2800AFuL, 0x2F6BBE45uL, 0x2FAF06DAuL,
+	0x2FF1D9C7uL, 0x30343667uL, 0x30761C18uL, 0x30B78A36uL, 0x30F8801FuL, 0x3138FD35uL,
+	0x317900D6uL, 0x31B88A66uL, 0x31F79948uL, 0x32362CE0uL, 0x32744493uL, 0x32B1DFC9uL,
+	0x32EEFDEAuL, 0x332B9E5EuL, 0x3367C090uL, 0x33A363ECuL, 0x33DE87DEuL, 0x34192BD5uL,
+	0x34534F41uL, 0x348CF190uL, 0x34C61236uL, 0x34FEB0A5uL, 0x3536CC52uL, 0x356E64B2uL,
+	0x35A5793CuL, 0x35DC0968uL, 0x361214B0uL, 0x36479A8EuL, 0x367C9A7EuL, 0x36B113FDuL,
+	0x36E5068AuL, 0x371871A5uL, 0x374B54CEuL, 0x377DAF89uL, 0x37AF8159uL, 0x37E0C9C3uL,
+	0x3811884DuL, 0x3841BC7FuL, 0x387165E3uL, 0x38A08402uL, 0x38CF1669uL, 0x38FD1CA4uL,
+	0x392A9642uL, 0x395782D3uL, 0x3983E1E8uL, 0x39AFB313uL, 0x39DAF5E8uL, 0x3A05A9FDuL,
+	0x3A2FCEE8uL, 0x3A596442uL, 0x3A8269A3uL, 0x3AAADEA6uL, 0x3AD2C2E8uL, 0x3AFA1605uL,
+	0x3B20D79EuL, 0x3B470753uL, 0x3B6CA4C4uL, 0x3B91AF97uL, 0x3BB6276EuL, 0x3BDA0BF0uL,
+	0x3BFD5CC4uL, 0x3C201994uL, 0x3C42420AuL, 0x3C63D5D1uL, 0x3C84D496uL, 0x3CA53E09uL,
+	0x3CC511D9uL, 0x3CE44FB7uL, 0x3D02F757uL, 0x3D21086CuL, 0x3D3E82AEuL, 0x3D5B65D2uL,
+	0x3D77B192uL, 0x3D9365A8uL, 0x3DAE81CFuL, 0x3DC905C5uL, 0x3DE2F148uL, 0x3DFC4418uL,
+	0x3E14FDF7uL, 0x3E2D1EA8uL, 0x3E44A5EFuL, 0x3E5B9392uL, 0x3E71E759uL, 0x3E87A10CuL,
+	0x3E9CC076uL, 0x3EB14563uL, 0x3EC52FA0uL, 0x3ED87EFCuL, 0x3EEB3347uL, 0x3EFD4C54uL,
+	0x3F0EC9F5uL, 0x3F1FABFFuL, 0x3F2FF24AuL, 0x3F3F9CABuL, 0x3F4EAAFEuL, 0x3F5D1D1DuL,
+	0x3F6AF2E3uL, 0x3F782C30uL, 0x3F84C8E2uL, 0x3F90C8DAuL, 0x3F9C2BFBuL, 0x3FA6F228uL,
+	0x3FB11B48uL, 0x3FBAA740uL, 0x3FC395F9uL, 0x3FCBE75EuL, 0x3FD39B5AuL, 0x3FDAB1D9uL,
+	0x3FE12ACBuL, 0x3FE7061FuL, 0x3FEC43C7uL, 0x3FF0E3B6uL, 0x3FF4E5E0uL, 0x3FF84A3CuL,
+	0x3FFB10C1uL, 0x3FFD3969uL, 0x3FFEC42DuL, 0x3FFFB10BuL, 0x40000000uL,
+};
+
+static const u_t lut_exp2[] = { /* pow(2, i/256) in Q2.30 */
+	0x40000000uL, 0x402C6BE9uL, 0x4058F6A8uL, 0x4085A051uL, 0x40B268FAuL, 0x40DF50B8uL,
+	0x410C57A2uL, 0x41397DCCuL, 0x4166C34CuL, 0x41942839uL, 0x41C1ACA7uL, 0x41EF50AEuL,
+	0x421D1462uL, 0x424AF7DAuL, 0x4278FB2BuL, 0x42A71E6CuL, 0x42D561B4uL, 0x4303C518uL,
+	0x433248AEuL, 0x4360EC8DuL, 0x438FB0CBuL, 0x43BE957FuL, 0x43ED9AC0uL, 0x441CC0A3uL,
+	0x444C0740uL, 0x447B6EADuL, 0x44AAF702uL, 0x44DAA054uL, 0x450A6ABBuL, 0x453A564DuL,
+	0x456A6323uL, 0x459A9152uL, 0x45CAE0F2uL, 0x45FB521AuL, 0x462BE4E2uL, 0x465C9961uL,
+	0x468D6FAEuL, 0x46BE67E0uL, 0x46EF8210uL, 0x4720BE55uL, 0x47521CC6uL, 0x47839D7BuL,
+	0x47B5408CuL, 0x47E70611uL, 0x4818EE22uL, 0x484AF8D6uL, 0x487D2646uL, 0x48AF768AuL,
+	0x48E1E9BAuL, 0x49147FEEuL, 0x4947393FuL, 0x497A15C4uL, 0x49AD1598uL, 0x49E038D0uL,
+	0x4A137F88uL, 0x4A46E9D6uL, 0x4A7A77D4uL, 0x4AAE299BuL, 0x4AE1FF43uL, 0x4B15F8E6uL,
+	0x4B4A169CuL, 0x4B7E587EuL, 0x4BB2BEA5uL, 0x4BE7492BuL, 0x4C1BF829uL, 0x4C50CBB8uL,
+	0x4C85C3F1uL, 0x4CBAE0EFuL, 0x4CF022CAuL, 0x4D25899CuL, 0x4D5B157EuL, 0x4D90C68BuL,
+	0x4DC69CDDuL, 0x4DFC988CuL, 0x4E32B9B4uL, 0x4E69006EuL, 0x4E9F6CD4uL, 0x4ED5FF00uL,
+	0x4F0CB70CuL, 0x4F439514uL, 0x4F7A9930uL, 0x4FB1C37CuL, 0x4FE91413uL, 0x50208B0EuL,
+	0x50582888uL, 0x508FEC9CuL, 0x50C7D765uL, 0x50FFE8FEuL, 0x51382182uL, 0x5170810BuL,
+	0x51A907B4uL, 0x51E1B59AuL, 0x521A8AD7uL, 0x52538786uL, 0x528CABC3uL, 0x52C5F7AAuL,
+	0x52FF6B55uL, 0x533906E0uL, 0x5372CA68uL, 0x53ACB607uL, 0x53E6C9DAuL, 0x542105FDuL,
+	0x545B6A8BuL, 0x5495F7A1uL, 0x54D0AD5AuL, 0x550B8BD4uL, 0x55469329uL, 0x5581C378uL,
+	0x55BD1CDBuL, 0x55F89F70uL, 0x56344B52uL, 0x567020A0uL, 0x56AC1F75uL, 0x56E847EFuL,
+	0x57249A29uL, 0x57611642uL, 0x579DBC57uL, 0x57DA8C83uL, 0x581786E6uL, 0x5854AB9BuL,
+	0x5891FAC1uL, 0x58CF7474uL, 0x590D18D3uL, 0x594AE7FBuL, 0x5988E209uL, 0x59C7071CuL,
+	0x5A055751uL, 0x5A43D2C6uL, 0x5A82799AuL, 0x5AC14BEAuL, 0x5B0049D4uL, 0x5B3F7377uL,
+	0x5B7EC8F2uL, 0x5BBE4A61uL, 0x5BFDF7E5uL, 0x5C3DD19CuL, 0x5C7DD7A4uL, 0x5CBE0A1CuL,
+	0x5CFE6923uL, 0x5D3EF4D7uL, 0x5D7FAD59uL, 0x5DC092C7uL, 0x5E01A53FuL, 0x5E42E4E3uL,
+	0x5E8451D0uL, 0x5EC5EC26uL, 0x5F07B405uL, 0x5F49A98CuL, 0x5F8BCCDBuL, 0x5FCE1E12uL,
+	0x60109D51uL, 0x60534AB7uL, 0x60962665uL, 0x60D9307BuL, 0x611C6919uL, 0x615FD05EuL,
+	0x61A3666DuL, 0x61E72B65uL, 0x622B1F66uL, 0x626F4292uL, 0x62B39509uL, 0x62F816EBuL,
+	0x633CC85BuL, 0x6381A978uL, 0x63C6BA64uL, 0x640BFB41uL, 0x64516C2EuL, 0x64970D4FuL,
+	0x64DCDEC3uL, 0x6522E0ADuL, 0x6569132FuL, 0x65AF766AuL, 0x65F60A7FuL, 0x663CCF92uL,
+	0x6683C5C3uL, 0x66CAED35uL, 0x6712460BuL, 0x6759D065uL, 0x67A18C68uL, 0x67E97A34uL,
+	0x683199EDuL, 0x6879EBB6uL, 0x68C26FB1uL, 0x690B2601uL, 0x69540EC9uL, 0x699D2A2CuL,
+	0x69E6784DuL, 0x6A2FF94FuL, 0x6A79AD56uL, 0x6AC39485uL, 0x6B0DAEFFuL, 0x6B57FCE9uL,
+	0x6BA27E65uL, 0x6BED3399uL, 0x6C381CA6uL, 0x6C8339B2uL, 0x6CCE8AE1uL, 0x6D1A1057uL,
+	0x6D65CA38uL, 0x6DB1B8A8uL, 0x6DFDDBCCuL, 0x6E4A33C9uL, 0x6E96C0C3uL, 0x6EE382DEuL,
+	0x6F307A41uL, 0x6F7DA710uL, 0x6FCB096FuL, 0x7018A185uL, 0x70666F76uL, 0x70B47368uL,
+	0x7102AD80uL, 0x71511DE4uL, 0x719FC4B9uL, 0x71EEA226uL, 0x723DB650uL, 0x728D015DuL,
+	0x72DC8374uL, 0x732C3CBAuL, 0x737C2D55uL, 0x73CC556DuL, 0x741CB528uL, 0x746D4CACuL,
+	0x74BE1C20uL, 0x750F23ABuL, 0x75606374uL, 0x75B1DBA2uL, 0x76038C5BuL, 0x765575C8uL,
+	0x76A7980FuL, 0x76F9F359uL, 0x774C87CCuL, 0x779F5590uL, 0x77F25CCEuL, 0x78459DACuL,
+	0x78991854uL, 0x78ECCCECuL, 0x7940BB9EuL, 0x7994E492uL, 0x79E947EFuL, 0x7A3DE5DFuL,
+	0x7A92BE8BuL, 0x7AE7D21AuL, 0x7B3D20B6uL, 0x7B92AA88uL, 0x7BE86FBAuL, 0x7C3E7073uL,
+	0x7C94ACDEuL, 0x7CEB2523uL, 0x7D41D96EuL, 0x7D98C9E6uL, 0x7DEFF6B6uL, 0x7E476009uL,
+	0x7E9F0606uL, 0x7EF6E8DAuL, 0x7F4F08AEuL, 0x7FA765ADuL, 0x80000000uL,
+};
+
+static const u_t lut_log[] = { /* log(1 + (i/256)) in Q2.30 */
+	0x00000000uL, 0x003FE015uL, 0x007F80AAuL, 0x00BEE23BuL, 0x00FE0546uL, 0x013CEA44uL,
+	0x017B91B0uL, 0x01B9FC02uL, 0x01F829B1uL, 0x02361B31uL, 0x0273D0F7uL, 0x02B14B76uL,
+	0x02EE8B1FuL, 0x032B9062uL, 0x03685BAEuL, 0x03A4ED71uL, 0x03E14618uL, 0x041D660DuL,
+	0x04594DBCuL, 0x0494FD8CuL, 0x04D075E6uL, 0x050BB730uL, 0x0546C1D0uL, 0x0581962AuL,
+	0x05BC34A3uL, 0x05F69D9BuL, 0x0630D176uL, 0x066AD092uL, 0x06A49B4FuL, 0x06DE320BuL,
+	0x07179524uL, 0x0750C4F6uL, 0x0789C1DCuL, 0x07C28C30uL, 0x07FB244CuL, 0x08338A89uL,
+	0x086BBF3EuL, 0x08A3C2C2uL, 0x08DB956BuL, 0x0913378DuL, 0x094AA97CuL, 0x0981EB8CuL,
+	0x09B8FE10uL, 0x09EFE158uL, 0x0A2695B6uL, 0x0A5D1B7AuL, 0x0A9372F2uL, 0x0AC99C6DuL,
+	0x0AFF9838uL, 0x0B3566A1uL, 0x0B6B07F4uL, 0x0BA07C7BuL, 0x0BD5C481uL, 0x0C0AE051uL,
+	0x0C3FD033uL, 0x0C74946FuL, 0x0CA92D4EuL, 0x0CDD9B17uL, 0x0D11DE10uL, 0x0D45F67EuL,
+	0x0D79E4A7uL, 0x0DADA8CFuL, 0x0DE1433AuL, 0x0E14B42BuL, 0x0E47FBE4uL, 0x0E7B1AA7uL,
+	0x0EAE10B6uL, 0x0EE0DE50uL, 0x0F1383B7uL, 0x0F460129uL, 0x0F7856E6uL, 0x0FAA852BuL,
+	0x0FDC8C37uL, 0x100E6C46uL, 0x10402595uL, 0x1071B860uL, 0x10A324E2uL, 0x10D46B58uL,
+	0x11058BFAuL, 0x11368703uL, 0x11675CACuL, 0x11980D2EuL, 0x11C898C1uL, 0x11F8FF9EuL,
+	0x122941FCuL, 0x12596011uL, 0x12895A14uL, 0x12B9303BuL, 0x12E8E2BBuL, 0x131871C9uL,
+	0x1347DD9BuL, 0x13772663uL, 0x13A64C55uL, 0x13D54FA6uL, 0x14043087uL, 0x1432EF2AuL,
+	0x14618BC2uL, 0x14900680uL, 0x14BE5F95uL, 0x14EC9732uL, 0x151AAD87uL, 0x1548A2C4uL,
+	0x15767717uL, 0x15A42AB1uL, 0x15D1BDBFuL, 0x15FF3071uL, 0x162C82F3uL, 0x1659B573uL,
+	0x1686C81FuL, 0x16B3BB22uL, 0x16E08EAAuL, 0x170D42E2uL, 0x1739D7F7uL, 0x17664E12uL,
+	0x1792A560uL, 0x17BEDE0AuL, 0x17EAF83CuL, 0x1816F41EuL, 0x1842D1DAuL, 0x186E919AuL,
+	0x189A3387uL, 0x18C5B7C8uL, 0x18F11E87uL, 0x191C67EBuL, 0x1947941CuL, 0x1972A341uL,
+	0x199D9581uL, 0x19C86B03uL, 0x19F323EDuL, 0x1A1DC065uL, 0x1A484091uL, 0x1A72A496uL,
+	0x1A9CEC9BuL, 0x1AC718C2uL, 0x1AF12932uL, 0x1B1B1E0FuL, 0x1B44F77CuL, 0x1B6EB59DuL,
+	0x1B985897uL, 0x1BC1E08BuL, 0x1BEB4D9EuL, 0x1C149FF1uL, 0x1C3DD7A8uL, 0x1C66F4E4uL,
+	0x1C8FF7C8uL, 0x1CB8E074uL, 0x1CE1AF0CuL, 0x1D0A63AEuL, 0x1D32FE7EuL, 0x1D5B7F9BuL,
+	0x1D83E726uL, 0x1DAC353EuL, 0x1DD46A05uL, 0x1DFC8599uL, 0x1E24881AuL, 0x1E4C71A8uL,
+	0x1E744262uL, 0x1E9BFA66uL, 0x1EC399D2uL, 0x1EEB20C6uL, 0x1F128F60uL, 0x1F39E5BDuL,
+	0x1F6123FAuL, 0x1F884A37uL, 0x1FAF588FuL, 0x1FD64F21uL, 0x1FFD2E08uL, 0x2023F562uL,
+	0x204AA54BuL, 0x20713DE0uL, 0x2097BF3BuL, 0x20BE297AuL, 0x20E47CB8uL, 0x210AB911uL,
+	0x2130DE9FuL, 0x2156ED7EuL, 0x217CE5C8uL, 0x21A2C799uL, 0x21C8930CuL, 0x21EE4839uL,
+	0x2213E73CuL, 0x2239702FuL, 0x225EE32BuL, 0x2284404AuL, 0x22A987A6uL, 0x22CEB957uL,
+	0x22F3D578uL, 0x2318DC20uL, 0x233DCD69uL, 0x2362A96BuL, 0x2387703FuL, 0x23AC21FDuL,
+	0x23D0BEBDuL, 0x23F54697uL, 0x2419B9A3uL, 0x243E17F9uL, 0x246261AFuL, 0x248696DFuL,
+	0x24AAB79DuL, 0x24CEC402uL, 0x24F2BC25uL, 0x2516A01CuL, 0x253A6FFEuL, 0x255E2BE0uL,
+	0x2581D3DBuL, 0x25A56802uL, 0x25C8E86EuL, 0x25EC5533uL, 0x260FAE67uL, 0x2632F41FuL,
+	0x26562672uL, 0x26794574uL, 0x269C513BuL, 0x26BF49DCuL, 0x26E22F6BuL, 0x270501FDuL,
+	0x2727C1A7uL, 0x274A6E7DuL, 0x276D0894uL, 0x278F9000uL, 0x27B204D5uL, 0x27D46727uL,
+	0x27F6B70AuL, 0x2818F491uL, 0x283B1FD1uL, 0x285D38DCuL, 0x287F3FC6uL, 0x28A134A2uL,
+	0x28C31784uL, 0x28E4E87EuL, 0x2906A7A4uL, 0x29285507uL, 0x2949F0BBuL, 0x296B7AD3uL,
+	0x298CF360uL, 0x29AE5A74uL, 0x29CFB023uL, 0x29F0F47FuL, 0x2A122798uL, 0x2A334981uL,
+	0x2A545A4DuL, 0x2A755A0BuL, 0x2A9648CFuL, 0x2AB726A9uL, 0x2AD7F3ABuL, 0x2AF8AFE6uL,
+	0x2B195B6CuL, 0x2B39F64CuL, 0x2B5A8098uL, 0x2B7AFA62uL, 0x2B9B63B9uL, 0x2BBBBCAEuL,
+	0x2BDC0552uL, 0x2BFC3DB6uL, 0x2C1C65E9uL, 0x2C3C7DFBuL, 0x2C5C85FEuL,
+};
+
+static inline u_t lut_interpolate(const u_t *t, const u_t i, const u_t frac) {
+	assert(t);
+	assert(i < (1uL << LUT_BITS));
+	const lu_t delta = t[i + 1] - t[i]; /* all tables are increasing */
+	return t[i] + ((delta * frac + (1uL << (LUT_FRAC - 1))) >> LUT_FRAC);
+}
+
+static inline u_t lut_phase(const q_t theta) { /* radians to 1/2^32 of a circle */
+	static const ld_t rad2phase = 683565276l; /* 2^32 / 2pi, in Q16.16 */
+	return ((lu_t)((ld_t)theta * rad2phase) + 0x8000u) >> 16;
+}
+
+static q_t lut_sin(const u_t phase) {
+	const u_t quadrant = phase >> 30;
+	u_t r = phase & 0x3FFFFFFFuL;
+	if (quadrant & 1)
+		r = 0x40000000uL - r;
+	const u_t i = r >> LUT_FRAC;
+	const u_t v = i < (1uL << LUT_BITS) ?
+		lut_interpolate(lut_sine, i, r & LUT_MASK) :
+		lut_sine[1uL << LUT_BITS];
+	return q30toq(quadrant & 2 ? -(ld_t)v : (ld_t)v);
+}
+
+q_t qsin_lut(const q_t theta) {
+	return lut_sin(lut_phase(theta));
 }
 
-static int16_t _cosine(int16_t y) {
-	const int16_t c0 = 0x7fff, c2 = -0x4ee9, c4 = 0x0fbd;
-	const int16_t z = arshift((int32_t)y * y, 12);
-	int16_t prod = arshift((int32_t)z * c4,  16);
-	const int16_t sum = c2 + prod;
-	prod = arshift((int32_t)z * sum, 15);
-	return c0 + prod;
+q_t qcos_lut(const q_t theta) {
+	return lut_sin(lut_phase(theta) + 0x40000000uL);
 }
 
-int16_t furman_sin(int16_t x) {
-	const int16_t n = 3 & arshift(x + 0x2000, 14);
-	x -= n << 14;
-	const int16_t r = (n & 1) ? _cosine(x) : _sine(x);
-	return (n & 2) ? -r : r;
+q_t qexp_lut(const q_t e) { /* exp(e) = 2^(e*log2(e)) = 2^k * 2^f */
+	static const ld_t log2e = 1549082005l; /* log2(e), Q2.30 */
+	const ld_t y = (ld_t)e * log2e, k = ldivn(y, 46); /* y is Q.46 */
+	const lu_t f = ((lu_t)y) & ((1ull << 46) - 1ull);
+	const u_t v = lut_interpolate(lut_exp2, f >> 38, (f >> 16) & LUT_MASK);
+	if (k >= 14) /* anything over 2^15 saturates */
+		return qsat(QSTAT_EXP, ((ld_t)v) << (MIN(k, 16) - 14));
+	const ld_t shift = 14 - k;
+	if (shift > 32)
+		return 0;
+	return ((lu_t)v + (1ull << (shift - 1))) >> shift;
 }
 
-int16_t furman_cos(int16_t x) {
-	return furman_sin(x + 0x4000);
+q_t qlog_lut(const q_t x) { /* log(x) = log(m * 2^e) = log(m) + e*log(2) */
+	static const ld_t ln2 = 744261118l; /* log(2), Q2.30 */
+	assert(qmore(x, 0));
+	if (x <= 0)
+		return qinfo.min;
+	const unsigned msb = 31u - qclz(x);
+	const u_t f = ((u_t)x << (30u - msb)) & 0x3FFFFFFFuL; /* mantissa - 1 */
+	const ld_t l = lut_interpolate(lut_log, f >> LUT_FRAC, f & LUT_MASK);
+	return q30toq((((ld_t)msb - QBITS) * ln2) + l);
 }
 
 /* expression evaluator */
@@ -1401,6 +4395,14 @@ int16_t furman_cos(int16_t x) {
 enum { ASSOCIATE_NONE, ASSOCIATE_LEFT, ASSOCIATE_RIGHT, };
 enum { LEX_NUMBER, LEX_OPERATOR, LEX_END, };
 
+#define QOP_SEED  (51362uL)      /* 'qhash' seed giving a perfect hash of operator names */
+#define QVAR_SEED (0x811C9DC5uL) /* 'qhash' seed for variables, FNV offset basis */
+
+static inline qctx_t *context(const qexpr_t *e) {
+	assert(e);
+	return e->ctx ? e->ctx : &qconf;
+}
+
 int qexpr_init(qexpr_t *e) {
 	assert(e);
 	e->lpar   = qop("(");
@@ -1425,27 +4427,71 @@ static int error(qexpr_t *e, const char *fmt, ...) {
 	return -QINT(1);
 }
 
-static q_t numberify(const char *s) {
+static q_t numberify(qexpr_t *e, const char *s) {
+	assert(e);
 	assert(s);
 	q_t q = 0;
-	(void) qconv(&q, s);
+	(void) qconv_ctx(context(e), &q, s);
 	return q;
 }
 
+/* 'base' and 'places' change the context they are applied in, 'qconf' or
+ * the one the evaluator makes 'active' (see 'unary'). */
 static q_t qbase(q_t b) {
-	int nb = qtoi(b);
+	const int nb = qtoi(b);
 	if (nb < 2 || nb > 36)
 		return -QINT(1);
-	qconf.base = nb;
+	(active ? active : &qconf)->base = nb;
 	return b;
 }
 
 static q_t qplaces(q_t places) {
 	/* TODO: Bounds checks given base */
-	qconf.dp = qtoi(places);
+	(active ? active : &qconf)->dp = qtoi(places);
 	return places;
 }
 
+/* Strength reduced forms of 'x * 2' and 'x / 2', used by the compiler */
+static q_t qtwice(q_t a) { return qsat(QSTAT_MUL, (ld_t)a * 2); }
+
+static q_t qhalf(q_t a) { /* same rounding as 'qdiv(a, QINT(2))' */
+	const ld_t t = a;
+	return t >= 0 ? (t + 1) / 2 : -((1 - t) / 2);
+}
+
+static const qoperations_t op_twice = { .name = "*2", .eval.unary = qtwice, .precedence = 5, .arity = 1, .assocativity = ASSOCIATE_RIGHT, .hidden = 1, };
+static const qoperations_t op_half  = { .name = "/2", .eval.unary = qhalf,  .precedence = 5, .arity = 1, .assocativity = ASSOCIATE_RIGHT, .hidden = 1, };
+
+/* Operators are applied with these, a context other than 'qconf' is made
+ * 'active' for the duration so that every result that goes out of range in
+ * the operator, and in anything it calls, uses that context's handler. */
+static inline int default_context(const qexpr_t *e) {
+	assert(e);
+	return !e->ctx || e->ctx == &qconf;
+}
+
+static q_t unary(const qexpr_t *e, const qoperations_t *op, const q_t a) {
+	assert(op);
+	if (default_context(e))
+		return op->eval.unary(a);
+	qctx_t *saved = active;
+	active = e->ctx;
+	const q_t r = op->eval.unary(a);
+	active = saved;
+	return r;
+}
+
+static q_t binary(const qexpr_t *e, const qoperations_t *op, const q_t a, const q_t b) {
+	assert(op);
+	if (default_context(e))
+		return op->eval.binary(a, b);
+	qctx_t *saved = active;
+	active = e->ctx;
+	const q_t r = op->eval.binary(a, b);
+	active = saved;
+	return r;
+}
+
 static q_t check_div0(qexpr_t *e, q_t a, q_t b) {
 	assert(e);
 	UNUSED(a);
@@ -1482,97 +4528,149 @@ static q_t check_alo(qexpr_t *e, q_t a) {
 	return QINT(0);
 }
 
+static q_t check_pow(qexpr_t *e, q_t n, q_t exp) {
+	assert(e);
+	if (qisnegative(n) && !qisinteger(exp))
+		return error(e, "negative number to a fractional power");
+	if (qequal(n, QINT(0)) && qequal(exp, QINT(0)))
+		return error(e, "zero to the power of zero");
+	return QINT(0);
+}
+
+static const qoperations_t ops[] = {
+	/* Sorted Table: Use 'LC_ALL="C" sort -k 2 < table' to sort this */
+	/* name         function                       check function        precedence arity left/right-assoc hidden */     
+	{  "!",         .eval.unary   =  qnot,         .check.unary   =  NULL,        5,  1,  ASSOCIATE_RIGHT,  0,  },
+	{  "!=",        .eval.binary  =  qunequal,     .check.binary  =  NULL,        2,  2,  ASSOCIATE_LEFT,   0,  },
+	{  "%",         .eval.binary  =  qrem,/*!*/    .check.binary  =  check_div0,  3,  2,  ASSOCIATE_LEFT,   0,  },
+	{  "&",         .eval.binary  =  qand,         .check.binary  =  NULL,        2,  2,  ASSOCIATE_LEFT,   0,  },
+	{  "(",         .eval.unary   =  NULL,         .check.unary   =  NULL,        0,  0,  ASSOCIATE_NONE,   0,  },
+	{  ")",         .eval.unary   =  NULL,         .check.unary   =  NULL,        0,  0,  ASSOCIATE_NONE,   0,  },
+	{  "*",         .eval.binary  =  qmul,         .check.binary  =  NULL,        3,  2,  ASSOCIATE_LEFT,   0,  },
+	{  "+",         .eval.binary  =  qadd,         .check.binary  =  NULL,        2,  2,  ASSOCIATE_LEFT,   0,  },
+	{  "-",         .eval.binary  =  qsub,         .check.binary  =  NULL,        2,  2,  ASSOCIATE_LEFT,   0,  },
+	{  "/",         .eval.binary  =  qdiv,         .check.binary  =  check_div0,  3,  2,  ASSOCIATE_LEFT,   0,  },
+	{  "<",         .eval.binary  =  qless,        .check.binary  =  NULL,        2,  2,  ASSOCIATE_LEFT,   0,  },
+	{  "<<",        .eval.binary  =  qlls,         .check.binary  =  NULL,        4,  2,  ASSOCIATE_RIGHT,  0,  },
+	{  "<=",        .eval.binary  =  qeqless,      .check.binary  =  NULL,        2,  2,  ASSOCIATE_LEFT,   0,  },
+	{  "==",        .eval.binary  =  qequal,       .check.binary  =  NULL,        2,  2,  ASSOCIATE_LEFT,   0,  },
+	{  ">",         .eval.binary  =  qmore,        .check.binary  =  NULL,        2,  2,  ASSOCIATE_LEFT,   0,  },
+	{  ">=",        .eval.binary  =  qeqmore,      .check.binary  =  NULL,        2,  2,  ASSOCIATE_LEFT,   0,  },
+	{  ">>",        .eval.binary  =  qlrs,         .check.binary  =  NULL,        4,  2,  ASSOCIATE_RIGHT,  0,  },
+	{  "^",         .eval.binary  =  qxor,         .check.binary  =  NULL,        2,  2,  ASSOCIATE_LEFT,   0,  },
+	{  "_div",      .eval.binary  =  qcordic_div,  .check.binary  =  NULL,        5,  2,  ASSOCIATE_RIGHT,  1,  },
+	{  "_exp",      .eval.unary   =  qcordic_exp,  .check.unary   =  NULL,        5,  1,  ASSOCIATE_RIGHT,  1,  },
+	{  "_ln",       .eval.unary   =  qcordic_ln,   .check.unary   =  check_nlez,  5,  1,  ASSOCIATE_RIGHT,  1,  },
+	{  "_mul",      .eval.binary  =  qcordic_mul,  .check.binary  =  NULL,        5,  2,  ASSOCIATE_RIGHT,  1,  },
+	{  "_sqrt",     .eval.unary   =  qcordic_sqrt, .check.unary   =  check_nlz,   5,  1,  ASSOCIATE_RIGHT,  1,  },
+	{  "abs",       .eval.unary   =  qabs,         .check.unary   =  NULL,        5,  1,  ASSOCIATE_RIGHT,  0,  },
+	{  "acos",      .eval.unary   =  qacos,        .check.unary   =  check_alo,   5,  1,  ASSOCIATE_RIGHT,  0,  },
+	{  "acosh",     .eval.unary   =  qacosh,       .check.unary   =  check_nlo,   5,  1,  ASSOCIATE_RIGHT,  0,  },
+	{  "arshift",   .eval.binary  =  qars,         .check.binary  =  NULL,        4,  2,  ASSOCIATE_RIGHT,  1,  },
+	{  "asin",      .eval.unary   =  qasin,        .check.unary   =  check_alo,   5,  1,  ASSOCIATE_RIGHT,  0,  },
+	{  "asinh",     .eval.unary   =  qasinh,       .check.unary   =  NULL,        5,  1,  ASSOCIATE_RIGHT,  0,  },
+	{  "atan",      .eval.unary   =  qatan,        .check.unary   =  NULL,        5,  1,  ASSOCIATE_RIGHT,  0,  },
+	{  "atan2",     .eval.binary  =  qatan2,       .check.binary  =  NULL,        5,  2,  ASSOCIATE_RIGHT,  1,  },
+	{  "atanh",     .eval.unary   =  qatanh,       .check.unary   =  check_alo,   5,  1,  ASSOCIATE_RIGHT,  0,  },
+	{  "base",      .eval.unary   =  qbase,        .check.unary   =  NULL,        2,  1,  ASSOCIATE_RIGHT,  0,  },
+	{  "ceil",      .eval.unary   =  qceil,        .check.unary   =  NULL,        5,  1,  ASSOCIATE_RIGHT,  0,  },
+	{  "copysign",  .eval.binary  =  qcopysign,    .check.binary  =  NULL,        4,  2,  ASSOCIATE_RIGHT,  1,  },
+	{  "cos",       .eval.unary   =  qcos,         .check.unary   =  NULL,        5,  1,  ASSOCIATE_RIGHT,  0,  },
+	{  "cosh",      .eval.unary   =  qcosh,        .check.unary   =  NULL,        5,  1,  ASSOCIATE_RIGHT,  0,  },
+	{  "cot",       .eval.unary   =  qcot,         .check.unary   =  NULL,        5,  1,  ASSOCIATE_RIGHT,  0,  },
+	{  "deg2rad",   .eval.unary   =  qdeg2rad,     .check.unary   =  NULL,        5,  1,  ASSOCIATE_RIGHT,  0,  },
+	{  "even?",     .eval.unary   =  qiseven,      .check.unary   =  NULL,        5,  1,  ASSOCIATE_RIGHT,  0,  },
+	{  "exp",       .eval.unary   =  qexp,         .check.unary   =  NULL,        5,  1,  ASSOCIATE_RIGHT,  0,  },
+	{  "floor",     .eval.unary   =  qfloor,       .check.unary   =  NULL,        5,  1,  ASSOCIATE_RIGHT,  0,  },
+	{  "hypot",     .eval.binary  =  qhypot,       .check.binary  =  NULL,        5,  2,  ASSOCIATE_RIGHT,  0,  },
+	{  "int?",      .eval.unary   =  qisinteger,   .check.unary   =  NULL,        5,  1,  ASSOCIATE_RIGHT,  0,  },
+	{  "log",       .eval.unary   =  qlog,         .check.unary   =  check_nlez,  5,  1,  ASSOCIATE_RIGHT,  0,  },
+	{  "lshift",    .eval.binary  =  qlls,         .check.binary  =  NULL,        4,  2,  ASSOCIATE_RIGHT,  1,  },
+	{  "max",       .eval.binary  =  qmax,         .check.binary  =  NULL,        5,  2,  ASSOCIATE_RIGHT,  1,  },
+	{  "min",       .eval.binary  =  qmin,         .check.binary  =  NULL,        5,  2,  ASSOCIATE_RIGHT,  1,  },
+	{  "mod",       .eval.binary  =  qmod,         .check.binary  =  check_div0,  3,  2,  ASSOCIATE_LEFT,   0,  },
+	{  "neg?",      .eval.unary   =  qisnegative,  .check.unary   =  NULL,        5,  1,  ASSOCIATE_RIGHT,  0,  },
+	{  "negate",    .eval.unary   =  qnegate,      .check.unary   =  NULL,        5,  1,  ASSOCIATE_RIGHT,  0,  },
+	{  "odd?",      .eval.unary   =  qisodd,       .check.unary   =  NULL,        5,  1,  ASSOCIATE_RIGHT,  0,  },
+	{  "places",    .eval.unary   =  qplaces,      .check.unary   =  NULL,        2,  1,  ASSOCIATE_RIGHT,  0,  },
+	{  "pos?",      .eval.unary   =  qispositive,  .check.unary   =  NULL,        5,  1,  ASSOCIATE_RIGHT,  0,  },
+	{  "pow",       .eval.binary  =  qpow,         .check.binary  =  check_pow,   5,  2,  ASSOCIATE_RIGHT,  0,  },
+	{  "rad2deg",   .eval.unary   =  qrad2deg,     .check.unary   =  NULL,        5,  1,  ASSOCIATE_RIGHT,  0,  },
+	{  "rem",       .eval.binary  =  qrem,         .check.binary  =  check_div0,  3,  2,  ASSOCIATE_LEFT,   0,  },
+	{  "round",     .eval.unary   =  qround,       .check.unary   =  NULL,        5,  1,  ASSOCIATE_RIGHT,  0,  },
+	{  "rshift",    .eval.binary  =  qlrs,         .check.binary  =  NULL,        4,  2,  ASSOCIATE_RIGHT,  1,  },
+	{  "rsqrt",     .eval.unary   =  qrsqrt,       .check.unary   =  check_nlez,  5,  1,  ASSOCIATE_RIGHT,  0,  },
+	{  "sign",      .eval.unary   =  qsign,        .check.unary   =  NULL,        5,  1,  ASSOCIATE_RIGHT,  0,  },
+	{  "signum",    .eval.unary   =  qsignum,      .check.unary   =  NULL,        5,  1,  ASSOCIATE_RIGHT,  0,  },
+	{  "sin",       .eval.unary   =  qsin,         .check.unary   =  NULL,        5,  1,  ASSOCIATE_RIGHT,  0,  },
+	{  "sinh",      .eval.unary   =  qsinh,        .check.unary   =  NULL,        5,  1,  ASSOCIATE_RIGHT,  0,  },
+	{  "sqrt",      .eval.unary   =  qsqrt,        .check.unary   =  check_nlz,   5,  1,  ASSOCIATE_RIGHT,  0,  },
+	{  "tan",       .eval.unary   =  qtan,         .check.unary   =  NULL,        5,  1,  ASSOCIATE_RIGHT,  0,  },
+	{  "tanh",      .eval.unary   =  qtanh,        .check.unary   =  NULL,        5,  1,  ASSOCIATE_RIGHT,  0,  },
+	{  "trunc",     .eval.unary   =  qtrunc,       .check.unary   =  NULL,        5,  1,  ASSOCIATE_RIGHT,  0,  },
+	{  "|",         .eval.binary  =  qor,          .check.binary  =  NULL,        2,  2,  ASSOCIATE_LEFT,   0,  },
+	{  "~",         .eval.unary   =  qinvert,      .check.unary   =  NULL,        5,  1,  ASSOCIATE_RIGHT,  0,  },
+};
+
 const qoperations_t *qop(const char *op) {
 	assert(op);
-	static const qoperations_t ops[] = {
-		/* Binary Search Table: Use 'LC_ALL="C" sort -k 2 < table' to sort this */
-		/* name         function                       check function        precedence arity left/right-assoc hidden */     
-		{  "!",         .eval.unary   =  qnot,         .check.unary   =  NULL,        5,  1,  ASSOCIATE_RIGHT,  0,  },
-		{  "!=",        .eval.binary  =  qunequal,     .check.binary  =  NULL,        2,  2,  ASSOCIATE_LEFT,   0,  },
-		{  "%",         .eval.binary  =  qrem,/*!*/    .check.binary  =  check_div0,  3,  2,  ASSOCIATE_LEFT,   0,  },
-		{  "&",         .eval.binary  =  qand,         .check.binary  =  NULL,        2,  2,  ASSOCIATE_LEFT,   0,  },
-		{  "(",         .eval.unary   =  NULL,         .check.unary   =  NULL,        0,  0,  ASSOCIATE_NONE,   0,  },
-		{  ")",         .eval.unary   =  NULL,         .check.unary   =  NULL,        0,  0,  ASSOCIATE_NONE,   0,  },
-		{  "*",         .eval.binary  =  qmul,         .check.binary  =  NULL,        3,  2,  ASSOCIATE_LEFT,   0,  },
-		{  "+",         .eval.binary  =  qadd,         .check.binary  =  NULL,        2,  2,  ASSOCIATE_LEFT,   0,  },
-		{  "-",         .eval.binary  =  qsub,         .check.binary  =  NULL,        2,  2,  ASSOCIATE_LEFT,   0,  },
-		{  "/",         .eval.binary  =  qdiv,         .check.binary  =  check_div0,  3,  2,  ASSOCIATE_LEFT,   0,  },
-		{  "<",         .eval.binary  =  qless,        .check.binary  =  NULL,        2,  2,  ASSOCIATE_LEFT,   0,  },
-		{  "<<",        .eval.binary  =  qlls,         .check.binary  =  NULL,        4,  2,  ASSOCIATE_RIGHT,  0,  },
-		{  "<=",        .eval.binary  =  qeqless,      .check.binary  =  NULL,        2,  2,  ASSOCIATE_LEFT,   0,  },
-		{  "==",        .eval.binary  =  qequal,       .check.binary  =  NULL,        2,  2,  ASSOCIATE_LEFT,   0,  },
-		{  ">",         .eval.binary  =  qmore,        .check.binary  =  NULL,        2,  2,  ASSOCIATE_LEFT,   0,  },
-		{  ">=",        .eval.binary  =  qeqmore,      .check.binary  =  NULL,        2,  2,  ASSOCIATE_LEFT,   0,  },
-		{  ">>",        .eval.binary  =  qlrs,         .check.binary  =  NULL,        4,  2,  ASSOCIATE_RIGHT,  0,  },
-		{  "^",         .eval.binary  =  qxor,         .check.binary  =  NULL,        2,  2,  ASSOCIATE_LEFT,   0,  },
-		{  "_div",      .eval.binary  =  qcordic_div,  .check.binary  =  NULL,        5,  2,  ASSOCIATE_RIGHT,  1,  },
-		{  "_exp",      .eval.unary   =  qcordic_exp,  .check.unary   =  NULL,        5,  1,  ASSOCIATE_RIGHT,  1,  },
-		{  "_ln",       .eval.unary   =  qcordic_ln,   .check.unary   =  check_nlez,  5,  1,  ASSOCIATE_RIGHT,  1,  },
-		{  "_mul",      .eval.binary  =  qcordic_mul,  .check.binary  =  NULL,        5,  2,  ASSOCIATE_RIGHT,  1,  },
-		{  "_sqrt",     .eval.unary   =  qcordic_sqrt, .check.unary   =  check_nlz,   5,  1,  ASSOCIATE_RIGHT,  1,  },
-		{  "abs",       .eval.unary   =  qabs,         .check.unary   =  NULL,        5,  1,  ASSOCIATE_RIGHT,  0,  },
-		{  "acos",      .eval.unary   =  qacos,        .check.unary   =  check_alo,   5,  1,  ASSOCIATE_RIGHT,  0,  },
-		{  "acosh",     .eval.unary   =  qacosh,       .check.unary   =  check_nlo,   5,  1,  ASSOCIATE_RIGHT,  0,  },
-		{  "arshift",   .eval.binary  =  qars,         .check.binary  =  NULL,        4,  2,  ASSOCIATE_RIGHT,  1,  },
-		{  "asin",      .eval.unary   =  qasin,        .check.unary   =  check_alo,   5,  1,  ASSOCIATE_RIGHT,  0,  },
-		{  "asinh",     .eval.unary   =  qasinh,       .check.unary   =  NULL,        5,  1,  ASSOCIATE_RIGHT,  0,  },
-		{  "atan",      .eval.unary   =  qatan,        .check.unary   =  NULL,        5,  1,  ASSOCIATE_RIGHT,  0,  },
-		{  "atan2",     .eval.binary  =  qatan2,       .check.binary  =  NULL,        5,  2,  ASSOCIATE_RIGHT,  1,  },
-		{  "atanh",     .eval.unary   =  qatanh,       .check.unary   =  check_alo,   5,  1,  ASSOCIATE_RIGHT,  0,  },
-		{  "base",      .eval.unary   =  qbase,        .check.unary   =  NULL,        2,  1,  ASSOCIATE_RIGHT,  0,  },
-		{  "ceil",      .eval.unary   =  qceil,        .check.unary   =  NULL,        5,  1,  ASSOCIATE_RIGHT,  0,  },
-		{  "copysign",  .eval.binary  =  qcopysign,    .check.binary  =  NULL,        4,  2,  ASSOCIATE_RIGHT,  1,  },
-		{  "cos",       .eval.unary   =  qcos,         .check.unary   =  NULL,        5,  1,  ASSOCIATE_RIGHT,  0,  },
-		{  "cosh",      .eval.unary   =  qcosh,        .check.unary   =  NULL,        5,  1,  ASSOCIATE_RIGHT,  0,  },
-		{  "cot",       .eval.unary   =  qcot,         .check.unary   =  NULL,        5,  1,  ASSOCIATE_RIGHT,  0,  },
-		{  "deg2rad",   .eval.unary   =  qdeg2rad,     .check.unary   =  NULL,        5,  1,  ASSOCIATE_RIGHT,  0,  },
-		{  "even?",     .eval.unary   =  qiseven,      .check.unary   =  NULL,        5,  1,  ASSOCIATE_RIGHT,  0,  },
-		{  "exp",       .eval.unary   =  qexp,         .check.unary   =  NULL,        5,  1,  ASSOCIATE_RIGHT,  0,  },
-		{  "floor",     .eval.unary   =  qfloor,       .check.unary   =  NULL,        5,  1,  ASSOCIATE_RIGHT,  0,  },
-		{  "hypot",     .eval.binary  =  qhypot,       .check.binary  =  NULL,        5,  2,  ASSOCIATE_RIGHT,  0,  },
-		{  "int?",      .eval.unary   =  qisinteger,   .check.unary   =  NULL,        5,  1,  ASSOCIATE_RIGHT,  0,  },
-		{  "log",       .eval.unary   =  qlog,         .check.unary   =  check_nlez,  5,  1,  ASSOCIATE_RIGHT,  0,  },
-		{  "lshift",    .eval.binary  =  qlls,         .check.binary  =  NULL,        4,  2,  ASSOCIATE_RIGHT,  1,  },
-		{  "max",       .eval.binary  =  qmax,         .check.binary  =  NULL,        5,  2,  ASSOCIATE_RIGHT,  1,  },
-		{  "min",       .eval.binary  =  qmin,         .check.binary  =  NULL,        5,  2,  ASSOCIATE_RIGHT,  1,  },
-		{  "mod",       .eval.binary  =  qmod,         .check.binary  =  check_div0,  3,  2,  ASSOCIATE_LEFT,   0,  },
-		{  "neg?",      .eval.unary   =  qisnegative,  .check.unary   =  NULL,        5,  1,  ASSOCIATE_RIGHT,  0,  },
-		{  "negate",    .eval.unary   =  qnegate,      .check.unary   =  NULL,        5,  1,  ASSOCIATE_RIGHT,  0,  },
-		{  "odd?",      .eval.unary   =  qisodd,       .check.unary   =  NULL,        5,  1,  ASSOCIATE_RIGHT,  0,  },
-		{  "places",    .eval.unary   =  qplaces,      .check.unary   =  NULL,        2,  1,  ASSOCIATE_RIGHT,  0,  },
-		{  "pos?",      .eval.unary   =  qispositive,  .check.unary   =  NULL,        5,  1,  ASSOCIATE_RIGHT,  0,  },
-		{  "pow",       .eval.binary  =  qpow,         .check.binary  =  NULL,        5,  2,  ASSOCIATE_RIGHT,  0,  },
-		{  "rad2deg",   .eval.unary   =  qrad2deg,     .check.unary   =  NULL,        5,  1,  ASSOCIATE_RIGHT,  0,  },
-		{  "rem",       .eval.binary  =  qrem,         .check.binary  =  check_div0,  3,  2,  ASSOCIATE_LEFT,   0,  },
-		{  "round",     .eval.unary   =  qround,       .check.unary   =  NULL,        5,  1,  ASSOCIATE_RIGHT,  0,  },
-		{  "rshift",    .eval.binary  =  qlrs,         .check.binary  =  NULL,        4,  2,  ASSOCIATE_RIGHT,  1,  },
-		{  "sign",      .eval.unary   =  qsign,        .check.unary   =  NULL,        5,  1,  ASSOCIATE_RIGHT,  0,  },
-		{  "signum",    .eval.unary   =  qsignum,      .check.unary   =  NULL,        5,  1,  ASSOCIATE_RIGHT,  0,  },
-		{  "sin",       .eval.unary   =  qsin,         .check.unary   =  NULL,        5,  1,  ASSOCIATE_RIGHT,  0,  },
-		{  "sinh",      .eval.unary   =  qsinh,        .check.unary   =  NULL,        5,  1,  ASSOCIATE_RIGHT,  0,  },
-		{  "sqrt",      .eval.unary   =  qsqrt,        .check.unary   =  check_nlz,   5,  1,  ASSOCIATE_RIGHT,  0,  },
-		{  "tan",       .eval.unary   =  qtan,         .check.unary   =  NULL,        5,  1,  ASSOCIATE_RIGHT,  0,  },
-		{  "tanh",      .eval.unary   =  qtanh,        .check.unary   =  NULL,        5,  1,  ASSOCIATE_RIGHT,  0,  },
-		{  "trunc",     .eval.unary   =  qtrunc,       .check.unary   =  NULL,        5,  1,  ASSOCIATE_RIGHT,  0,  },
-		{  "|",         .eval.binary  =  qor,          .check.binary  =  NULL,        2,  2,  ASSOCIATE_LEFT,   0,  },
-		{  "~",         .eval.unary   =  qinvert,      .check.unary   =  NULL,        5,  1,  ASSOCIATE_RIGHT,  0,  },
+	/* 'index' maps 'qhash(QOP_SEED, name) >> 24' to 'ops' entry + 1, it is a
+	 * perfect hash and was generated by trying seeds until there were no
+	 * collisions; it must be regenerated if the table changes, which
+	 * the check on a failed lookup catches in debug builds. */
+	static const unsigned char index[256] = {
+		 0, 50,  0,  0, 68,  0,  0, 31,  0,  0,  0,  0,  0,  0,  0,  0,
+		 0,  0,  0,  0,  0,  0,  0,  0,  0, 55,  0,  0, 60, 62,  0,  0,
+		 0,  0,  0,  0,  0, 34,  0, 57,  0, 58, 43,  0,  0,  2, 16, 17,
+		 0, 12, 13,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, 32,  0,  0,
+		 0,  0,  0,  0,  0,  0,  0,  0,  0,  0, 65,  0,  0,  0, 42,  0,
+		 0,  0, 39,  0,  0,  0, 20, 51,  0,  0, 67,  0,  0,  0,  0,  0,
+		 0, 41,  0,  0,  0,  0, 33,  0,  0, 25,  0, 21,  0, 27,  0,  0,
+		 0,  0,  0,  0, 45,  0,  0, 56,  0,  0,  0,  0, 59,  0,  0,  0,
+		 0,  0,  0,  0,  1,  4,  0,  0,  3,  7,  8,  5,  6,  0, 10, 26,
+		 9,  0,  0,  0, 37,  0,  0,  0,  0,  0,  0,  0,  0, 15,  0, 11,
+		 0, 24,  0, 23, 54,  0,  0,  0, 46,  0,  0,  0, 53,  0, 14,  0,
+		 0,  0,  0, 63,  0, 19,  0,  0, 35, 28,  0, 44,  0,  0,  0,  0,
+		 0,  0,  0,  0,  0,  0,  0, 22,  0, 38, 47,  0,  0,  0,  0, 52,
+		36,  0, 49,  0, 66,  0,  0,  0, 48,  0,  0,  0, 30, 70,  0, 69,
+		 0,  0,  0,  0,  0,  0,  0, 64,  0,  0,  0,  0,  0, 29,  0, 61,
+		 0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, 18,  0, 40,
 	};
 	const size_t length = (sizeof ops / sizeof ops[0]);
-	size_t l = 0, r = length - 1;
-	while (l <= r) { // Iterative Binary Search
-		size_t m = l + ((r - l)/2u);
-		assert (m < length);
-		const int comp = strcmp(ops[m].name, op);
-		if (comp == 0)
-			return &ops[m];
-		if (comp < 0)
-			l = m + 1;
-		else
-			r = m - 1;
-	}
+	const unsigned i = index[qhash(QOP_SEED, op) >> 24];
+	assert(i <= length);
+	if (i && !strcmp(ops[i - 1].name, op))
+		return &ops[i - 1];
+	for (size_t j = 0; j < length; j++)
+		assert(strcmp(ops[j].name, op));
 	return NULL;
 }
 
+const qoperations_t *qop_at(const size_t i) {
+	return i < (sizeof ops / sizeof ops[0]) ? &ops[i] : NULL;
+}
+
+int qstats(qstats_t *s) {
+	assert(s);
+	BUILD_BUG_ON((sizeof ops / sizeof ops[0]) > QSTAT_OPERATORS);
+#if CONFIG_Q_STATS
+	*s = stats.s;
+	return 0;
+#else
+	memset(s, 0, sizeof (*s));
+	return -1;
+#endif
+}
+
+int qstats_reset(void) {
+#if CONFIG_Q_STATS
+	memset(&stats, 0, sizeof (stats));
+	return 0;
+#else
+	return -1;
+#endif
+}
+
 static int number_push(qexpr_t *e, q_t num) {
 	assert(e);
 	if (e->error)
@@ -1634,6 +4732,107 @@ static const qoperations_t *op_pop(qexpr_t *e) {
 	return e->ops[--(e->ops_count)];
 }
 
+static int emit(qexpr_t *e, const qoperations_t *op, const long variable, const q_t number) {
+	assert(e);
+	assert(e->compiling);
+	if (e->error)
+		return -1;
+	if (e->code_count >= e->code_max) {
+		error(e, "program too long");
+		return -1;
+	}
+	qinstruction_t *c = &e->code[e->code_count++];
+	c->op = op;
+	c->variable = variable;
+	c->number = number;
+	return 0;
+}
+
+/* The compiler folds operators applied to constants, running the same check
+ * function used at run time (so "1/0" fails to compile), and removes or
+ * simplifies operations on constants that cannot change their result, these
+ * are exact even when the result would saturate. The expression cannot have
+ * side effects other than 'base' and 'places', which are never folded. */
+
+static long operand_start(qexpr_t *e, long end) { /* first instruction of the operand ending at 'end' */
+	assert(e);
+	for (long need = 1; end >= 0; end--) {
+		const qoperations_t *op = e->code[end].op;
+		need += op ? op->arity - 1 : -1;
+		if (!need)
+			return end;
+	}
+	return -1;
+}
+
+static int constant(const qinstruction_t *c, const q_t v) {
+	assert(c);
+	return !c->op && c->variable < 0 && c->number == v;
+}
+
+static void code_remove(qexpr_t *e, const long i) {
+	assert(e);
+	assert(i >= 0 && (size_t)i < e->code_count);
+	memmove(&e->code[i], &e->code[i + 1], (e->code_count - i - 1) * sizeof (e->code[0]));
+	e->code_count--;
+}
+
+static int optimise(qexpr_t *e, const qoperations_t *op) {
+	assert(e);
+	assert(op);
+	qinstruction_t *c = e->code;
+	const long n = e->code_count;
+	if (op->arity == 1) {
+		if (n < 1 || c[n - 1].op || c[n - 1].variable >= 0 || op->eval.unary == qbase || op->eval.unary == qplaces)
+			return emit(e, op, -1, 0);
+		if (op->check.unary && op->check.unary(e, c[n - 1].number) < 0) {
+			error(e, "unary check failed");
+			return -1;
+		}
+		c[n - 1].number = unary(e, op, c[n - 1].number);
+		return 0;
+	}
+	const long bs = operand_start(e, n - 1), as = operand_start(e, bs - 1);
+	assert(bs > 0 && as >= 0);
+	const int ak = as == (bs - 1) && !c[as].op && c[as].variable < 0;
+	const int bk = bs == (n - 1) && !c[bs].op && c[bs].variable < 0;
+	q_t (*f)(q_t, q_t) = op->eval.binary;
+	if (ak && bk) {
+		if (op->check.binary && op->check.binary(e, c[as].number, c[bs].number)) {
+			error(e, "binary check failed");
+			return -1;
+		}
+		c[as].number = binary(e, op, c[as].number, c[bs].number);
+		e->code_count--;
+		return 0;
+	}
+	if (bk && op->check.binary == check_div0 && constant(&c[bs], 0)) {
+		(void)check_div0(e, 0, 0); /* always fails, whatever 'x' is */
+		return -1;
+	}
+	if (bk && ((f == qadd || f == qsub) && constant(&c[bs], 0))) {
+		e->code_count--; /* x + 0, x - 0 */
+		return 0;
+	}
+	if (bk && ((f == qmul || f == qdiv) && constant(&c[bs], QINT(1)))) {
+		e->code_count--; /* x * 1, x / 1 */
+		return 0;
+	}
+	if (bk && (f == qmul || f == qdiv) && constant(&c[bs], QINT(2))) {
+		e->code_count--; /* x * 2, x / 2 */
+		return emit(e, f == qmul ? &op_twice : &op_half, -1, 0);
+	}
+	if (ak && ((f == qadd && constant(&c[as], 0)) || (f == qmul && constant(&c[as], QINT(1))))) {
+		code_remove(e, as); /* 0 + x, 1 * x */
+		return 0;
+	}
+	if (ak && f == qmul && constant(&c[as], QINT(2))) {
+		code_remove(e, as); /* 2 * x */
+		return emit(e, &op_twice, -1, 0);
+	}
+	return emit(e, op, -1, 0);
+}
+
 static int op_eval(qexpr_t *e) {
 	assert(e);
 	const qoperations_t *pop = op_pop(e);
@@ -1645,20 +4844,31 @@ static int op_eval(qexpr_t *e) {
 		error(e, "syntax error");
 		return -1;
 	}
+	if (e->compiling) { /* values are not known yet, keep track of stack depth only */
+		if (pop->arity == 2)
+			(void)number_pop(e);
+		if (e->error) /* too few operands, 'optimise' needs them all */
+			return -1;
+		if (optimise(e, pop) < 0)
+			return -1;
+		return number_push(e, QINT(0));
+	}
 	if (pop->arity == 1) {
 		if (pop->check.unary && pop->check.unary(e, a) < 0) {
+			QSTAT(domain[pop - ops]);
 			error(e, "unary check failed");
 			return -1;
 		}
-		return number_push(e, pop->eval.unary(a));
+		return number_push(e, unary(e, pop, a));
 	}
 	const q_t b = number_pop(e);
 	if (pop->check.binary && pop->check.binary(e, b, a)) {
+		QSTAT(domain[pop - ops]);
 		error(e, "binary check failed");
 		return -1;
 	}
 
-	return number_push(e, pop->eval.binary(b, a));
+	return number_push(e, binary(e, pop, b, a));
 }
 
 static int shunt(qexpr_t *e, const qoperations_t *op) {
@@ -1699,17 +4909,179 @@ static int variable_name_is_valid(const char *n) {
 	return 1;
 }
 
-static qvariable_t *variable_lookup(qexpr_t *e, const char *name) {
+int qexpr_hash(qexpr_t *e) {
+	assert(e);
+	const size_t mask = e->hash_max - 1;
+	e->hash_count = 0;
+	if (!e->hash || e->hash_max <= e->vars_max || (e->hash_max & mask))
+		return -1;
+	for (size_t i = 0; i < e->hash_max; i++)
+		e->hash[i] = -1;
+	for (size_t i = 0; i < e->vars_max; i++) { /* open addressing, linear probing */
+		size_t j = qhash(QVAR_SEED, e->vars[i]->name) & mask;
+		for (; e->hash[j] >= 0; j = (j + 1) & mask)
+			;
+		e->hash[j] = i;
+	}
+	e->hash_count = e->vars_max;
+	return 0;
+}
+
+static long variable_lookup(qexpr_t *e, const char *name) {
 	assert(e);
 	assert(name);
+	if (e->hash && e->hash_count == e->vars_max) { /* index is up to date */
+		const size_t mask = e->hash_max - 1;
+		for (size_t j = qhash(QVAR_SEED, name) & mask; e->hash[j] >= 0; j = (j + 1) & mask)
+			if (!strcmp(e->vars[e->hash[j]]->name, name))
+				return e->hash[j];
+		return -1;
+	}
 	for (size_t i = 0; i < e->vars_max; i++) {
 		qvariable_t *v = e->vars[i];
 		assert(v->name);
 		assert(variable_name_is_valid(v->name));
 		if (!strcmp(v->name, name))
-			return v;
+			return i;
 	}
-	return NULL;
+	return -1;
+}
+
+long qexpr_variable(qexpr_t *e, const char *name) {
+	assert(e);
+	assert(name);
+	return variable_lookup(e, name);
+}
+
+/* A context made by 'qexpr_arena' lives at the start of a caller provided
+ * buffer, along with everything it refers to, so it needs no allocator and
+ * is thrown away with the buffer. Variables are allocated upwards after the
+ * context and the room for the 'vars' array, and the code and both stacks
+ * are carved from the top of the buffer when an expression is given to
+ * 'qexpr' or 'qexpr_compile', sized by its length, as each token pushes at
+ * most one number, operator and instruction. They are moved (keeping any
+ * compiled code) only if a longer expression comes along. Once compiled only
+ * the code and the number stack, to the depth 'qexpr_run' needs, are kept,
+ * which leaves the rest for more variables. 'qexpr_reset' returns the buffer
+ * to how it was made, leaving the context and its 'ctx' untouched. */
+
+typedef union { ld_t l; void *p; q_t (*f)(q_t); } arena_align_t;
+
+#define ARENA_ALIGN (sizeof (arena_align_t))
+
+static void *arena_alloc(qexpr_t *e, const size_t bytes) {
+	assert(e);
+	assert(e->arena);
+	const size_t start = (e->arena_count + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+	if (start > e->arena_top || bytes > (e->arena_top - start))
+		return NULL;
+	e->arena_count = start + bytes;
+	return &e->arena[start];
+}
+
+static void arena_place(qexpr_t *e, const size_t code, const size_t ops, const size_t numbers, const size_t top) {
+	assert(e);
+	assert(e->code_count <= code);
+	qinstruction_t *c = (qinstruction_t*)&e->arena[top];
+	if (e->code_count)
+		memmove(c, e->code, e->code_count * sizeof (*c));
+	e->code = c;
+	e->code_max = code;
+	e->ops = ops ? (const qoperations_t **)&c[code] : NULL;
+	e->ops_max = ops;
+	e->numbers = (q_t*)((unsigned char*)&c[code] + (ops * sizeof (e->ops[0])));
+	e->numbers_max = numbers;
+	e->arena_top = top;
+}
+
+static int arena_stacks(qexpr_t *e, const size_t tokens) {
+	assert(e);
+	assert(e->arena);
+	const size_t code = MAX(tokens, e->code_count), numbers = MAX(tokens, e->depth); /* keep what 'qexpr_run' needs */
+	if (e->code_max >= code && e->ops_max >= tokens && e->numbers_max >= numbers)
+		return 0;
+	const size_t limit = e->arena_max / (sizeof (e->code[0]) + sizeof (e->ops[0]) + sizeof (e->numbers[0]));
+	if (code > limit || numbers > limit) {
+		error(e, "expression too long for arena");
+		return -1;
+	}
+	const size_t bytes = (code * sizeof (e->code[0])) + (tokens * sizeof (e->ops[0])) + (numbers * sizeof (e->numbers[0]));
+	const size_t top = (e->arena_max - bytes) & ~(ARENA_ALIGN - 1);
+	if (bytes > e->arena_max || top < e->arena_count) {
+		error(e, "expression too long for arena");
+		return -1;
+	}
+	arena_place(e, code, tokens, numbers, top);
+	return 0;
+}
+
+static void arena_trim(qexpr_t *e) { /* after compiling, 'qexpr_run' needs only 'code' and 'depth' numbers */
+	assert(e);
+	assert(e->arena);
+	const size_t bytes = (e->code_count * sizeof (e->code[0])) + (e->depth * sizeof (e->numbers[0]));
+	arena_place(e, e->code_count, 0, e->depth, (e->arena_max - bytes) & ~(ARENA_ALIGN - 1));
+}
+
+qexpr_t *qexpr_arena(void *buffer, const size_t size, const size_t vars) {
+	assert(buffer);
+	BUILD_BUG_ON(ARENA_ALIGN & (ARENA_ALIGN - 1));
+	unsigned char *b = buffer;
+	const size_t skew = (ARENA_ALIGN - ((uintptr_t)b % ARENA_ALIGN)) % ARENA_ALIGN;
+	if (size < skew || (size - skew) < sizeof (qexpr_t))
+		return NULL;
+	qexpr_t *e = (qexpr_t*)&b[skew];
+	memset(e, 0, sizeof (*e));
+	e->arena = &b[skew];
+	e->arena_max = size - skew;
+	e->arena_top = e->arena_max;
+	e->arena_count = sizeof (*e);
+	if (vars > (e->arena_max / sizeof (e->vars[0])) || !(e->vars = arena_alloc(e, vars * sizeof (e->vars[0]))))
+		return NULL;
+	e->vars_limit = vars;
+	e->arena_mark = e->arena_count;
+	qexpr_init(e);
+	return e;
+}
+
+qvariable_t *qexpr_arena_variable(qexpr_t *e, const char *name, const q_t value) {
+	assert(e);
+	assert(e->arena);
+	assert(name);
+	const long i = variable_lookup(e, name);
+	if (i >= 0) {
+		e->vars[i]->value = value;
+		return e->vars[i];
+	}
+	if (e->vars_max >= e->vars_limit || !variable_name_is_valid(name))
+		return NULL;
+	const size_t l = strlen(name) + 1;
+	qvariable_t *v = arena_alloc(e, sizeof (*v) + l);
+	if (!v)
+		return NULL;
+	v->name = memcpy(&v[1], name, l);
+	v->value = value;
+	e->vars[e->vars_max++] = v;
+	return v;
+}
+
+int qexpr_reset(qexpr_t *e) {
+	assert(e);
+	if (!(e->arena))
+		return -1;
+	e->arena_count = e->arena_mark;
+	e->arena_top = e->arena_max;
+	e->vars_max = 0;
+	e->hash_count = 0;
+	e->code = NULL;
+	e->ops = NULL;
+	e->numbers = NULL;
+	e->code_count = 0, e->code_max = 0;
+	e->ops_count = 0, e->ops_max = 0;
+	e->numbers_count = 0, e->numbers_max = 0;
+	e->depth = 0;
+	e->error = 0;
+	e->error_string[0] = 0;
+	return 0;
 }
 
 static int lex(qexpr_t *e, const char **expr) {
@@ -1717,9 +5089,9 @@ static int lex(qexpr_t *e, const char **expr) {
 	assert(expr && *expr);
 	int r = 0;
 	const char *s = *expr;
-	qvariable_t *v = NULL;
 	e->id_count = 0;
 	e->number = 0;
+	e->variable = -1;
 	e->op = NULL;
 	memset(e->id, 0, sizeof (e->id));
 	for (; *s && isspace(*s); s++)
@@ -1729,8 +5101,8 @@ static int lex(qexpr_t *e, const char **expr) {
 	if (isalpha(*s) || *s == '_') {
 		for (; e->id_count < sizeof(e->id) && *s && (isalnum(*s) || *s == '_');)
 			e->id[e->id_count++] = *s++;
-		if ((v = variable_lookup(e, e->id))) {
-			e->number = v->value;
+		if ((e->variable = variable_lookup(e, e->id)) >= 0) {
+			e->number = e->vars[e->variable]->value;
 			r = LEX_NUMBER;
 		} else if ((e->op = qop(e->id))) {
 			r = LEX_OPERATOR;
@@ -1766,7 +5138,7 @@ static int lex(qexpr_t *e, const char **expr) {
 				if (ch == '.')
 					dot = 1;
 			}
-			e->number = numberify(e->id);
+			e->number = numberify(e, e->id);
 		} else {
 			r = -1;
 		}
@@ -1788,9 +5160,13 @@ int qexpr(qexpr_t *e, const char *expr) {
 		e->numbers_count = 0;
 		e->initialized = 1;
 	}
+	if (e->arena && arena_stacks(e, strlen(expr) + 1) < 0)
+		return -1;
 	for (int l = 0; l != LEX_END && !(e->error);) {
 		switch ((l = lex(e, &expr))) {
 		case LEX_NUMBER:   
+			if (e->compiling)
+				emit(e, NULL, e->variable, e->number);
 			number_push(e, e->number); 
 			previous = NULL; 
 			firstop = 0;
@@ -1835,5 +5211,269 @@ end:
 	return e->error == 0 ? 0 : -1;
 }
 
+static size_t code_depth(const qexpr_t *e, size_t *sp) { /* deepest the number stack gets running 'code' */
+	assert(e);
+	assert(sp);
+	size_t depth = 0;
+	*sp = 0;
+	for (size_t i = 0; i < e->code_count; i++) {
+		const qoperations_t *op = e->code[i].op;
+		*sp = op ? *sp - (op->arity - 1) : *sp + 1;
+		depth = MAX(depth, *sp);
+	}
+	return depth;
+}
+
+int qexpr_compile(qexpr_t *e, const char *expr) {
+	assert(e);
+	assert(expr);
+	assert(e->code || e->arena);
+	e->code_count = 0;
+	e->compiling = 1;
+	const int r = qexpr(e, expr);
+	e->compiling = 0;
+	size_t sp = 0;
+	if (r < 0)
+		e->code_count = 0; /* no partial programs, 'qexpr_run' refuses to run nothing */
+	e->depth = r < 0 ? 0 : code_depth(e, &sp);
+	if (r == 0 && e->arena)
+		arena_trim(e);
+	return r;
+}
+
+int qexpr_ctx(qexpr_t *e, qctx_t *c, const char *expr) {
+	assert(e);
+	e->ctx = c;
+	return qexpr(e, expr);
+}
+
+int qexpr_compile_ctx(qexpr_t *e, qctx_t *c, const char *expr) {
+	assert(e);
+	e->ctx = c;
+	return qexpr_compile(e, expr);
+}
+
+int qexpr_run(qexpr_t *e, const q_t *vars) {
+	assert(e);
+	assert(e->initialized);
+	assert(e->code);
+	assert(e->depth <= e->numbers_max); /* found by 'qexpr_compile' */
+	q_t *s = e->numbers;
+	size_t sp = 0;
+	e->error = 0;
+	e->error_string[0] = 0;
+	if (!(e->code_count)) {
+		error(e, "no compiled expression");
+		return -1;
+	}
+	for (size_t i = 0; i < e->code_count; i++) {
+		const qinstruction_t *c = &e->code[i];
+		const qoperations_t *op = c->op;
+		if (!op) {
+			assert(sp < e->numbers_max);
+			assert(c->variable < (long)e->vars_max);
+			s[sp++] = c->variable < 0 ? c->number :
+				vars ? vars[c->variable] : e->vars[c->variable]->value;
+			continue;
+		}
+		if (op->arity == 1) {
+			assert(sp >= 1);
+			if (op->check.unary && op->check.unary(e, s[sp - 1]) < 0) {
+				QSTAT(domain[op - ops]);
+				error(e, "unary check failed");
+				return -1;
+			}
+			s[sp - 1] = unary(e, op, s[sp - 1]);
+			continue;
+		}
+		assert(sp >= 2);
+		const q_t b = s[--sp];
+		if (op->check.binary && op->check.binary(e, s[sp - 1], b)) {
+			QSTAT(domain[op - ops]);
+			error(e, "binary check failed");
+			return -1;
+		}
+		s[sp - 1] = binary(e, op, s[sp - 1], b);
+	}
+	e->numbers_count = sp;
+	if (sp != 1) {
+		error(e, "invalid expression: %d", (int)sp);
+		return -1;
+	}
+	return 0;
+}
+
+/* 'qexpr_run_n' evaluates a compiled expression over columns of variables,
+ * one instruction at a time over a block of rows, using the bulk functions
+ * where there is one for the operator. Constants (and variables without a
+ * column) are kept as scalars until they meet a column. The results are the
+ * same as calling 'qexpr_run' on each row. */
+
+typedef struct {
+	const q_t *v; /* column of values, if not 'scalar' */
+	q_t k;        /* value, if 'scalar' */
+	int scalar;
+} column_t;
+
+static void qtwice_n(q_t *r, const q_t *a, const size_t n) {
+	qadd_n(r, a, a, n);
+}
+
+static const struct {
+	q_t (*eval)(q_t a);
+	void (*bulk)(q_t *r, const q_t *a, size_t n);
+} unary_bulk[] = {
+	{ qexp, qexp_n, }, { qlog, qlog_n, }, { qsqrt, qsqrt_n, }, { qrsqrt, qrsqrt_n, },
+	{ qtwice, qtwice_n, },
+};
+
+static const struct {
+	q_t (*eval)(q_t a, q_t b);
+	void (*bulk)(q_t *r, const q_t *a, const q_t *b, size_t n);
+	void (*scalar)(q_t *r, const q_t *a, q_t s, size_t n);
+	int commutes;
+} binary_bulk[] = {
+	{ qadd, qadd_n, qadd_scalar_n, 1, },
+	{ qsub, qsub_n, qsub_scalar_n, 0, },
+	{ qmul, qmul_n, qmul_scalar_n, 1, },
+	{ qdiv, NULL,   qdiv_scalar_n, 0, },
+};
+
+static int column_check(qexpr_t *e, const qoperations_t *op, const column_t *a, const column_t *b, const size_t m) {
+	assert(e);
+	assert(op);
+	assert(a);
+	if (b ? !op->check.binary : !op->check.unary)
+		return 0;
+	const size_t rows = a->scalar && (!b || b->scalar) ? 1 : m;
+	for (size_t i = 0; i < rows; i++) {
+		const q_t x = a->scalar ? a->k : a->v[i];
+		if (!b) {
+			if (op->check.unary(e, x) < 0) {
+				QSTAT(domain[op - ops]);
+				error(e, "unary check failed");
+				return -1;
+			}
+			continue;
+		}
+		const q_t y = b->scalar ? b->k : b->v[i];
+		if (op->check.binary(e, x, y)) {
+			QSTAT(domain[op - ops]);
+			error(e, "binary check failed");
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static void column_unary(const qexpr_t *e, const qoperations_t *op, column_t *a, q_t *r, const size_t m) {
+	assert(op);
+	assert(a);
+	assert(r);
+	if (a->scalar) {
+		a->k = unary(e, op, a->k);
+		return;
+	}
+	size_t j = default_context(e) ? 0 : (sizeof (unary_bulk) / sizeof (unary_bulk[0]));
+	for (; j < (sizeof (unary_bulk) / sizeof (unary_bulk[0])); j++)
+		if (unary_bulk[j].eval == op->eval.unary)
+			break;
+	if (j < (sizeof (unary_bulk) / sizeof (unary_bulk[0])))
+		unary_bulk[j].bulk(r, a->v, m);
+	else
+		for (size_t i = 0; i < m; i++)
+			r[i] = unary(e, op, a->v[i]);
+	a->v = r;
+}
+
+static void column_binary(const qexpr_t *e, const qoperations_t *op, column_t *a, const column_t *b, q_t *r, const size_t m) {
+	assert(op);
+	assert(a);
+	assert(b);
+	assert(r);
+	if (a->scalar && b->scalar) {
+		a->k = binary(e, op, a->k, b->k);
+		return;
+	}
+	size_t j = default_context(e) ? 0 : (sizeof (binary_bulk) / sizeof (binary_bulk[0]));
+	for (; j < (sizeof (binary_bulk) / sizeof (binary_bulk[0])); j++)
+		if (binary_bulk[j].eval == op->eval.binary)
+			break;
+	const int found = j < (sizeof (binary_bulk) / sizeof (binary_bulk[0]));
+	if (found && !a->scalar && !b->scalar && binary_bulk[j].bulk) {
+		binary_bulk[j].bulk(r, a->v, b->v, m);
+	} else if (found && !a->scalar && b->scalar) {
+		binary_bulk[j].scalar(r, a->v, b->k, m);
+	} else if (found && a->scalar && binary_bulk[j].commutes) {
+		binary_bulk[j].scalar(r, b->v, a->k, m);
+	} else {
+		for (size_t i = 0; i < m; i++)
+			r[i] = binary(e, op, a->scalar ? a->k : a->v[i], b->scalar ? b->k : b->v[i]);
+	}
+	a->v = r;
+	a->scalar = 0;
+}
 
+static int qexpr_run_block(qexpr_t *e, const q_t *const *columns, const size_t row, const size_t m, q_t *out) {
+	assert(e);
+	assert(out);
+	assert(m <= CONFIG_Q_EXPR_BLOCK);
+	q_t store[CONFIG_Q_EXPR_DEPTH][CONFIG_Q_EXPR_BLOCK];
+	column_t s[CONFIG_Q_EXPR_DEPTH];
+	size_t sp = 0;
+	for (size_t i = 0; i < e->code_count; i++) {
+		const qinstruction_t *c = &e->code[i];
+		const qoperations_t *op = c->op;
+		if (!op) {
+			assert(sp < CONFIG_Q_EXPR_DEPTH);
+			column_t *t = &s[sp++];
+			t->scalar = c->variable < 0 || !columns || !columns[c->variable];
+			t->k = c->variable < 0 ? c->number : e->vars[c->variable]->value;
+			t->v = t->scalar ? NULL : &columns[c->variable][row];
+			continue;
+		}
+		if (op->arity == 1) {
+			assert(sp >= 1);
+			if (column_check(e, op, &s[sp - 1], NULL, m) < 0)
+				return -1;
+			column_unary(e, op, &s[sp - 1], store[sp - 1], m);
+			continue;
+		}
+		assert(sp >= 2);
+		sp--;
+		if (column_check(e, op, &s[sp - 1], &s[sp], m) < 0)
+			return -1;
+		column_binary(e, op, &s[sp - 1], &s[sp], store[sp - 1], m);
+	}
+	assert(sp == 1);
+	for (size_t i = 0; i < m; i++)
+		out[i] = s[0].scalar ? s[0].k : s[0].v[i];
+	return 0;
+}
 
+int qexpr_run_n(qexpr_t *e, const q_t *const *columns, const size_t n, q_t *out) {
+	assert(e);
+	assert(e->initialized);
+	assert(e->code);
+	assert(out);
+	e->error = 0;
+	e->error_string[0] = 0;
+	if (!(e->code_count)) {
+		error(e, "no compiled expression");
+		return -1;
+	}
+	size_t sp = 0;
+	const size_t depth = code_depth(e, &sp);
+	if (sp != 1) {
+		error(e, "invalid expression: %d", (int)sp);
+		return -1;
+	}
+	if (depth > CONFIG_Q_EXPR_DEPTH) {
+		error(e, "expression too deep: %d", (int)depth);
+		return -1;
+	}
+	for (size_t i = 0; i < n; i += CONFIG_Q_EXPR_BLOCK)
+		if (qexpr_run_block(e, columns, i, MIN(n - i, (size_t)CONFIG_Q_EXPR_BLOCK), &out[i]) < 0)
+			return -1;
+	return 0;
+}
@@ -16,6 +16,7 @@ extern "C" {
 
 #define QMAX_ID     (32)
 #define QMAX_ERROR  (256)
+#define QMAX_TOKEN  (64)
 
 #define QBITS       (16)
 #define QMASK       ((1ULL <<  QBITS) - 1ULL)
@@ -33,6 +34,17 @@ extern "C" {
 #define POSTPACK
 #endif
 
+/* Defining 'Q_INLINE_IMPL' before including this header makes the core
+ * arithmetic, comparison and rounding functions (those marked 'QINLINE')
+ * 'static inline', they then use 'Q_BOUND_SATURATE' (the default) or
+ * 'Q_BOUND_WRAP' on overflow instead of 'qconf.bound'. The rest of the
+ * library is still needed. */
+#ifdef Q_INLINE_IMPL
+#define QINLINE static inline
+#else
+#define QINLINE
+#endif
+
 #ifndef RESTRICT
 #ifdef __cplusplus
 #define RESTRICT
@@ -67,14 +79,82 @@ typedef PREPACK struct {
 	q_t rc,        /* time constant */
 	    time,      /* time of previous measurement */
 	    raw,       /* previous raw value */
-	    filtered;  /* filtered value */
+	    filtered,  /* filtered value */
+	    dt,        /* fixed sample period, zero if time is given with each sample */
+	    low, high; /* 'alpha' for the low and high pass filters if 'dt' is fixed */
 } POSTPACK qfilter_t;  /* High/Low Pass Filter */
+typedef PREPACK struct {
+	q_t b0, b1, b2, a1, a2; /* coefficients, 'a0' is one: y = b0*x + b1*x1 + b2*x2 - a1*y1 - a2*y2 */
+	q_t x1, x2, y1, y2;     /* previous inputs and outputs */
+} POSTPACK qbiquad_t; /* Biquad (second order IIR) filter section, Direct Form I */
+typedef PREPACK struct {
+	const q_t *taps; /* 'taps[0]' multiplies the newest sample */
+	q_t *history;    /* '2*length' previous inputs, see 'qfir_init' */
+	size_t length, index;
+} POSTPACK qfir_t; /* Finite Impulse Response filter */
+typedef PREPACK struct {
+	uint64_t reciprocal; /* floor((2^64 - 1) / abs(divisor)) */
+	q_t divisor;
+} POSTPACK qrecip_t; /* Precomputed reciprocal, see 'qrecip_init' */
 
 typedef PREPACK struct {
 	q_t d_gain, d_state;               /* differentiator; gain, state */
 	q_t i_gain, i_state, i_min, i_max; /* integrator; gain, state, minimum and maximum */
 	q_t p_gain;                        /* proportional gain */
+	q_t d_alpha, d_filtered;           /* differentiator filter, 'qpid_update_dt' only; coefficient (zero disables), state */
 } POSTPACK qpid_t; /* PID Controller <https://en.wikipedia.org/wiki/PID_controller> */
+typedef PREPACK struct {
+	q_t *p_gain, *i_gain, *d_gain;     /* gains */
+	q_t *i_state, *i_min, *i_max;      /* integrator; state, minimum and maximum */
+	q_t *d_state;                      /* differentiator; previous position */
+	q_t *d_alpha, *d_filtered;         /* differentiator filter, 'qpid_bank_update_dt' only, may be NULL */
+} POSTPACK qpid_bank_t; /* Many independent PID controllers, stored as an array per field */
+
+typedef PREPACK struct {
+	q_t *data;            /* element (i, j) is 'data[i*row_stride + j*column_stride]' */
+	size_t rows, columns;
+	size_t row_stride;    /* elements between the start of each row */
+	size_t column_stride; /* elements between each column, one unless transposed */
+} POSTPACK qview_t; /* view of matrix elements stored elsewhere, see 'qview' */
+
+typedef PREPACK struct {
+	uint64_t s; /* wrapping sum of double width products */
+	ld_t h;     /* sum of the upper 32-bits of each product */
+	size_t n;   /* number of products */
+} POSTPACK qacc_t; /* exact sum of products accumulator, zero initialise, see 'qacc_result' */
+
+typedef PREPACK struct {
+	d_t base;               /* base of the numbers, ten has a fast path */
+	u_t dp;                 /* maximum decimal places to convert, as for 'qnconvbdp' */
+	int error;              /* first error encountered, it is sticky */
+	size_t length;          /* characters held in 'token' */
+	char token[QMAX_TOKEN]; /* number split across two chunks of input */
+} POSTPACK qparse_t; /* streaming parser state, see 'qparse' */
+
+typedef q_t (*qbounds_t)(ld_t s);
+
+q_t qbound_saturate(ld_t s); /* default over/underflow behavior, saturation */
+q_t qbound_wrap(ld_t s);     /* over/underflow behavior, wrap around */
+
+typedef PREPACK struct {
+	qbounds_t bound; /* handles saturation when a number over or underflows */
+	int dp;          /* decimal points to print, negative specifies maximum precision */
+	unsigned base;   /* base to use for numeric number conversion */
+} POSTPACK qconf_t; /* Q format configuration options */
+typedef qconf_t qctx_t; /* a context, for the '_ctx' functions, 'qconf' is the default one */
+
+typedef enum {
+	QSTAT_ADD, QSTAT_SUB, QSTAT_MUL, QSTAT_DIV, QSTAT_FMA, QSTAT_SHIFT,
+	QSTAT_EXP, QSTAT_SUM, QSTAT_CONVERT, QSTAT_OTHER,
+	QSTAT_OPERATIONS
+} qstat_operation_t; /* kinds of operation counted by 'qstats', 'QSTAT_DIV' is division overflow */
+
+enum { QSTAT_OPERATORS = 96, }; /* at least the number of expression operators, see 'qop_at' */
+
+typedef PREPACK struct {
+	unsigned long long bounded[QSTAT_OPERATIONS]; /* results out of range, passed to the 'bound' handler */
+	unsigned long long domain[QSTAT_OPERATORS];   /* failed argument checks in 'qexpr', by 'qop_at' index */
+} POSTPACK qstats_t; /* instrumentation counters, kept per thread if the library is built with 'CONFIG_Q_STATS' */
 
 struct qexpr;
 typedef struct qexpr qexpr_t;
@@ -97,38 +177,43 @@ typedef PREPACK struct {
 	q_t value;
 } POSTPACK qvariable_t; /* Variable which can be used with the expression evaluator */
 
+typedef PREPACK struct {
+	const qoperations_t *op; /* operator to apply, or NULL to push a value */
+	long variable;           /* index into 'vars' of value to push, or -1 for 'number' */
+	q_t number;
+} POSTPACK qinstruction_t; /* An instruction in a compiled expression, see 'qexpr_compile' */
+
 struct PREPACK qexpr {
 	const qoperations_t **ops, *lpar, *rpar, *negate, *minus;
 	qvariable_t **vars;
 	char id[QMAX_ID];
 	char error_string[QMAX_ERROR];
 	q_t number;
+	long variable; /* index of variable lexed, if any */
 	const qoperations_t *op;
 	q_t *numbers;
+	qinstruction_t *code; /* optional, for 'qexpr_compile' */
+	long *hash;           /* optional, index of 'vars' built by 'qexpr_hash' */
+	qctx_t *ctx;          /* optional, NULL uses 'qconf' */
 	size_t ops_count, ops_max;
 	size_t numbers_count, numbers_max;
+	size_t code_count, code_max;
+	size_t hash_count, hash_max; /* 'hash_count' is the number of 'vars' indexed */
 	size_t id_count;
-	size_t vars_max;
+	size_t vars_max, vars_limit; /* 'vars_limit' is the room in 'vars', for 'qexpr_arena' only */
+	size_t depth;                /* number stack needed by 'code', set by 'qexpr_compile' */
+	unsigned char *arena;        /* optional, buffer holding all of the above, see 'qexpr_arena' */
+	size_t arena_count, arena_top, arena_mark, arena_max; /* variables grow up from 'mark', stacks down from 'max' */
 	int error;
 	int initialized;
+	int compiling;
 } POSTPACK; /* An expression evaluator for the Q library */
 
-typedef q_t (*qbounds_t)(ld_t s);
-
-q_t qbound_saturate(ld_t s); /* default over/underflow behavior, saturation */
-q_t qbound_wrap(ld_t s);     /* over/underflow behavior, wrap around */
-
-typedef PREPACK struct {
-	qbounds_t bound; /* handles saturation when a number over or underflows */
-	int dp;          /* decimal points to print, negative specifies maximum precision */
-	unsigned base;   /* base to use for numeric number conversion */
-} POSTPACK qconf_t; /* Q format configuration options */
-
 extern const qinfo_t qinfo; /* information about the format and constants */
-extern qconf_t qconf;       /* @warning GLOBAL Q configuration options */
+extern qconf_t qconf;       /* @warning GLOBAL Q configuration options, the default context */
 
-int qtoi(q_t toi);
-q_t qint(int toq);
+QINLINE int qtoi(q_t toi);
+QINLINE q_t qint(int toq);
 signed char qtoc(const q_t q);
 q_t qchar(signed char c);
 short qtoh(const q_t q);
@@ -138,47 +223,82 @@ q_t qlong(long l);
 long long qtoll(const q_t q);
 q_t qvlong(long long ll);
 
-q_t qisnegative(q_t a);
-q_t qispositive(q_t a);
-q_t qisinteger(q_t a);
-q_t qisodd(q_t a);
-q_t qiseven(q_t a);
-
-q_t qless(q_t a, q_t b);
-q_t qmore(q_t a, q_t b);
-q_t qeqless(q_t a, q_t b);
-q_t qeqmore(q_t a, q_t b);
-q_t qequal(q_t a, q_t b);
-q_t qunequal(q_t a, q_t b);
+QINLINE q_t qisnegative(q_t a);
+QINLINE q_t qispositive(q_t a);
+QINLINE q_t qisinteger(q_t a);
+QINLINE q_t qisodd(q_t a);
+QINLINE q_t qiseven(q_t a);
+
+QINLINE q_t qless(q_t a, q_t b);
+QINLINE q_t qmore(q_t a, q_t b);
+QINLINE q_t qeqless(q_t a, q_t b);
+QINLINE q_t qeqmore(q_t a, q_t b);
+QINLINE q_t qequal(q_t a, q_t b);
+QINLINE q_t qunequal(q_t a, q_t b);
 q_t qapproxequal(q_t a, q_t b, q_t epsilon);
 q_t qapproxunequal(q_t a, q_t b, q_t epsilon);
 q_t qwithin(q_t v, q_t b1, q_t b2);
 q_t qwithin_interval(q_t v, q_t expected, q_t allowance);
 
-q_t qnegate(q_t a);
-q_t qmin(q_t a, q_t b);
-q_t qmax(q_t a, q_t b);
-q_t qabs(q_t a);
-q_t qcopysign(q_t a, q_t b);
-q_t qsign(q_t a);
-q_t qsignum(q_t a);
-
-q_t qadd(q_t a, q_t b);
-q_t qsub(q_t a, q_t b);
-q_t qmul(q_t a, q_t b);
-q_t qdiv(q_t a, q_t b);
+QINLINE q_t qnegate(q_t a);
+QINLINE q_t qmin(q_t a, q_t b);
+QINLINE q_t qmax(q_t a, q_t b);
+QINLINE q_t qabs(q_t a);
+QINLINE q_t qcopysign(q_t a, q_t b);
+QINLINE q_t qsign(q_t a);
+QINLINE q_t qsignum(q_t a);
+
+QINLINE q_t qadd(q_t a, q_t b);
+QINLINE q_t qsub(q_t a, q_t b);
+QINLINE q_t qmul(q_t a, q_t b);
+QINLINE q_t qdiv(q_t a, q_t b);
+q_t qadd_ctx(const qctx_t *c, q_t a, q_t b); /* as 'qadd', with the bounds handler of 'c' */
+q_t qsub_ctx(const qctx_t *c, q_t a, q_t b);
+q_t qmul_ctx(const qctx_t *c, q_t a, q_t b);
+q_t qdiv_ctx(const qctx_t *c, q_t a, q_t b);
+qrecip_t qrecip_init(q_t d); /* precompute a reciprocal for repeated division by 'd' */
+q_t qdiv_by(const qrecip_t *r, q_t a); /* same as 'qdiv(a, d)' */
+void qdiv_by_n(q_t *r, const q_t *a, const qrecip_t *d, size_t n);
+void qdiv_scalar_n(q_t *r, const q_t *a, q_t s, size_t n);
 q_t qrem(q_t a, q_t b);
 q_t qmod(q_t a, q_t b);
-q_t qfma(q_t a, q_t b, q_t c);
+QINLINE q_t qfma(q_t a, q_t b, q_t c);
 q_t qsqr(q_t x);
 q_t qexp(q_t e);
 q_t qlog(q_t n);
+void qexp_n(q_t *r, const q_t *a, size_t n);
+void qlog_n(q_t *r, const q_t *a, size_t n);
 q_t qsqrt(q_t x);
-
-q_t qround(q_t q);
-q_t qceil(q_t q);
-q_t qtrunc(q_t q);
-q_t qfloor(q_t q);
+q_t qrsqrt(q_t x); /* 1/sqrt(x) */
+void qsqrt_n(q_t *r, const q_t *a, size_t n);
+void qrsqrt_n(q_t *r, const q_t *a, size_t n);
+
+/* Bulk operations on arrays of 'n' elements, 'r' may alias an input */
+
+void qadd_n(q_t *r, const q_t *a, const q_t *b, size_t n);
+void qsub_n(q_t *r, const q_t *a, const q_t *b, size_t n);
+void qmul_n(q_t *r, const q_t *a, const q_t *b, size_t n);
+void qfma_n(q_t *r, const q_t *a, const q_t *b, const q_t *c, size_t n); /* r = (a*b)+c */
+void qadd_scalar_n(q_t *r, const q_t *a, q_t s, size_t n);
+void qsub_scalar_n(q_t *r, const q_t *a, q_t s, size_t n);
+void qmul_scalar_n(q_t *r, const q_t *a, q_t s, size_t n);
+void qfma_scalar_n(q_t *r, const q_t *a, q_t s, const q_t *c, size_t n); /* r = (a*s)+c */
+
+q_t qdot(const q_t *a, const q_t *b, size_t n); /* sum of a*b, accumulated exactly and rounded once */
+q_t qsum(const q_t *a, size_t n);
+q_t qsumsq(const q_t *a, size_t n); /* sum of squares */
+void qaxpy(q_t *y, q_t alpha, const q_t *x, size_t n); /* y = (alpha*x)+y */
+size_t qargmin(const q_t *a, size_t n); /* index of first minimum, zero if n is */
+size_t qargmax(const q_t *a, size_t n); /* index of first maximum, zero if n is */
+void qacc_dot(qacc_t *acc, const q_t *a, const q_t *b, size_t n); /* add sum of a*b to 'acc' */
+void qacc_sum(qacc_t *acc, const q_t *a, size_t n);
+void qacc_merge(qacc_t *acc, const qacc_t *other); /* combine partial sums, from a split of a vector */
+q_t qacc_result(const qacc_t *acc);
+
+QINLINE q_t qround(q_t q);
+QINLINE q_t qceil(q_t q);
+QINLINE q_t qtrunc(q_t q);
+QINLINE q_t qfloor(q_t q);
 
 q_t qand(q_t a, q_t b);
 q_t qxor(q_t a, q_t b);
@@ -203,6 +323,18 @@ int qconv(q_t *q, const char *s);
 int qconvb(q_t *q, const char * const s, d_t base);
 int qnconvbdp(q_t *q, const char *s, size_t length, d_t base, u_t idp);
 
+void qparse_init(qparse_t *p, d_t base, u_t dp);
+int qparse(qparse_t *p, const char *s, size_t length, q_t *q, size_t n, size_t *used); /* numbers stored, or negative on error */
+int qparse_end(qparse_t *p, q_t *q); /* convert any last number, returns number stored or negative */
+size_t qsprint_n(char *s, size_t length, const q_t *q, size_t n, d_t dp, char separator, size_t *used); /* base ten, not NUL terminated */
+
+int qsprint_ctx(const qctx_t *c, q_t p, char *s, size_t length);
+int qsprintb_ctx(const qctx_t *c, q_t p, char *s, size_t length, u_t base);
+int qnconv_ctx(const qctx_t *c, q_t *q, const char *s, size_t length);
+int qnconvb_ctx(const qctx_t *c, q_t *q, const char *s, size_t length, d_t base);
+int qconv_ctx(const qctx_t *c, q_t *q, const char *s);
+int qconvb_ctx(const qctx_t *c, q_t *q, const char * const s, d_t base);
+
 void qsincos(q_t theta, q_t *sine, q_t *cosine);
 q_t qsin(q_t theta);
 q_t qcos(q_t theta);
@@ -210,6 +342,11 @@ q_t qtan(q_t theta);
 q_t qcot(q_t theta);
 q_t qhypot(q_t a, q_t b);
 
+void qsincos_n(const q_t *theta, q_t *sine, q_t *cosine, size_t n);
+void qatan2_n(q_t *r, const q_t *a, const q_t *b, size_t n);
+void qhypot_n(q_t *r, const q_t *a, const q_t *b, size_t n);
+void qrec2pol_n(const q_t *i, const q_t *j, q_t *magnitude, q_t *theta, size_t n);
+
 q_t qatan(q_t t);
 q_t qatan2(q_t x, q_t y);
 q_t qasin(q_t t);
@@ -231,6 +368,7 @@ q_t qcordic_mul(q_t a, q_t b); /* CORDIC testing only; do not use */
 q_t qcordic_div(q_t a, q_t b); /* CORDIC testing only; do not use */
 q_t qcordic_circular_gain(int n);
 q_t qcordic_hyperbolic_gain(int n);
+void qcordic_sincos(q_t theta, q_t *sine, q_t *cosine, int iterations); /* CORDIC testing only; 'iterations' < 0 for all */
 
 void qpol2rec(q_t magnitude, q_t theta, q_t *i, q_t *j);
 void qrec2pol(q_t i, q_t j, q_t *magnitude, q_t *theta);
@@ -243,15 +381,34 @@ d_t dlog(d_t n, unsigned base);
 d_t arshift(d_t v, unsigned p);
 int qpack(const q_t *q, char *buffer, size_t length);
 int qunpack(q_t *q, const char *buffer, size_t length);
+int qpack_n(const q_t *q, size_t n, char *buffer, size_t length); /* little endian, returns bytes written */
+int qunpack_n(q_t *q, size_t n, const char *buffer, size_t length);
 
 q_t qsimpson(q_t (*f)(q_t), q_t x1, q_t x2, unsigned n); /* numerical integrator of f, between x1, x2, for n steps */
+q_t qsimpson_adaptive(q_t (*f)(q_t), q_t x1, q_t x2, q_t tolerance, unsigned evaluations); /* at most 'evaluations' calls of f */
+q_t qsimpson_array(const q_t *y, size_t n, q_t h); /* integrate n samples (n odd) spaced h apart */
+q_t qtrapezoid_array(const q_t *y, size_t n, q_t h);
 
 void qfilter_init(qfilter_t *f, q_t time, q_t rc, q_t seed);
 q_t qfilter_low_pass(qfilter_t *f, q_t time, q_t data);
 q_t qfilter_high_pass(qfilter_t *f, q_t time, q_t data);
 q_t qfilter_value(const qfilter_t *f);
+void qfilter_init_fixed(qfilter_t *f, q_t dt, q_t rc, q_t seed); /* fixed sample rate, 'alpha' is computed once */
+int qfilter_low_pass_block(qfilter_t *f, q_t *data, size_t n);  /* in place, needs a fixed rate filter */
+int qfilter_high_pass_block(qfilter_t *f, q_t *data, size_t n); /* in place, needs a fixed rate filter */
+
+void qbiquad_init(qbiquad_t *f, q_t b0, q_t b1, q_t b2, q_t a1, q_t a2);
+q_t qbiquad_update(qbiquad_t *f, q_t x);
+void qbiquad_block(qbiquad_t *f, size_t stages, q_t *data, size_t n); /* 'stages' sections in cascade, in place */
+
+void qfir_init(qfir_t *f, const q_t *taps, size_t length, q_t *history); /* 'history' needs '2*length' elements */
+q_t qfir_update(qfir_t *f, q_t x);
+void qfir_block(qfir_t *f, q_t *data, size_t n); /* in place */
 
 q_t qpid_update(qpid_t *pid, const q_t error, const q_t position);
+q_t qpid_update_dt(qpid_t *pid, q_t error, q_t position, q_t dt); /* 'dt' is the time since the last update */
+void qpid_bank_update(qpid_bank_t *bank, const q_t *errors, const q_t *positions, q_t *outputs, size_t n);
+void qpid_bank_update_dt(qpid_bank_t *bank, const q_t *errors, const q_t *positions, q_t *outputs, q_t dt, size_t n);
 
 /* A matrix consists of at least four elements, a meta data field, 
  * the length of the array (which must be big enough to store 
@@ -277,7 +434,11 @@ int qmatrix_copy(q_t *r, const q_t *a);
 size_t qmatrix_string_length(const q_t *m);
 
 q_t qmatrix_trace(const q_t *m);
-q_t qmatrix_determinant(const q_t *m);
+int qmatrix_determinant(q_t *det, const q_t *m, q_t *workspace); /* 'workspace' is used for 'qmatrix_lu', -1 if too small */
+int qmatrix_lu(q_t *lu, const q_t *m); /* 'lu' needs n*(n+1) elements, -1 if singular */
+q_t qmatrix_lu_determinant(const q_t *lu);
+int qmatrix_solve(q_t *x, const q_t *lu, const q_t *b); /* solve 'A*x = b' given 'lu' of 'A', 'x' may be 'b' */
+int qmatrix_inverse(q_t *r, const q_t *a, q_t *workspace); /* 'workspace' is used for 'qmatrix_lu' */
 q_t qmatrix_equal(const q_t *a, const q_t *b);
 
 int qmatrix_zero(q_t *r);
@@ -296,9 +457,11 @@ int qmatrix_transpose(q_t * RESTRICT r, const q_t * RESTRICT m);
 int qmatrix_add(q_t * RESTRICT r, const q_t *a, const q_t *b);
 int qmatrix_sub(q_t * RESTRICT r, const q_t *a, const q_t *b);
 int qmatrix_mul(q_t * RESTRICT r, const q_t *a, const q_t *b);
+int qmatrix_mul_rows(q_t * RESTRICT r, const q_t *a, const q_t *b, size_t first, size_t last); /* rows [first, last) of a*b, r must be sized */
 int qmatrix_and(q_t *r, const q_t *a, const q_t *b);
 int qmatrix_or (q_t *r, const q_t *a, const q_t *b);
 int qmatrix_xor(q_t *r, const q_t *a, const q_t *b);
+int qmatrix_fma(q_t *r, const q_t *a, const q_t *b, const q_t *c); /* r = (a*b)+c, elementwise */
 
 int qmatrix_scalar_add(q_t *r, const q_t *a, const q_t scalar);
 int qmatrix_scalar_sub(q_t *r, const q_t *a, const q_t scalar);
@@ -309,6 +472,92 @@ int qmatrix_scalar_rem(q_t *r, const q_t *a, const q_t scalar);
 int qmatrix_scalar_and(q_t *r, const q_t *a, const q_t scalar);
 int qmatrix_scalar_or (q_t *r, const q_t *a, const q_t scalar);
 int qmatrix_scalar_xor(q_t *r, const q_t *a, const q_t scalar);
+int qmatrix_scalar_fma(q_t *r, const q_t *a, const q_t scalar, const q_t *c); /* r = (a*scalar)+c */
+
+/* A view refers to the elements of a matrix, or of any other buffer, without
+ * copying them. Views of sub-matrices, rows, columns and transpositions can
+ * be taken of other views. As views cannot be resized, a result view must be
+ * the right shape already, otherwise -1 is returned. */
+qview_t qview(q_t *data, size_t rows, size_t columns, size_t row_stride); /* view over an existing buffer */
+qview_t qview_matrix(q_t *m); /* view of all of matrix 'm' */
+qview_t qview_block(qview_t v, size_t row, size_t column, size_t rows, size_t columns); /* sub-matrix at (row, column) */
+qview_t qview_row(qview_t v, size_t row);
+qview_t qview_column(qview_t v, size_t column);
+qview_t qview_transpose(qview_t v);
+
+int qview_apply_unary(qview_t r, qview_t a, q_t (*func)(q_t));
+int qview_apply_scalar(qview_t r, qview_t a, q_t (*func)(q_t, q_t), const q_t c);
+int qview_apply_binary(qview_t r, qview_t a, qview_t b, q_t (*func)(q_t, q_t));
+int qview_sprintb(qview_t m, char *str, size_t length, unsigned base);
+int qview_copy(qview_t r, qview_t a);
+size_t qview_string_length(qview_t m);
+
+q_t qview_trace(qview_t m);
+int qview_determinant(q_t *det, qview_t m, q_t *workspace);
+int qview_lu(q_t *lu, qview_t m); /* 'lu' is a matrix, see 'qmatrix_lu' */
+int qview_solve(qview_t x, const q_t *lu, qview_t b);
+int qview_inverse(qview_t r, qview_t a, q_t *workspace);
+q_t qview_equal(qview_t a, qview_t b);
+
+int qview_zero(qview_t r);
+int qview_one(qview_t r);
+int qview_identity(qview_t r);
+
+int qview_logical(qview_t r, qview_t a);
+int qview_not(qview_t r, qview_t a);
+int qview_signum(qview_t r, qview_t a);
+int qview_invert(qview_t r, qview_t a);
+
+int qview_is_square(qview_t m);
+
+int qview_add(qview_t r, qview_t a, qview_t b);
+int qview_sub(qview_t r, qview_t a, qview_t b);
+int qview_mul(qview_t r, qview_t a, qview_t b); /* 'r' must not overlap 'a' or 'b' */
+int qview_and(qview_t r, qview_t a, qview_t b);
+int qview_or (qview_t r, qview_t a, qview_t b);
+int qview_xor(qview_t r, qview_t a, qview_t b);
+int qview_fma(qview_t r, qview_t a, qview_t b, qview_t c); /* r = (a*b)+c, elementwise */
+
+int qview_scalar_add(qview_t r, qview_t a, const q_t scalar);
+int qview_scalar_sub(qview_t r, qview_t a, const q_t scalar);
+int qview_scalar_mul(qview_t r, qview_t a, const q_t scalar);
+int qview_scalar_div(qview_t r, qview_t a, const q_t scalar);
+int qview_scalar_mod(qview_t r, qview_t a, const q_t scalar);
+int qview_scalar_rem(qview_t r, qview_t a, const q_t scalar);
+int qview_scalar_and(qview_t r, qview_t a, const q_t scalar);
+int qview_scalar_or (qview_t r, qview_t a, const q_t scalar);
+int qview_scalar_xor(qview_t r, qview_t a, const q_t scalar);
+int qview_scalar_fma(qview_t r, qview_t a, const q_t scalar, qview_t c); /* r = (a*scalar)+c, "axpy" if c is r */
+
+/* A file format for matrices and arrays (as a matrix with one row) that can
+ * be used without conversion once it is in memory, for example after being
+ * mapped with 'mmap'. All fields are little endian, the layout is:
+ *
+ *	offset  size  field
+ *	     0     4  magic, "QARR"
+ *	     4     2  version, one
+ *	     6     1  whole bits, 16 for 'q_t'
+ *	     7     1  fractional bits, 16 for 'q_t'
+ *	     8     4  offset of the data, a multiple of 64
+ *	    12     4  flags, zero
+ *	    16     4  rows
+ *	    20     4  columns
+ *	    24     8  Fletcher-64 checksum of the data
+ *	    32    16  reserved, zero
+ *	    48    16  'qmatrix' header of the data, '{ 0, rows*columns, rows, columns }'
+ *	    64     -  the data, row by row
+ *
+ * As the 'qmatrix' header comes just before the data a file in memory is
+ * directly usable as a matrix, if the machine is little endian and the
+ * buffer is aligned, see 'qfile_matrix' and 'qfile_view'. Otherwise the
+ * data can be copied out with 'qfile_unpack'. */
+size_t qfile_size(size_t rows, size_t columns); /* bytes needed to store a matrix, zero on overflow */
+int qfile_pack(char *file, size_t length, qview_t m);
+int qfile_check(const char *file, size_t length, size_t *rows, size_t *columns); /* validate header only, fast */
+int qfile_verify(const char *file, size_t length); /* 'qfile_check' and the checksum */
+q_t *qfile_matrix(char *file, size_t length); /* the data as a 'qmatrix' in place, or NULL */
+int qfile_view(char *file, size_t length, qview_t *v); /* the data as a view in place */
+int qfile_unpack(q_t *m, const char *file, size_t length); /* copy into a matrix, on any machine */
 
 /* Expression evaluator */
 
@@ -316,13 +565,140 @@ int qexpr(qexpr_t *e, const char *expr);
 int qexpr_init(qexpr_t *e);
 int qexpr_error(qexpr_t *e);
 q_t qexpr_result(qexpr_t *e);
+int qexpr_ctx(qexpr_t *e, qctx_t *c, const char *expr); /* as 'qexpr', setting 'e->ctx', every operator uses its bounds */
+int qexpr_compile(qexpr_t *e, const char *expr); /* compile into 'e->code' for 'qexpr_run' */
+int qexpr_compile_ctx(qexpr_t *e, qctx_t *c, const char *expr);
+int qexpr_run(qexpr_t *e, const q_t *vars); /* 'vars' has a value for each of 'e->vars', or NULL */
+int qexpr_run_n(qexpr_t *e, const q_t *const *columns, size_t n, q_t *out); /* 'n' rows, a column per variable */
+int qexpr_hash(qexpr_t *e); /* index 'vars' in 'hash', 'hash_max' must be a power of two > 'vars_max' */
+long qexpr_variable(qexpr_t *e, const char *name); /* find variable, returns index into 'vars' or -1 */
+qexpr_t *qexpr_arena(void *buffer, size_t size, size_t vars); /* context in 'buffer', room for 'vars' variables, or NULL */
+qvariable_t *qexpr_arena_variable(qexpr_t *e, const char *name, q_t value); /* add or set, NULL if no room */
+int qexpr_reset(qexpr_t *e); /* O(1), forget the variables, code and stacks of a 'qexpr_arena' context */
 const qoperations_t *qop(const char *op);
+const qoperations_t *qop_at(size_t i); /* walk the operator table, NULL past the end */
+int qstats(qstats_t *s);  /* copy this thread's counters, zeros and -1 if not built with 'CONFIG_Q_STATS' */
+int qstats_reset(void);   /* zero this thread's counters, -1 if not built with 'CONFIG_Q_STATS' */
 
 /* A better cosine/sine, not in Q format */
 
 int16_t furman_sin(int16_t x); /* SINE:   1 Furman = 1/65536 of a circle */
 int16_t furman_cos(int16_t x); /* COSINE: 1 Furman = 1/65536 of a circle */
 
+typedef PREPACK struct {
+	u_t phase;      /* 1/2^32 of a circle, the top 16 bits are a Furman angle */
+	u_t increment;  /* added to 'phase' after every sample */
+	const q_t *table; /* optional, one cycle of a waveform in '1 << bits' entries, NULL for sine */
+	unsigned bits;  /* 1 to 16 when there is a 'table' */
+} POSTPACK qnco_t; /* numerically controlled oscillator, see 'qnco_init' */
+
+void qnco_init(qnco_t *o, q_t frequency, q_t rate);     /* phase zero, 'frequency/rate' of a circle a sample, same units */
+void qnco_sin_n(qnco_t *o, q_t *sine, size_t n);        /* next 'n' samples, advances the phase */
+void qnco_cos_n(qnco_t *o, q_t *cosine, size_t n);      /* a quarter cycle ahead of 'qnco_sin_n' */
+void qnco_iq_n(qnco_t *o, q_t *i, q_t *q, size_t n);    /* in phase (cosine) and quadrature (sine) */
+
+typedef PREPACK struct {
+	size_t n;      /* transform size, a power of two */
+	q_t *twiddle;  /* 'n' numbers, 'cos' and '-sin' of '2*pi*k/n' for k < n/2 */
+} POSTPACK qfft_t; /* Fast Fourier Transform plan, see 'qfft_init' */
+
+int qfft_init(qfft_t *p, q_t *twiddle, size_t n);    /* 'twiddle' holds 'n' numbers, -1 if 'n' is not a power of two */
+int qfft(const qfft_t *p, q_t *x, int *exponent);    /* in place, 'n' interleaved complex numbers, result is 'x * 2^exponent' */
+int qifft(const qfft_t *p, q_t *x, int *exponent);   /* inverse of 'qfft', including the division by 'n' */
+int qfft_real(const qfft_t *p, q_t *x, int *exponent);  /* 'n' real numbers, result packed as DC, Nyquist then bins 1 to n/2-1 */
+int qifft_real(const qfft_t *p, q_t *x, int *exponent); /* inverse of 'qfft_real' */
+void qfft_polar(const q_t *x, q_t *magnitude, q_t *phase, size_t n); /* 'n' interleaved complex numbers, as 'qrec2pol' */
+
+/* Table driven sin/cos/exp/log, faster but less accurate, see readme */
+
+q_t qsin_lut(q_t theta);
+q_t qcos_lut(q_t theta);
+q_t qexp_lut(q_t e);
+q_t qlog_lut(q_t x);
+
+#ifdef Q_INLINE_IMPL
+
+#if defined(Q_BOUND_SATURATE) && defined(Q_BOUND_WRAP)
+#error "Only one of Q_BOUND_SATURATE or Q_BOUND_WRAP may be defined"
+#endif
+
+#include <assert.h>
+
+static inline q_t qsat_inline(const ld_t s) { /* same as 'qbound_saturate'/'qbound_wrap' */
+#ifdef Q_BOUND_WRAP
+	if (s > INT32_MAX) return INT32_MIN + (s % INT32_MAX);
+	if (s < INT32_MIN) return INT32_MAX - ((-s) % INT32_MAX);
+	return s;
+#else
+	return s > INT32_MAX ? INT32_MAX : s < INT32_MIN ? INT32_MIN : (q_t)s;
+#endif
+}
+
+static inline ld_t qmultiply_inline(const q_t a, const q_t b) { /* rounded, arithmetic shift right */
+	const ld_t dd = ((ld_t)a * (ld_t)b) + (int64_t)QHIGH;
+	return dd < 0 ? (ld_t)(~(~(uint64_t)dd >> QBITS)) : (ld_t)((uint64_t)dd >> QBITS);
+}
+
+static inline int qtoi(const q_t toi)                 { return ((uint64_t)((ld_t)toi)) >> QBITS; }
+static inline q_t qint(const int toq)                 { return ((u_t)((d_t)toq)) << QBITS; }
+
+static inline q_t qisnegative(const q_t a)            { return QINT(!!(((u_t)a >> QBITS) & QHIGH)); }
+static inline q_t qispositive(const q_t a)            { return QINT(!(((u_t)a >> QBITS) & QHIGH)); }
+static inline q_t qisinteger(const q_t a)             { return QINT(!((u_t)a & QMASK)); }
+static inline q_t qisodd(const q_t a)                 { return QINT(qisinteger(a) &&  (((u_t)a >> QBITS) & 1)); }
+static inline q_t qiseven(const q_t a)                { return QINT(qisinteger(a) && !(((u_t)a >> QBITS) & 1)); }
+static inline q_t qless(const q_t a, const q_t b)     { return QINT(a < b); }
+static inline q_t qeqless(const q_t a, const q_t b)   { return QINT(a <= b); }
+static inline q_t qmore(const q_t a, const q_t b)     { return QINT(a > b); }
+static inline q_t qeqmore(const q_t a, const q_t b)   { return QINT(a >= b); }
+static inline q_t qequal(const q_t a, const q_t b)    { return QINT(a == b); }
+static inline q_t qunequal(const q_t a, const q_t b)  { return QINT(a != b); }
+
+static inline q_t qnegate(const q_t a)                { return (~(u_t)a) + 1ULL; }
+static inline q_t qmin(const q_t a, const q_t b)      { return a < b ? a : b; }
+static inline q_t qmax(const q_t a, const q_t b)      { return a > b ? a : b; }
+static inline q_t qabs(const q_t a)                   { return a < 0 ? qnegate(a) : a; }
+static inline q_t qcopysign(const q_t a, const q_t b) { return b < 0 ? qnegate(qabs(a)) : qabs(a); }
+static inline q_t qsign(const q_t a)                  { return a < 0 ? -QINT(1) : QINT(1); }
+static inline q_t qsignum(const q_t a)                { return a ? qsign(a) : QINT(0); }
+
+static inline q_t qadd(const q_t a, const q_t b)      { return qsat_inline((ld_t)a + (ld_t)b); }
+static inline q_t qsub(const q_t a, const q_t b)      { return qsat_inline((ld_t)a - (ld_t)b); }
+static inline q_t qmul(const q_t a, const q_t b)      { return qsat_inline(qmultiply_inline(a, b)); }
+
+static inline q_t qfma(const q_t a, const q_t b, const q_t c) {
+	return qsat_inline(qmultiply_inline(a, b) + (ld_t)c);
+}
+
+static inline q_t qdiv(const q_t a, const q_t b) { /* rounds to nearest, as the library does */
+	assert(b);
+	const ld_t dd = ((ld_t)a) << QBITS;
+	const d_t bd2 = b < 0 ? (d_t)~(~(u_t)b >> 1) : (d_t)((u_t)b >> 1);
+	return qsat_inline((dd + ((dd >= 0 && b > 0) || (dd < 0 && b < 0) ? bd2 : -bd2)) / b);
+}
+
+static inline q_t qfloor(const q_t q) { return q & ~QMASK; }
+
+static inline q_t qceil(q_t q) {
+	q = qadd(q, qisinteger(q) ? QINT(0) : QINT(1));
+	return ((u_t)q) & (QMASK << QBITS);
+}
+
+static inline q_t qtrunc(q_t q) {
+	q = qadd(q, q < 0 && ((u_t)q & QMASK) ? QINT(1) : QINT(0));
+	return ((u_t)q) & (QMASK << QBITS);
+}
+
+static inline q_t qround(q_t q) {
+	const int negative = q < 0;
+	q = qabs(q);
+	q = qadd(q, ((u_t)q & QMASK) & QHIGH ? QINT(1) : QINT(0));
+	q = ((u_t)q) & (QMASK << QBITS);
+	return negative ? qnegate(q) : q;
+}
+
+#endif /* Q_INLINE_IMPL */
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,234 @@
+/* Project: Q-Number (Q16.16, signed) library
+ * Author:  Richard James Howe
+ * License: The Unlicense
+ * Email:   howe.r.j.89@gmail.com
+ * Repo:    <https://github.com/q>
+ *
+ * Fixed point formats other than Q16.16 are generated from the templates
+ * in this header, 'QGEN(PREFIX, T, U, W, UW, FRACTIONAL)' makes a set of
+ * 'static inline' functions and a 'PREFIX##info' structure for a format
+ * stored in the signed type 'T' ('U' is its unsigned counterpart) with
+ * 'FRACTIONAL' (at most 32) fractional bits, 'W' and 'UW' must be twice as wide. The
+ * constants and the CORDIC tables, 'PREFIX##arctans' (atan(2^-i) from i = 0)
+ * and 'PREFIX##arctanhs' (atanh(2^-i) from i = 1), are derived at compile
+ * time from Q4.60 master values, rounded to nearest, and saturate if they
+ * cannot be represented (for example 'q15_info.pi'). The following are
+ * generated:
+ *
+ * - q8_  : Q8.8,   16 bits
+ * - q15_ : Q1.15,  16 bits
+ * - q32_ : Q32.32, 64 bits, if the compiler has a 128-bit integer type
+ *
+ * This is not the library in other formats, 'q.c' is still written by hand
+ * for Q16.16 and is not generated from these templates. Only a small core is
+ * generated: conversion, arithmetic (always saturating, with no bound handlers
+ * or contexts), rounding, square root, sine and cosine, some bulk functions
+ * and the tables. There is no exp, log, atan or hyperbolic function. */
+
+#ifndef QGEN_H
+#define QGEN_H
+
+#include "q.h"
+#include <assert.h>
+#include <limits.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define QGEN_MAX(T, U) ((T)(((U)-1) >> 1))
+#define QGEN_MIN(T, U) (-QGEN_MAX(T, U) - 1)
+#define QGEN_ONE(W, F) ((W)1 << (F))
+#define QGEN_K(F, K)   ((((int64_t)(K) >> (59 - (F))) + 1) >> 1) /* Q4.60 constant 'K' rounded to 'F' bits */
+#define QGEN_SAT(T, U, V) ((V) > QGEN_MAX(T, U) ? QGEN_MAX(T, U) : (T)(V))
+#define QGEN_BITS(T)   ((int)(sizeof (T) * CHAR_BIT))
+/* Fractional bits used inside 'sincos', as many as fit in 'W' for any
+ * input after scaling, and for '2*pi', capped by the Q4.60 constants */
+#define QGEN_GUARD(T, W, F) (QGEN_MIN3(QGEN_BITS(W) - QGEN_BITS(T) + (F) - 2, QGEN_BITS(W) - 4, 56))
+#define QGEN_MIN3(A, B, C) ((A) < (B) ? ((A) < (C) ? (A) : (C)) : ((B) < (C) ? (B) : (C)))
+
+#define QGEN_PI    (0x3243F6A8885A308Dll) /* Q4.60 constants, 3.243F6A8885A308D3... */
+#define QGEN_E     (0x2B7E151628AED2A7ll)
+#define QGEN_SQRT2 (0x16A09E667F3BCC91ll)
+#define QGEN_SQRT3 (0x1BB67AE8584CAA74ll)
+#define QGEN_LN2   (0x0B17217F7D1CF79Bll)
+#define QGEN_LN10  (0x24D763776AAA2B06ll)
+#define QGEN_GAIN  (0x09B74EDA8435E5A6ll) /* 1/CORDIC-gain, 0.60725293500888... */
+
+/* atan(2^0), atan(2^-1), ... in Q4.60, enough for 32 fractional bits,
+ * the later ones are just '2^-i' */
+#define QGEN_ARCTANS(X, F)\
+	X(F, 0x0C90FDAA22168C23ll) X(F, 0x076B19C1586ED3DAll) X(F, 0x03EB6EBF25901BACll) X(F, 0x01FD5BA9AAC2F6DCll)\
+	X(F, 0x00FFAADDB967EF4Ell) X(F, 0x007FF556EEA5D893ll) X(F, 0x003FFEAAB776E535ll) X(F, 0x001FFFD555BBBA97ll)\
+	X(F, 0x000FFFFAAAADDDDCll) X(F, 0x0007FFFF55556EEFll) X(F, 0x0003FFFFEAAAAB77ll) X(F, 0x0001FFFFFD55555Cll)\
+	X(F, 0x0000FFFFFFAAAAABll) X(F, 0x00007FFFFFF55555ll) X(F, 0x00003FFFFFFEAAABll) X(F, 0x00001FFFFFFFD555ll)\
+	X(F, 0x00000FFFFFFFFAABll) X(F, 0x000007FFFFFFFF55ll) X(F, 0x000003FFFFFFFFEBll) X(F, 0x000001FFFFFFFFFDll)\
+	X(F, 0x0000010000000000ll) X(F, 0x0000008000000000ll) X(F, 0x0000004000000000ll) X(F, 0x0000002000000000ll)\
+	X(F, 0x0000001000000000ll) X(F, 0x0000000800000000ll) X(F, 0x0000000400000000ll) X(F, 0x0000000200000000ll)\
+	X(F, 0x0000000100000000ll) X(F, 0x0000000080000000ll) X(F, 0x0000000040000000ll) X(F, 0x0000000020000000ll)\
+	X(F, 0x0000000010000000ll) X(F, 0x0000000008000000ll) X(F, 0x0000000004000000ll) X(F, 0x0000000002000000ll)
+
+/* atanh(2^-1), atanh(2^-2), ... in Q4.60, the later ones are just '2^-i' */
+#define QGEN_ARCTANHS(X, F)\
+	X(F, 0x08C9F53D5681854Cll) X(F, 0x04162BBEA045146All) X(F, 0x0202B12393D5DEEDll) X(F, 0x01005588AD375ACEll)\
+	X(F, 0x00800AAC448D7712ll) X(F, 0x004001556222B472ll) X(F, 0x0020002AAB111236ll) X(F, 0x001000055558888Bll)\
+	X(F, 0x00080000AAAAC444ll) X(F, 0x0004000015555622ll) X(F, 0x0002000002AAAAB1ll) X(F, 0x0001000000555556ll)\
+	X(F, 0x00008000000AAAABll) X(F, 0x0000400000015555ll) X(F, 0x0000200000002AABll) X(F, 0x0000100000000555ll)\
+	X(F, 0x00000800000000ABll) X(F, 0x0000040000000015ll) X(F, 0x0000020000000003ll) X(F, 0x0000010000000000ll)\
+	X(F, 0x0000008000000000ll) X(F, 0x0000004000000000ll) X(F, 0x0000002000000000ll) X(F, 0x0000001000000000ll)\
+	X(F, 0x0000000800000000ll) X(F, 0x0000000400000000ll) X(F, 0x0000000200000000ll) X(F, 0x0000000100000000ll)\
+	X(F, 0x0000000080000000ll) X(F, 0x0000000040000000ll) X(F, 0x0000000020000000ll) X(F, 0x0000000010000000ll)\
+	X(F, 0x0000000008000000ll) X(F, 0x0000000004000000ll) X(F, 0x0000000002000000ll) X(F, 0x0000000001000000ll)
+
+#define QGEN_ENTRY(F, K) QGEN_K(F, K),
+
+static inline ld_t qgen_ars(const ld_t v, const unsigned p) { return v < 0 ? ~(~v >> p) : v >> p; }
+
+#define QGEN_TYPES(P, T, U, W, UW, F)\
+	typedef T P##t;\
+	typedef PREPACK struct {\
+		size_t whole, fractional;\
+		P##t zero, bit, one, pi, e, sqrt2, sqrt3, ln2, ln10, min, max;\
+	} POSTPACK P##info_t;\
+	static const P##info_t P##info = { /* in the same order as 'P##info_t' */\
+		(sizeof (T) * CHAR_BIT) - (F), (F), 0, 1,\
+		QGEN_SAT(T, U, QGEN_ONE(W, F)),\
+		QGEN_SAT(T, U, QGEN_K(F, QGEN_PI)),\
+		QGEN_SAT(T, U, QGEN_K(F, QGEN_E)),\
+		QGEN_SAT(T, U, QGEN_K(F, QGEN_SQRT2)),\
+		QGEN_SAT(T, U, QGEN_K(F, QGEN_SQRT3)),\
+		QGEN_SAT(T, U, QGEN_K(F, QGEN_LN2)),\
+		QGEN_SAT(T, U, QGEN_K(F, QGEN_LN10)),\
+		QGEN_MIN(T, U),\
+		QGEN_MAX(T, U),\
+	};\
+	static const P##t P##arctans[]  = { QGEN_ARCTANS(QGEN_ENTRY, F) };\
+	static const P##t P##arctanhs[] = { QGEN_ARCTANHS(QGEN_ENTRY, F) };
+
+#define QGEN_ARITHMETIC(P, T, U, W, UW, F)\
+	static inline P##t P##sat(const W s) {\
+		return s > QGEN_MAX(T, U) ? QGEN_MAX(T, U) : s < QGEN_MIN(T, U) ? QGEN_MIN(T, U) : (P##t)s;\
+	}\
+	static inline W P##ars(const W v, const unsigned p) { return v < 0 ? ~(~v >> p) : v >> p; }\
+	static inline P##t P##int(const int i) {\
+		const ld_t v = (ld_t)i * ((ld_t)1 << ((F) < 32 ? (F) : 32));\
+		return v > QGEN_MAX(T, U) ? QGEN_MAX(T, U) : v < QGEN_MIN(T, U) ? QGEN_MIN(T, U) : (P##t)v;\
+	}\
+	static inline int P##toi(const P##t a) { return (int)P##ars(a, F); }\
+	static inline P##t P##from_q(const q_t q) { /* convert from Q16.16, rounding */\
+		const ld_t v = (F) >= QBITS ? (ld_t)q * ((ld_t)1 << ((F) >= QBITS ? (F) - QBITS : 0)) :\
+			qgen_ars((ld_t)q + ((ld_t)1 << ((F) < QBITS ? QBITS - (F) - 1 : 0)), (F) < QBITS ? QBITS - (F) : 0);\
+		return v > QGEN_MAX(T, U) ? QGEN_MAX(T, U) : v < QGEN_MIN(T, U) ? QGEN_MIN(T, U) : (P##t)v;\
+	}\
+	static inline q_t P##to_q(const P##t a) { /* convert to Q16.16, rounding and saturating */\
+		const W v = (F) <= QBITS ? (W)a * ((W)1 << ((F) <= QBITS ? QBITS - (F) : 0)) :\
+			P##ars((W)a + ((W)1 << ((F) > QBITS ? (F) - QBITS - 1 : 0)), (F) > QBITS ? (F) - QBITS : 0);\
+		return v > (W)INT32_MAX ? INT32_MAX : v < (W)INT32_MIN ? INT32_MIN : (q_t)v;\
+	}\
+	static inline P##t P##negate(const P##t a) { return (P##t)(U)(~(U)a + 1u); }\
+	static inline P##t P##abs(const P##t a) { return a < 0 ? P##negate(a) : a; }\
+	static inline P##t P##min(const P##t a, const P##t b) { return a < b ? a : b; }\
+	static inline P##t P##max(const P##t a, const P##t b) { return a > b ? a : b; }\
+	static inline P##t P##add(const P##t a, const P##t b) { return P##sat((W)a + (W)b); }\
+	static inline P##t P##sub(const P##t a, const P##t b) { return P##sat((W)a - (W)b); }\
+	static inline W P##multiply(const P##t a, const P##t b) {\
+		return P##ars(((W)a * (W)b) + QGEN_ONE(W, (F) - 1), F);\
+	}\
+	static inline P##t P##mul(const P##t a, const P##t b) { return P##sat(P##multiply(a, b)); }\
+	static inline P##t P##fma(const P##t a, const P##t b, const P##t c) {\
+		return P##sat(P##multiply(a, b) + (W)c);\
+	}\
+	static inline P##t P##div(const P##t a, const P##t b) { /* rounds to nearest */\
+		assert(b);\
+		const W dd = (W)a * QGEN_ONE(W, F);\
+		const W bd2 = P##ars(b, 1);\
+		return P##sat((dd + (((dd >= 0 && b > 0) || (dd < 0 && b < 0)) ? bd2 : -bd2)) / b);\
+	}
+
+#define QGEN_ROUNDING(P, T, U, W, UW, F)\
+	static inline P##t P##floor(const P##t a) {\
+		return (P##t)((U)a & (U)~(U)(QGEN_ONE(U, F) - 1u));\
+	}\
+	static inline P##t P##ceil(const P##t a) {\
+		const int integer = !((U)a & (U)(QGEN_ONE(U, F) - 1u));\
+		return P##floor(P##sat((W)a + (integer ? 0 : QGEN_ONE(W, F))));\
+	}\
+	static inline P##t P##trunc(const P##t a) {\
+		const int fraction = !!((U)a & (U)(QGEN_ONE(U, F) - 1u));\
+		return P##floor(P##sat((W)a + (a < 0 && fraction ? QGEN_ONE(W, F) : 0)));\
+	}\
+	static inline P##t P##round(const P##t a) {\
+		const P##t q = P##abs(a);\
+		const int half = !!((U)q & (U)QGEN_ONE(U, (F) - 1));\
+		const P##t r = P##floor(P##sat((W)q + (half ? QGEN_ONE(W, F) : 0)));\
+		return a < 0 ? P##negate(r) : r;\
+	}
+
+#define QGEN_FUNCTIONS(P, T, U, W, UW, F)\
+	static inline P##t P##sqrt(const P##t x) { /* round(sqrt(x * 2^F)), same as 'qsqrt' */\
+		assert(x >= 0);\
+		if (x <= 0)\
+			return 0;\
+		UW n = (UW)x << (F), r = 0, bit = (UW)1 << ((sizeof (UW) * CHAR_BIT) - 2);\
+		for (; bit; bit >>= 2) {\
+			const UW t = r + bit, mask = -(UW)(n >= t);\
+			n -= t & mask;\
+			r = (r >> 1) + (bit & mask);\
+		}\
+		return P##sat((W)(r + (n > r)));\
+	}\
+	static inline void P##sincos(const P##t theta, P##t *sine, P##t *cosine) { /* CORDIC */\
+		enum { G = QGEN_GUARD(T, W, F), };\
+		static const W arctans[] = { QGEN_ARCTANS(QGEN_ENTRY, G) };\
+		const W pi = QGEN_K(G, QGEN_PI), half_pi = QGEN_K(G, QGEN_PI / 2);\
+		W z = ((W)theta * QGEN_ONE(W, G - (F))) % (2 * pi), x = QGEN_K(G, QGEN_GAIN), y = 0;\
+		int negate = 0;\
+		if (z > pi) z -= 2 * pi;\
+		if (z < -pi) z += 2 * pi;\
+		if (z > half_pi) { z = pi - z; negate = 1; }\
+		if (z < -half_pi) { z = -pi - z; negate = 1; }\
+		for (unsigned i = 0; i < ((F) + 3u) && i < (sizeof (arctans) / sizeof (arctans[0])); i++) {\
+			const W xs = P##ars(y, i), ys = P##ars(x, i);\
+			if (z >= 0) { x -= xs; y += ys; z -= arctans[i]; }\
+			else        { x += xs; y -= ys; z += arctans[i]; }\
+		}\
+		x = negate ? -x : x;\
+		if (sine)\
+			*sine = P##sat(P##ars(y + QGEN_ONE(W, G - (F) - 1), G - (F)));\
+		if (cosine)\
+			*cosine = P##sat(P##ars(x + QGEN_ONE(W, G - (F) - 1), G - (F)));\
+	}\
+	static inline P##t P##sin(const P##t theta) { P##t s = 0; P##sincos(theta, &s, NULL); return s; }\
+	static inline P##t P##cos(const P##t theta) { P##t c = 0; P##sincos(theta, NULL, &c); return c; }\
+	static inline void P##add_n(P##t *r, const P##t *a, const P##t *b, const size_t n) {\
+		for (size_t i = 0; i < n; i++)\
+			r[i] = P##add(a[i], b[i]);\
+	}\
+	static inline void P##sub_n(P##t *r, const P##t *a, const P##t *b, const size_t n) {\
+		for (size_t i = 0; i < n; i++)\
+			r[i] = P##sub(a[i], b[i]);\
+	}\
+	static inline void P##mul_n(P##t *r, const P##t *a, const P##t *b, const size_t n) {\
+		for (size_t i = 0; i < n; i++)\
+			r[i] = P##mul(a[i], b[i]);\
+	}
+
+#define QGEN(P, T, U, W, UW, F)\
+	QGEN_TYPES(P, T, U, W, UW, F)\
+	QGEN_ARITHMETIC(P, T, U, W, UW, F)\
+	QGEN_ROUNDING(P, T, U, W, UW, F)\
+	QGEN_FUNCTIONS(P, T, U, W, UW, F)
+
+QGEN(q8_,  int16_t, uint16_t, int32_t, uint32_t,  8)
+QGEN(q15_, int16_t, uint16_t, int32_t, uint32_t, 15)
+
+#ifdef __SIZEOF_INT128__
+__extension__ typedef __int128 qgen_i128_t;
+__extension__ typedef unsigned __int128 qgen_u128_t;
+QGEN(q32_, int64_t, uint64_t, qgen_i128_t, qgen_u128_t, 32)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -9,13 +9,25 @@
  * it includes a command processor and some built in tests. View
  * the help string later on for more information */
 #include "q.h"
+#include "qgen.h"
 #include <assert.h>
 #include <ctype.h>
 #include <errno.h>
+#include <limits.h>
+#include <math.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+
+#ifndef CONFIG_Q_THREADS
+#define CONFIG_Q_THREADS (1) /* use POSIX threads for the accuracy sweep */
+#endif
+
+#if CONFIG_Q_THREADS > 0
+#include <pthread.h>
+#endif
 
 #define N    (16)
 #define BUILD_BUG_ON(condition) ((void)sizeof(char[1 - 2*!!(condition)]))
@@ -128,6 +140,7 @@ typedef enum {
 	EVAL_ERROR_ARG_COUNT_E,
 	EVAL_ERROR_UNEXPECTED_RESULT_E,
 	EVAL_ERROR_LIMIT_MODE_E,
+	EVAL_ERROR_CHECK_E,
 
 	EVAL_ERROR_MAX_ERRORS_E, /**< not an error, but a count of errors */
 } eval_errors_e;
@@ -145,6 +158,7 @@ static const char *eval_error(int e) {
 		[EVAL_ERROR_ARG_COUNT_E]         = "incorrect argument count",
 		[EVAL_ERROR_LIMIT_MODE_E]        = "unknown limit mode ('|' or '%' allowed)",
 		[EVAL_ERROR_UNEXPECTED_RESULT_E] = "unexpected result",
+		[EVAL_ERROR_CHECK_E]             = "argument check failed",
 	};
 	return msgs[e] ? msgs[e] : "unknown";
 }
@@ -221,12 +235,17 @@ static int eval(char *line, q_t *result) {
 		return -EVAL_ERROR_CONVERT_E;
 	if (qconv(&a1, arg1) < 0)
 		return -EVAL_ERROR_CONVERT_E;
+	qexpr_t checker = { .error = 0, }; /* checks are run as 'qexpr' would, 'base' sets 'qconf' in one */
 	switch (func->arity) {
-	case 1: if (eval_unary_arith(func->eval.unary, e, b, a1, result) < 0)
+	case 1: if (func->check.unary && func->check.unary(&checker, a1) < 0)
+			return -EVAL_ERROR_CHECK_E;
+		if (eval_unary_arith(func->eval.unary, e, b, a1, result) < 0)
 			return -EVAL_ERROR_UNEXPECTED_RESULT_E;
 		break;
 	case 2: if (qconv(&a2, arg2) < 0)
 			return -EVAL_ERROR_CONVERT_E;
+		if (func->check.binary && func->check.binary(&checker, a1, a2))
+			return -EVAL_ERROR_CHECK_E;
 		if (eval_binary_arith(func->eval.binary, e, b, a1, a2, result) < 0)
 			return -EVAL_ERROR_UNEXPECTED_RESULT_E;
 		break;
@@ -376,6 +395,310 @@ static int test_fma(void) {
 	return unit_test_finish(&t);
 }
 
+static q_t test_random(void) { /* xorshift32, deterministic test vectors */
+	static uint32_t x = 2463534242uL;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return x;
+}
+
+static int test_bulk(void) {
+	unit_test_t t = unit_test_start();
+	static const q_t edges[] = {
+		0, 1, -1, QINT(1), -QINT(1), QINT(2), 0x8000, -0x8000, 0x7FFF, 0x18000,
+		QINT(181), -QINT(181), QINT(182), -QINT(182), INT32_MAX, INT32_MIN,
+	};
+	const size_t edges_length = sizeof (edges) / sizeof (edges[0]);
+	enum { LENGTH = 1024 + 3, };
+	static q_t a[LENGTH], b[LENGTH], c[LENGTH], r[LENGTH];
+	for (size_t i = 0; i < LENGTH; i++) {
+		const int small = (i >> 4) & 1; /* mix of values that do and do not saturate */
+		a[i] = i < (edges_length * edges_length) ? edges[i % edges_length] : test_random();
+		b[i] = i < (edges_length * edges_length) ? edges[i / edges_length] : test_random();
+		c[i] = test_random();
+		if (small && i >= (edges_length * edges_length)) {
+			a[i] = arshift(a[i], 12);
+			b[i] = arshift(b[i], 12);
+		}
+	}
+	int add = 1, sub = 1, mul = 1, fma = 1, sadd = 1, ssub = 1, smul = 1, sfma = 1;
+	const q_t s = b[LENGTH - 1];
+	qadd_n(r, a, b, LENGTH);    for (size_t i = 0; i < LENGTH; i++) add &= r[i] == qadd(a[i], b[i]);
+	qsub_n(r, a, b, LENGTH);    for (size_t i = 0; i < LENGTH; i++) sub &= r[i] == qsub(a[i], b[i]);
+	qmul_n(r, a, b, LENGTH);    for (size_t i = 0; i < LENGTH; i++) mul &= r[i] == qmul(a[i], b[i]);
+	qfma_n(r, a, b, c, LENGTH); for (size_t i = 0; i < LENGTH; i++) fma &= r[i] == qfma(a[i], b[i], c[i]);
+	qadd_scalar_n(r, a, s, LENGTH);    for (size_t i = 0; i < LENGTH; i++) sadd &= r[i] == qadd(a[i], s);
+	qsub_scalar_n(r, a, s, LENGTH);    for (size_t i = 0; i < LENGTH; i++) ssub &= r[i] == qsub(a[i], s);
+	qmul_scalar_n(r, a, s, LENGTH);    for (size_t i = 0; i < LENGTH; i++) smul &= r[i] == qmul(a[i], s);
+	qfma_scalar_n(r, a, s, c, LENGTH); for (size_t i = 0; i < LENGTH; i++) sfma &= r[i] == qfma(a[i], s, c[i]);
+	unit_test(&t, qmul(-QINT(182), QINT(182)) == qinfo.min);
+	unit_test(&t, add);
+	unit_test(&t, sub);
+	unit_test(&t, mul);
+	unit_test(&t, fma);
+	unit_test(&t, sadd);
+	unit_test(&t, ssub);
+	unit_test(&t, smul);
+	unit_test(&t, sfma);
+	unit_test_statement(&t, memcpy(r, a, sizeof (r)));
+	unit_test_statement(&t, qadd_n(r, r, b, LENGTH));
+	unit_test(&t, r[7] == qadd(a[7], b[7]) && r[LENGTH - 1] == qadd(a[LENGTH - 1], b[LENGTH - 1]));
+	return unit_test_finish(&t);
+}
+
+static int test_cordic_n(void) {
+	unit_test_t t = unit_test_start();
+	enum { LENGTH = 200 + 5, };
+	static q_t a[LENGTH], b[LENGTH], r1[LENGTH], r2[LENGTH];
+	for (size_t i = 0; i < LENGTH; i++) {
+		a[i] = arshift(test_random(), 10);
+		b[i] = arshift(test_random(), 10);
+	}
+	a[0] = QINT(0); b[0] = QINT(1);
+	a[1] = QINT(1); b[1] = QINT(0);
+	a[2] = -QINT(1); b[2] = QINT(0);
+	a[3] = QINT(0); b[3] = -QINT(1);
+	a[4] = -QINT(2); b[4] = -QINT(3);
+	int sincos = 1, atan2 = 1, hypot = 1, rec2pol = 1;
+	qsincos_n(a, r1, r2, LENGTH);
+	for (size_t i = 0; i < LENGTH; i++) {
+		q_t s = 0, c = 0;
+		qsincos(a[i], &s, &c);
+		sincos &= s == r1[i] && c == r2[i];
+		qcordic_sincos(a[i], &r1[i], &r2[i], -1); /* same as the straight line kernel */
+		sincos &= s == r1[i] && c == r2[i];
+	}
+	qatan2_n(r1, a, b, LENGTH);
+	for (size_t i = 0; i < LENGTH; i++)
+		atan2 &= r1[i] == qatan2(a[i], b[i]);
+	qhypot_n(r1, a, b, LENGTH);
+	for (size_t i = 0; i < LENGTH; i++)
+		hypot &= r1[i] == qhypot(a[i], b[i]);
+	qrec2pol_n(a, b, r1, r2, LENGTH);
+	for (size_t i = 0; i < LENGTH; i++) {
+		q_t m = 0, theta = 0;
+		qrec2pol(a[i], b[i], &m, &theta);
+		rec2pol &= m == r1[i] && theta == r2[i];
+	}
+	const struct { q_t i, j; int quarters; } quadrants[] = { /* theta = quarters * pi/4, in [0, 2pi) */
+		{ QINT(1), QINT(1), 1 }, { -QINT(1), QINT(1), 3 }, { -QINT(1), -QINT(1), 5 }, { QINT(1), -QINT(1), 7 },
+	};
+	for (size_t i = 0; i < (sizeof (quadrants) / sizeof (quadrants[0])); i++) {
+		const q_t expected = qdiv(qmul(qinfo.pi, qint(quadrants[i].quarters)), qint(4));
+		q_t m = 0, theta = 0;
+		qrec2pol(quadrants[i].i, quadrants[i].j, &m, &theta);
+		rec2pol &= qwithin_interval(theta, expected, 0x10) != 0;
+		qrec2pol_n(&quadrants[i].i, &quadrants[i].j, &m, &theta, 1);
+		rec2pol &= qwithin_interval(theta, expected, 0x10) != 0;
+	}
+	for (size_t i = 0; i < LENGTH; i++) { /* 'qhypot_n' over the full range, saturating */
+		a[i] = i < 3 ? qinfo.min : test_random();
+		b[i] = i < 2 ? qinfo.max : test_random();
+	}
+	qhypot_n(r1, a, b, LENGTH);
+	for (size_t i = 0; i < LENGTH; i++)
+		hypot &= r1[i] == qhypot(a[i], b[i]);
+	unit_test(&t, sincos);
+	unit_test(&t, atan2);
+	unit_test(&t, hypot);
+	unit_test(&t, rec2pol);
+	return unit_test_finish(&t);
+}
+
+static const struct { q_t x, r; } exps[] = { /* reference values from libm */
+	{ -QINT(8), 0x16 }, { -0x38000, 0x7BB }, { -QINT(1), 0x5E2D },
+	{ -0x4000, 0xC75F }, { 0x8000, 0x1A613 }, { QINT(1), 0x2B7E1 },
+	{ 0x28000, 0xC2EB8 },
+}, logs[] = {
+	{ 0x41, -453245 }, { 0x2000, -136278 }, { 0x8000, -45426 },
+	{ 0x18000, 26573 }, { 0x2B7E1, 65536 }, { QINT(10), 150902 },
+	{ QINT(100), 301804 }, { QINT(1000), 452707 }, { QINT(30000), 675608 },
+};
+
+static int test_lut(void) {
+	unit_test_t t = unit_test_start();
+	unit_test(&t, qsin_lut(0) == 0);
+	unit_test(&t, qcos_lut(0) == QINT(1));
+	unit_test(&t, qexp_lut(0) == QINT(1));
+	unit_test(&t, qlog_lut(QINT(1)) == 0);
+	unit_test(&t, qexp_lut(QINT(11)) == qinfo.max);
+	unit_test(&t, qexp_lut(-QINT(12)) == 0);
+	for (size_t i = 0; i < (sizeof (exps) / sizeof (exps[0])); i++)
+		unit_test(&t, qabs(qsub(qexp_lut(exps[i].x), exps[i].r)) <= 1);
+	for (size_t i = 0; i < (sizeof (logs) / sizeof (logs[0])); i++)
+		unit_test(&t, qabs(qsub(qlog_lut(logs[i].x), logs[i].r)) <= 1);
+	int sin = 1, cos = 1;
+	for (q_t x = -QINT(12); x < QINT(12); x += 0x1357) { /* CORDIC is not perfect */
+		sin &= qabs(qsub(qsin_lut(x), qsin(x))) < 32;
+		cos &= qabs(qsub(qcos_lut(x), qcos(x))) < 32;
+	}
+	unit_test(&t, sin);
+	unit_test(&t, cos);
+	return unit_test_finish(&t);
+}
+
+static int test_exp_log(void) {
+	unit_test_t t = unit_test_start();
+	enum { EXPS = sizeof (exps) / sizeof (exps[0]), LOGS = sizeof (logs) / sizeof (logs[0]), };
+	q_t r[LOGS] = { 0, }, a[LOGS] = { 0, };
+	for (size_t i = 0; i < EXPS; i++)
+		unit_test(&t, qexp(exps[i].x) == exps[i].r);
+	for (size_t i = 0; i < LOGS; i++)
+		unit_test(&t, qlog(logs[i].x) == logs[i].r);
+	unit_test(&t, qexp(QINT(11)) == qinfo.max);
+	unit_test(&t, qexp(-QINT(12)) == 0);
+	unit_test(&t, qexp(qinfo.min) == 0);
+	int exp = 1, log = 1;
+	for (size_t i = 0; i < EXPS; i++)
+		a[i] = exps[i].x;
+	qexp_n(r, a, EXPS);
+	for (size_t i = 0; i < EXPS; i++)
+		exp &= r[i] == exps[i].r;
+	for (size_t i = 0; i < LOGS; i++)
+		a[i] = logs[i].x;
+	qlog_n(r, a, LOGS);
+	for (size_t i = 0; i < LOGS; i++)
+		log &= r[i] == logs[i].r;
+	enum { BULK = 300, };
+	static q_t ba[BULK], br[BULK];
+	for (size_t i = 0; i < BULK; i++) /* over several blocks, saturating and underflowing */
+		ba[i] = i < 2 ? (i ? qinfo.max : qinfo.min) : arshift(test_random(), (i % 2) ? 11 : 0);
+	qexp_n(br, ba, BULK);
+	for (size_t i = 0; i < BULK; i++)
+		exp &= br[i] == qexp(ba[i]);
+	for (size_t i = 0; i < BULK; i++)
+		ba[i] = (ba[i] & INT32_MAX) | 1;
+	qlog_n(br, ba, BULK);
+	for (size_t i = 0; i < BULK; i++)
+		log &= br[i] == qlog(ba[i]);
+	unit_test(&t, exp);
+	unit_test(&t, log);
+	return unit_test_finish(&t);
+}
+
+static int test_sqrt(void) {
+	unit_test_t t = unit_test_start();
+	unit_test(&t, qsqrt(0) == 0);
+	unit_test(&t, qsqrt(QINT(4)) == QINT(2));
+	unit_test(&t, qsqrt(qinfo.max) == 0xB504F3);
+	unit_test(&t, qrsqrt(QINT(4)) == QINT(1) / 2);
+	unit_test(&t, qrsqrt(1) == QINT(256));
+	unit_test(&t, qhypot(QINT(3), -QINT(4)) == QINT(5));
+	unit_test(&t, qhypot(qinfo.min, qinfo.min) == qinfo.max);
+	enum { LENGTH = 100, };
+	q_t a[LENGTH], r[LENGTH];
+	int sqrt = 1, rsqrt = 1;
+	for (size_t i = 0; i < LENGTH; i++) /* every normalisation shift used by 'qrsqrt' */
+		a[i] = ((test_random() & INT32_MAX) >> (i % 31)) | 1;
+	a[0] = qinfo.max;
+	qsqrt_n(r, a, LENGTH);
+	for (size_t i = 0; i < LENGTH; i++) { /* rounded to nearest, (r-0.5)^2 < a <= (r+0.5)^2 */
+		const int64_t x = (int64_t)a[i] << 16, rr = (int64_t)r[i] * r[i];
+		sqrt &= r[i] == qsqrt(a[i]) && (rr - r[i]) < x && x <= (rr + r[i]);
+	}
+	qrsqrt_n(r, a, LENGTH);
+	for (size_t i = 0; i < LENGTH; i++) { /* r^2 * a = 1, within rounding of 'r' */
+		const double d = ((double)r[i] * r[i] * a[i]) / 281474976710656.0 /* 2^48 */;
+		rsqrt &= r[i] == qrsqrt(a[i]) && (d - 1.0) * r[i] < 1.01 && (1.0 - d) * r[i] < 1.01;
+	}
+	unit_test(&t, sqrt);
+	unit_test(&t, rsqrt);
+	return unit_test_finish(&t);
+}
+
+static int test_recip(void) {
+	unit_test_t t = unit_test_start();
+	static const q_t edges[] = {
+		1, -1, 2, -2, 3, -3, QINT(1), -QINT(1), QINT(3), -QINT(7), 0x8000, -0x8001,
+		QINT(180), 0x3243F, INT32_MAX, INT32_MIN, INT32_MAX - 1, INT32_MIN + 1,
+	};
+	const size_t edges_length = sizeof (edges) / sizeof (edges[0]);
+	enum { LENGTH = 1000, };
+	static q_t a[LENGTH], r[LENGTH];
+	for (size_t i = 0; i < LENGTH; i++)
+		a[i] = i < edges_length ? edges[i] : i & 1 ? test_random() : arshift(test_random(), 12);
+	a[LENGTH - 1] = 0;
+	int div = 1, bulk = 1;
+	for (size_t i = 0; i < LENGTH; i++) {
+		const q_t d = i < edges_length ? edges[i] : (test_random() >> (i & 31)) | 1;
+		const qrecip_t rd = qrecip_init(d);
+		for (size_t j = 0; j < edges_length; j++)
+			div &= qdiv_by(&rd, edges[j]) == qdiv(edges[j], d);
+		qdiv_by_n(r, a, &rd, LENGTH);
+		for (size_t j = 0; j < LENGTH; j++)
+			bulk &= r[j] == qdiv(a[j], d);
+	}
+	unit_test(&t, div);
+	unit_test(&t, bulk);
+	unit_test(&t, qdiv(QINT(30000), QINT(1) / 2) == qinfo.max);
+	unit_test(&t, qdiv(QINT(30000), -QINT(1) / 2) == qinfo.min);
+	unit_test(&t, qdeg2rad(QINT(90)) == qdiv(qmul(qinfo.pi, QINT(90)), QINT(180)));
+	unit_test(&t, qrad2deg(qinfo.pi) == QINT(180));
+	return unit_test_finish(&t);
+}
+
+static int test_ctx(void) {
+	unit_test_t t = unit_test_start();
+	const qconf_t saved = qconf;
+	const qctx_t hex = { .bound = qbound_wrap, .dp = 2, .base = 16, };
+	char s[64 + 1] = { 0, };
+	q_t q = 0;
+	unit_test(&t, qsprint_ctx(&hex, QINT(255) + (QINT(1) / 2), s, sizeof s) > 0 && !strcmp(s, "FF.8"));
+	unit_test(&t, qsprint(QINT(255) + (QINT(1) / 2), s, sizeof s) > 0 && !strcmp(s, "255.5"));
+	unit_test(&t, qconv_ctx(&hex, &q, "1f.4") == 0 && q == QINT(31) + (QINT(1) / 4));
+	unit_test(&t, qconvb_ctx(&hex, &q, "11.1", 2) == 0 && q == QINT(3) + (QINT(1) / 2));
+	unit_test(&t, qnconv_ctx(&hex, &q, "10xyz", 2) == 0 && q == QINT(16));
+	unit_test(&t, qadd_ctx(&hex, qinfo.max, 1) == qbound_wrap((ld_t)qinfo.max + 1));
+	unit_test(&t, qsub_ctx(&hex, qinfo.min, 1) == qbound_wrap((ld_t)qinfo.min - 1));
+	unit_test(&t, qmul_ctx(&hex, QINT(3), QINT(4)) == QINT(12));
+	unit_test(&t, qdiv_ctx(&hex, QINT(3), QINT(4)) == qdiv(QINT(3), QINT(4)));
+	qconf.bound = qbound_saturate;
+	unit_test(&t, qadd(qinfo.max, 1) == qinfo.max);
+	unit_test(&t, qmul_ctx(&qconf, qinfo.max, QINT(2)) == qinfo.max);
+	unit_test(&t, qconf.base == saved.base && qconf.dp == saved.dp);
+	qconf = saved;
+	return unit_test_finish(&t);
+}
+
+static int test_qgen(void) {
+	unit_test_t t = unit_test_start();
+	int tables = 1; /* atan(2^-i) and atanh(2^-(i+1)), rounded to each format */
+	for (size_t i = 0; i < (sizeof (q8_arctans) / sizeof (q8_arctans[0])); i++) {
+		const double a = atan(ldexp(1, -(int)i)), h = atanh(ldexp(1, -(int)i - 1));
+		tables &= q8_arctans[i] == llround(ldexp(a, 8)) && q8_arctanhs[i] == llround(ldexp(h, 8));
+		tables &= q15_arctans[i] == llround(ldexp(a, 15)) && q15_arctanhs[i] == llround(ldexp(h, 15));
+#ifdef __SIZEOF_INT128__
+		tables &= q32_arctans[i] == llround(ldexp(a, 32)) && q32_arctanhs[i] == llround(ldexp(h, 32));
+#endif
+	}
+	unit_test(&t, tables);
+
+	unit_test(&t, q8_info.one == 256 && q8_info.pi == 804 && q8_info.max == INT16_MAX);
+	unit_test(&t, q8_mul(q8_int(3), q8_from_q(QINT(1) / 2)) == 384);
+	unit_test(&t, q8_add(q8_info.max, 1) == q8_info.max && q8_int(200) == q8_info.max);
+	unit_test(&t, q8_to_q(q8_info.one) == QINT(1) && q8_from_q(QINT(-2) + 0x7F) == q8_int(-2));
+	unit_test(&t, q8_sqrt(q8_int(2)) == 362 && q8_round(q8_div(q8_int(7), q8_int(2))) == q8_int(4));
+
+	unit_test(&t, q15_info.one == INT16_MAX && q15_info.pi == INT16_MAX && q15_info.min == INT16_MIN);
+	unit_test(&t, q15_mul(16384, 16384) == 8192 && q15_mul(q15_info.min, q15_info.min) == q15_info.max);
+	unit_test(&t, q15_int(-1) == q15_info.min && q15_int(1) == q15_info.max);
+	unit_test(&t, q15_sin(q15_from_q(QINT(1) / 2)) == 15710 && q15_cos(0) == q15_info.max);
+
+	q8_t a8[3] = { 1, 2, q8_info.max, }, r8[3] = { 0, };
+	q8_add_n(r8, a8, a8, 3);
+	unit_test(&t, r8[0] == 2 && r8[1] == 4 && r8[2] == q8_info.max);
+	q8_mul_n(r8, a8, a8, 3);
+	unit_test(&t, r8[0] == 0 && r8[1] == 0 && r8[2] == q8_info.max);
+#ifdef __SIZEOF_INT128__
+	unit_test(&t, q32_sqrt(q32_int(2)) == 6074001000ll && q32_to_q(q32_info.pi) == qinfo.pi);
+	unit_test(&t, q32_mul(q32_int(-3), q32_from_q(QINT(1) / 4)) == -(3ll << 30));
+	unit_test(&t, q32_int(INT32_MIN) == q32_info.min && q32_to_q(q32_int(40000)) == qinfo.max);
+	unit_test(&t, q32_sin(q32_info.pi / 6) - (1ll << 31) < 4 && (1ll << 31) - q32_sin(q32_info.pi / 6) < 4);
+#endif
+	return unit_test_finish(&t);
+}
+
 static inline int test_filter(void) {
 	unit_test_t t = unit_test_start();
 	qfilter_t lpf = { .raw = 0 }, hpf = { .raw = 0 };
@@ -438,7 +761,7 @@ static int test_matrix(void) {
 	unit_test_verify(&t, 0 == qmatrix_mul(ab, a, b));
 	unit_test_verify(&t, 0 == qmatrix_transpose(abp, ab));
 	unit_test(&t, qmatrix_equal(ab, abr));
-	unit_test(&t, qmatrix_equal(ab, abrp));
+	unit_test(&t, qmatrix_equal(abp, abrp));
 	qmatrix_print(out, a);
 	qmatrix_print(out, b);
 	qmatrix_print(out, ab);
@@ -446,6 +769,58 @@ static int test_matrix(void) {
 	return unit_test_finish(&t);
 }
 
+static q_t matrix_mul_reference(const q_t *a, const q_t *b, const size_t n, const size_t stride) {
+	ld_t s = 0x8000; /* exact sum of products, rounded and saturated once */
+	for (size_t k = 0; k < n; k++)
+		s += (ld_t)a[k] * b[k * stride];
+	s = s >= 0 ? s / 0x10000 : -((-s + 0xFFFF) / 0x10000);
+	return s > INT32_MAX ? INT32_MAX : s < INT32_MIN ? INT32_MIN : s;
+}
+
+static int test_matrix_mul(void) {
+	unit_test_t t = unit_test_start();
+	enum { AR = 37, AC = 53, BC = 29, };
+	static q_t a[QMATRIXSZ(AR, AC)] = QMATRIXZ(AR, AC);
+	static q_t b[QMATRIXSZ(AC, BC)] = QMATRIXZ(AC, BC);
+	static q_t r[QMATRIXSZ(AR, BC)] = QMATRIXZ(AR, BC);
+	static q_t rr[QMATRIXSZ(AR, BC)] = QMATRIXZ(AR, BC);
+	q_t *ma = &a[4], *mb = &b[4], *mr = &r[4];
+	for (size_t i = 0; i < (AR * AC); i++) /* large terms saturate, small ones do not */
+		ma[i] = arshift(test_random(), (i / AC) & 1 ? 6 : 14);
+	for (size_t i = 0; i < (AC * BC); i++)
+		mb[i] = arshift(test_random(), 12);
+	unit_test_verify(&t, 0 == qmatrix_mul(r, a, b));
+	unit_test(&t, r[2] == AR && r[3] == BC);
+	size_t bad = 0;
+	for (size_t i = 0; i < AR; i++)
+		for (size_t j = 0; j < BC; j++)
+			bad += mr[i*BC + j] != matrix_mul_reference(&ma[i*AC], &mb[j], AC, BC);
+	unit_test(&t, bad == 0);
+
+	unit_test_verify(&t, 0 == qmatrix_resize(rr, AR, BC));
+	unit_test_verify(&t, 0 == qmatrix_mul_rows(rr, a, b, 0, 10));
+	unit_test_verify(&t, 0 == qmatrix_mul_rows(rr, a, b, 10, AR));
+	unit_test(&t, qmatrix_equal(r, rr));
+	unit_test(&t, 0 > qmatrix_mul_rows(rr, a, b, 10, AR + 1));
+	unit_test(&t, 0 > qmatrix_mul_rows(rr, b, a, 0, 1));
+
+	q_t u[] = QMATRIX(1, 3, QINT(180), QINT(180), -QINT(180));
+	q_t v[] = QMATRIX(3, 1, QINT(180), QINT(180), QINT(180));
+	q_t uv[] = QMATRIXZ(1, 1);
+	unit_test_verify(&t, 0 == qmatrix_mul(uv, u, v));
+	unit_test(&t, uv[4] == QINT(32400)); /* only the final sum is saturated */
+
+	q_t x[] = QMATRIX(1, 4, INT32_MIN, INT32_MIN, INT32_MIN, INT32_MIN);
+	q_t y[] = QMATRIX(4, 1, INT32_MIN, INT32_MIN, INT32_MIN, INT32_MIN);
+	q_t xy[] = QMATRIXZ(1, 1);
+	unit_test_verify(&t, 0 == qmatrix_mul(xy, x, y)); /* sum of products is 2^64 */
+	unit_test(&t, xy[4] == INT32_MAX);
+	y[4] = INT32_MAX, y[5] = INT32_MAX, y[6] = INT32_MAX, y[7] = INT32_MAX;
+	unit_test_verify(&t, 0 == qmatrix_mul(xy, x, y));
+	unit_test(&t, xy[4] == INT32_MIN);
+	return unit_test_finish(&t);
+}
+
 static int test_matrix_trace(void) {
 	unit_test_t t = unit_test_start();
 	q_t a[] = QMATRIX(2, 2,
@@ -470,17 +845,721 @@ static int test_matrix_trace(void) {
 	unit_test(&t, qequal(qmatrix_trace(b), QINT(7)));
 	unit_test(&t, qequal(qmatrix_trace(a), qmatrix_trace(ta)));
 	unit_test(&t, qequal(qmatrix_trace(apb), qadd(qmatrix_trace(a), qmatrix_trace(b))));
-	printq(stdout, qmatrix_determinant(a), "det(a)");
+	q_t det = 0, lu[QMATRIXSZ(2, 3)] = QMATRIXZ(2, 3);
+	unit_test_verify(&t, 0 == qmatrix_determinant(&det, a, lu));
+	printq(stdout, det, "det(a)");
+	return unit_test_finish(&t);
+}
+
+static int test_matrix_lu(void) {
+	unit_test_t t = unit_test_start();
+	q_t a[] = QMATRIX(4, 4,
+		QINT(2), QINT(1), QINT(1), QINT(0),
+		QINT(4), QINT(3), QINT(3), QINT(1),
+		QINT(8), QINT(7), QINT(9), QINT(5),
+		QINT(6), QINT(7), QINT(9), QINT(8),
+	);
+	q_t b[] = QMATRIX(4, 1, QINT(7), QINT(23), QINT(69), QINT(79)); /* a * [1 2 3 4]' */
+	q_t x[QMATRIXSZ(4, 1)] = QMATRIXZ(4, 1);
+	q_t lu[QMATRIXSZ(4, 5)] = QMATRIXZ(4, 5);
+	q_t small[] = QMATRIXZ(4, 4);
+	unit_test(&t, 0 > qmatrix_lu(small, a));
+	unit_test_verify(&t, 0 == qmatrix_lu(lu, a));
+	unit_test(&t, qwithin_interval(qmatrix_lu_determinant(lu), QINT(8), 0x20));
+	q_t det = 0;
+	unit_test(&t, 0 > qmatrix_determinant(&det, a, small));
+	unit_test_verify(&t, 0 == qmatrix_determinant(&det, a, lu));
+	unit_test(&t, qwithin_interval(det, QINT(8), 0x20));
+	unit_test_verify(&t, 0 == qmatrix_solve(x, lu, b));
+	for (size_t i = 0; i < 4; i++)
+		unit_test(&t, qwithin_interval(x[4 + i], QINT(i + 1), 0x20));
+	unit_test_verify(&t, 0 == qmatrix_solve(b, lu, b));
+	unit_test(&t, qmatrix_equal(b, x));
+
+	q_t singular[] = QMATRIX(3, 3,
+		QINT(1), QINT(2), QINT(3),
+		QINT(2), QINT(4), QINT(6),
+		QINT(1), QINT(0), QINT(1),
+	);
+	q_t inverse[QMATRIXSZ(3, 3)] = QMATRIXZ(3, 3);
+	unit_test_verify(&t, 0 == qmatrix_determinant(&det, singular, lu));
+	unit_test(&t, qequal(det, QINT(0)));
+	unit_test(&t, 0 > qmatrix_inverse(inverse, singular, lu));
+
+	enum { CN = 32, };
+	static q_t c[QMATRIXSZ(CN, CN)] = QMATRIXZ(CN, CN);
+	static q_t ci[QMATRIXSZ(CN, CN)] = QMATRIXZ(CN, CN);
+	static q_t cci[QMATRIXSZ(CN, CN)] = QMATRIXZ(CN, CN);
+	static q_t w[QMATRIXSZ(CN, CN + 1)] = QMATRIXZ(CN, CN + 1);
+	for (size_t i = 0; i < CN; i++) /* symmetric and diagonally dominant, like a covariance */
+		for (size_t j = 0; j <= i; j++)
+			c[4 + i*CN + j] = c[4 + j*CN + i] = i == j ? QINT(CN) : arshift(test_random(), 15);
+	unit_test_verify(&t, 0 == qmatrix_inverse(ci, c, w));
+	unit_test_verify(&t, 0 == qmatrix_mul(cci, c, ci));
+	size_t bad = 0;
+	for (size_t i = 0; i < CN; i++)
+		for (size_t j = 0; j < CN; j++)
+			bad += !qwithin_interval(cci[4 + i*CN + j], i == j ? QINT(1) : QINT(0), 0x20);
+	unit_test(&t, bad == 0);
+
+	for (size_t i = 0; i < CN; i++) /* triangular, so the determinant is the product of the diagonal */
+		for (size_t j = 0; j < CN; j++)
+			cci[4 + i*CN + j] = i == j ? (i < 2 ? QINT(i + 2) : QINT(1)) : j < i ? arshift(test_random(), 20) : 0;
+	unit_test(&t, 0 > qmatrix_determinant(&det, cci, lu));
+	unit_test_verify(&t, 0 == qmatrix_determinant(&det, cci, w));
+	unit_test(&t, qwithin_interval(det, QINT(6), 0x20));
+	return unit_test_finish(&t);
+}
+
+static int test_matrix_view(void) {
+	unit_test_t t = unit_test_start();
+	q_t a[] = QMATRIX(2, 3,
+		QINT(1), QINT(2), QINT(3),
+		QINT(4), QINT(5), QINT(6),
+	);
+	const q_t at[] = QMATRIX(3, 2,
+		QINT(1), QINT(4),
+		QINT(2), QINT(5),
+		QINT(3), QINT(6),
+	);
+	q_t r[QMATRIXSZ(3, 2)] = QMATRIXZ(3, 2);
+	unit_test_verify(&t, 0 == qmatrix_transpose(r, a));
+	unit_test(&t, qmatrix_equal(r, at));
+	const qview_t va = qview_matrix(a), vt = qview_transpose(va);
+	unit_test(&t, vt.rows == 3 && vt.columns == 2);
+	unit_test(&t, qview_equal(vt, qview_matrix(r)));
+	unit_test(&t, qequal(vt.data[2*vt.row_stride + 1*vt.column_stride], QINT(6)));
+
+	q_t buffer[5 * 8] = { 0, }; /* a 4x6 matrix in a larger buffer we own */
+	const qview_t vb = qview_block(qview(buffer, 5, 8, 8), 1, 1, 4, 6);
+	unit_test_verify(&t, 0 == qview_one(vb));
+	unit_test_verify(&t, 0 == qview_copy(qview_block(vb, 0, 0, 2, 3), va));
+	unit_test_verify(&t, 0 == qview_scalar_mul(qview_column(vb, 5), qview_column(vb, 5), QINT(3)));
+	unit_test(&t, buffer[0] == 0 && buffer[7] == 0 && buffer[8] == 0 && buffer[15] == 0);
+	unit_test(&t, buffer[9] == QINT(1) && buffer[11] == QINT(3) && buffer[17] == QINT(4));
+	unit_test(&t, buffer[14] == QINT(3) && buffer[38] == QINT(3) && buffer[39] == 0);
+	q_t sum = 0;
+	for (size_t i = 0; i < (sizeof (buffer) / sizeof (buffer[0])); i++)
+		sum = qadd(sum, buffer[i]);
+	unit_test(&t, qequal(sum, QINT(24 - 6 + 21 + 4*2)));
+	unit_test(&t, 0 > qview_copy(qview_row(vb, 0), va));
+	unit_test(&t, 0 > qview_mul(qview_block(vb, 0, 0, 2, 2), va, va));
+
+	q_t aat[QMATRIXSZ(2, 2)] = QMATRIXZ(2, 2);
+	q_t aatv[QMATRIXSZ(2, 2)] = QMATRIXZ(2, 2);
+	unit_test_verify(&t, 0 == qmatrix_mul(aat, a, r));
+	unit_test_verify(&t, 0 == qview_mul(qview_matrix(aatv), va, vt));
+	unit_test(&t, qmatrix_equal(aat, aatv));
+	unit_test(&t, qequal(aat[4], QINT(14)) && qequal(aat[5], QINT(32)) && qequal(aat[7], QINT(77)));
+
+	q_t lu[QMATRIXSZ(2, 3)] = QMATRIXZ(2, 3);
+	q_t inverse[2 * 4] = { 0, };
+	const qview_t vi = qview_block(qview(inverse, 2, 4, 4), 0, 1, 2, 2);
+	unit_test_verify(&t, 0 == qview_inverse(vi, qview_block(va, 0, 1, 2, 2), lu));
+	unit_test(&t, qwithin_interval(inverse[1], -QINT(2), 0x10) && qwithin_interval(inverse[2], QINT(1), 0x10));
+	unit_test(&t, qwithin_interval(inverse[5], qdiv(QINT(5), QINT(3)), 0x10) && qwithin_interval(inverse[6], -qdiv(QINT(2), QINT(3)), 0x10));
+	unit_test(&t, inverse[0] == 0 && inverse[3] == 0 && inverse[4] == 0 && inverse[7] == 0);
+	return unit_test_finish(&t);
+}
+
+static int test_matrix_elementwise(void) {
+	unit_test_t t = unit_test_start();
+	enum { ER = 7, EC = 13, };
+	static q_t a[QMATRIXSZ(ER, EC)] = QMATRIXZ(ER, EC);
+	static q_t b[QMATRIXSZ(ER, EC)] = QMATRIXZ(ER, EC);
+	static q_t c[QMATRIXSZ(ER, EC)] = QMATRIXZ(ER, EC);
+	static q_t r[4 + (ER * EC)], e[4 + (ER * EC)];
+	for (size_t i = 0; i < (ER * EC); i++) {
+		a[4 + i] = i < 4 ? INT32_MAX : arshift(test_random(), i & 7);
+		b[4 + i] = i < 4 ? INT32_MAX : arshift(test_random(), i & 7);
+		c[4 + i] = test_random();
+	}
+	const q_t s = qnegate(qint(3)) + 0x1234;
+	static const struct { int (*view)(qview_t, qview_t, qview_t); q_t (*op)(q_t, q_t); } binary[] = {
+		{ qview_add, qadd, }, { qview_sub, qsub, }, { qview_and, qand, }, { qview_or, qor, }, { qview_xor, qxor, },
+	};
+	static const struct { int (*view)(qview_t, qview_t, q_t); q_t (*op)(q_t, q_t); } scalar[] = {
+		{ qview_scalar_add, qadd, }, { qview_scalar_sub, qsub, }, { qview_scalar_mul, qmul, },
+		{ qview_scalar_div, qdiv, }, { qview_scalar_mod, qmod, }, { qview_scalar_rem, qrem, },
+		{ qview_scalar_and, qand, }, { qview_scalar_or,  qor, },  { qview_scalar_xor, qxor, },
+	};
+	static const struct { int (*view)(qview_t, qview_t); q_t (*op)(q_t); } unary[] = {
+		{ qview_logical, qlogical, }, { qview_not, qnot, }, { qview_signum, qsignum, }, { qview_invert, qinvert, },
+	};
+	const qview_t va = qview_matrix(a), vb = qview_matrix(b), vc = qview_matrix(c);
+	for (int strided = 0; strided < 2; strided++) { /* strided results are written through a transposed view */
+		const qview_t out = strided ? qview_transpose(qview(&r[4], EC, ER, ER)) : qview(&r[4], ER, EC, EC);
+		const qview_t ref = strided ? qview_transpose(qview(&e[4], EC, ER, ER)) : qview(&e[4], ER, EC, EC);
+		size_t bad = 0;
+		for (size_t i = 0; i < (sizeof (binary) / sizeof (binary[0])); i++) {
+			bad += !!binary[i].view(out, va, vb);
+			bad += !!qview_apply_binary(ref, va, vb, binary[i].op);
+			bad += !qview_equal(out, ref);
+		}
+		for (size_t i = 0; i < (sizeof (scalar) / sizeof (scalar[0])); i++) {
+			bad += !!scalar[i].view(out, va, s);
+			bad += !!qview_apply_scalar(ref, va, scalar[i].op, s);
+			bad += !qview_equal(out, ref);
+		}
+		for (size_t i = 0; i < (sizeof (unary) / sizeof (unary[0])); i++) {
+			bad += !!unary[i].view(out, vb);
+			bad += !!qview_apply_unary(ref, vb, unary[i].op);
+			bad += !qview_equal(out, ref);
+		}
+		bad += !!qview_fma(out, va, vb, vc);
+		for (size_t i = 0; i < ER; i++)
+			for (size_t j = 0; j < EC; j++)
+				bad += out.data[i*out.row_stride + j*out.column_stride] != qfma(a[4 + i*EC + j], b[4 + i*EC + j], c[4 + i*EC + j]);
+		bad += !!qview_scalar_fma(out, va, s, vc);
+		for (size_t i = 0; i < ER; i++)
+			for (size_t j = 0; j < EC; j++)
+				bad += out.data[i*out.row_stride + j*out.column_stride] != qfma(a[4 + i*EC + j], s, c[4 + i*EC + j]);
+		unit_test(&t, bad == 0);
+	}
+
+	q_t y[] = QMATRIX(1, 3, QINT(1), QINT(2), QINT(3));
+	q_t x[] = QMATRIX(1, 3, QINT(4), QINT(5), QINT(6));
+	const q_t axpy[] = QMATRIX(1, 3, QINT(9), QINT(12), QINT(15));
+	unit_test_verify(&t, 0 == qmatrix_scalar_fma(y, x, QINT(2), y)); /* y = 2*x + y */
+	unit_test(&t, qmatrix_equal(y, axpy));
+	unit_test(&t, 0 > qmatrix_fma(y, x, a, y));
+	return unit_test_finish(&t);
+}
+
+static int test_filter_block(void) {
+	unit_test_t t = unit_test_start();
+	enum { SAMPLES = 97, TAPS = 21, };
+	q_t input[SAMPLES], block[SAMPLES];
+	for (size_t i = 0; i < SAMPLES; i++)
+		block[i] = input[i] = arshift(test_random(), 8);
+
+	qfilter_t lpf, hpf, lpb, hpb, variable;
+	const q_t dt = qdiv(QINT(1), QINT(100)), rc = qdiv(QINT(1), QINT(3));
+	qfilter_init_fixed(&lpf, dt, rc, QINT(0));
+	qfilter_init_fixed(&hpf, dt, rc, QINT(0));
+	qfilter_init_fixed(&lpb, dt, rc, QINT(0));
+	qfilter_init_fixed(&hpb, dt, rc, QINT(0));
+	qfilter_init(&variable, QINT(0), rc, QINT(0));
+	unit_test(&t, 0 > qfilter_low_pass_block(&variable, block, SAMPLES));
+	unit_test_verify(&t, 0 == qfilter_low_pass_block(&lpb, block, SAMPLES));
+	size_t bad = 0;
+	for (size_t i = 0; i < SAMPLES; i++) {
+		const q_t time = dt * (i + 1);
+		bad += block[i] != qfilter_low_pass(&lpf, time, input[i]);
+		bad += block[i] != qfilter_low_pass(&variable, time, input[i]);
+	}
+	unit_test(&t, bad == 0);
+	unit_test(&t, lpb.time == lpf.time && lpb.raw == lpf.raw && lpb.filtered == lpf.filtered);
+	memcpy(block, input, sizeof (block));
+	unit_test_verify(&t, 0 == qfilter_high_pass_block(&hpb, block, SAMPLES));
+	bad = 0;
+	for (size_t i = 0; i < SAMPLES; i++)
+		bad += block[i] != qfilter_high_pass(&hpf, dt * (i + 1), input[i]);
+	unit_test(&t, bad == 0);
+
+	qbiquad_t halve[2];
+	qbiquad_init(&halve[0], QINT(1) / 2, 0, 0, -QINT(1) / 2, 0); /* y = x/2 + y1/2 */
+	q_t impulse[6] = { QINT(1), 0, 0, 0, 0, 0, };
+	qbiquad_block(&halve[0], 1, impulse, 6);
+	unit_test(&t, impulse[0] == QINT(1) / 2 && impulse[1] == QINT(1) / 4 && impulse[5] == QINT(1) / 64);
+
+	qbiquad_t cascade[2], single[2];
+	qbiquad_init(&cascade[0], 0x1000, 0x2000, 0x1000, -0x18000, 0x9000);
+	qbiquad_init(&cascade[1], 0x8000, -0x4000, 0x2000, -0x8000, 0x2000);
+	memcpy(single, cascade, sizeof (single));
+	memcpy(block, input, sizeof (block));
+	qbiquad_block(cascade, 2, block, SAMPLES);
+	bad = 0;
+	for (size_t i = 0; i < SAMPLES; i++)
+		bad += block[i] != qbiquad_update(&single[1], qbiquad_update(&single[0], input[i]));
+	unit_test(&t, bad == 0);
+
+	q_t taps[TAPS], history[2 * TAPS], reverse[TAPS] = { 0, };
+	for (size_t i = 0; i < TAPS; i++)
+		taps[i] = arshift(test_random(), 12);
+	qfir_t fir;
+	qfir_init(&fir, taps, TAPS, history);
+	memcpy(block, input, sizeof (block));
+	qfir_block(&fir, block, SAMPLES);
+	bad = 0;
+	for (size_t i = 0; i < SAMPLES; i++) {
+		for (size_t k = 0; k < TAPS; k++)
+			reverse[k] = k <= i ? input[i - k] : 0;
+		bad += block[i] != matrix_mul_reference(taps, reverse, TAPS, 1);
+	}
+	unit_test(&t, bad == 0);
+
+	const q_t average[4] = { QINT(1) / 4, QINT(1) / 4, QINT(1) / 4, QINT(1) / 4, };
+	q_t step[6] = { QINT(1), QINT(1), QINT(1), QINT(1), QINT(1), QINT(1), }, h4[8];
+	qfir_init(&fir, average, 4, h4);
+	qfir_block(&fir, step, 6);
+	unit_test(&t, step[0] == QINT(1) / 4 && step[2] == (3 * QINT(1)) / 4 && step[3] == QINT(1) && step[5] == QINT(1));
+	return unit_test_finish(&t);
+}
+
+static int test_pid_bank(void) {
+	unit_test_t t = unit_test_start();
+	enum { LOOPS = 150, TICKS = 20, };
+	static q_t p_gain[LOOPS], i_gain[LOOPS], d_gain[LOOPS], i_state[LOOPS], i_min[LOOPS], i_max[LOOPS];
+	static q_t d_state[LOOPS], d_alpha[LOOPS], d_filtered[LOOPS], errors[LOOPS], positions[LOOPS], outputs[LOOPS];
+	static qpid_t single[LOOPS];
+	qpid_bank_t bank = { p_gain, i_gain, d_gain, i_state, i_min, i_max, d_state, d_alpha, d_filtered, };
+	for (int dt = 0; dt < 2; dt++) {
+		const q_t period = qdiv(QINT(1), QINT(50));
+		for (size_t i = 0; i < LOOPS; i++) {
+			qpid_t *s = &single[i];
+			memset(s, 0, sizeof (*s));
+			s->p_gain = p_gain[i] = arshift(test_random(), 12);
+			s->i_gain = i_gain[i] = arshift(test_random(), 14);
+			s->d_gain = d_gain[i] = arshift(test_random(), 14);
+			s->i_min  = i_min[i]  = -QINT(1 + (i % 7));
+			s->i_max  = i_max[i]  =  QINT(1 + (i % 5));
+			s->d_alpha = d_alpha[i] = i & 1 ? QINT(1) / 4 : 0;
+			i_state[i] = d_state[i] = d_filtered[i] = 0;
+		}
+		size_t bad = 0;
+		for (size_t k = 0; k < TICKS; k++) {
+			for (size_t i = 0; i < LOOPS; i++) {
+				errors[i] = arshift(test_random(), 13);
+				positions[i] = arshift(test_random(), 12);
+				const q_t o = dt ?
+					qpid_update_dt(&single[i], errors[i], positions[i], period) :
+					qpid_update(&single[i], errors[i], positions[i]);
+				outputs[i] = o;
+			}
+			if (dt)
+				qpid_bank_update_dt(&bank, errors, positions, errors, period, LOOPS);
+			else
+				qpid_bank_update(&bank, errors, positions, errors, LOOPS);
+			for (size_t i = 0; i < LOOPS; i++)
+				bad += errors[i] != outputs[i] || i_state[i] != single[i].i_state || d_filtered[i] != single[i].d_filtered;
+		}
+		unit_test(&t, bad == 0);
+	}
+
+	qpid_t pid = { .p_gain = 0, .i_gain = QINT(1), .i_min = -QINT(10), .i_max = QINT(10), };
+	const q_t half = QINT(1) / 2;
+	unit_test(&t, qequal(qpid_update_dt(&pid, QINT(1), 0, half), half)); /* integrates error over time */
+	unit_test(&t, qequal(qpid_update_dt(&pid, QINT(1), 0, half), QINT(1)));
+	pid.i_gain = 0, pid.d_gain = QINT(1);
+	unit_test(&t, qequal(qpid_update_dt(&pid, 0, QINT(1), half), -QINT(2))); /* rate of change of position */
+	return unit_test_finish(&t);
+}
+
+static int test_reduce(void) {
+	unit_test_t t = unit_test_start();
+	enum { LENGTH = 1003, };
+	static q_t a[LENGTH], b[LENGTH], y[LENGTH];
+	ld_t sum = 0;
+	for (size_t i = 0; i < LENGTH; i++) {
+		a[i] = arshift(test_random(), 4);
+		b[i] = arshift(test_random(), 14);
+		y[i] = test_random();
+		sum += a[i];
+	}
+	unit_test(&t, qdot(a, b, LENGTH) == matrix_mul_reference(a, b, LENGTH, 1));
+	unit_test(&t, qsumsq(b, LENGTH) == matrix_mul_reference(b, b, LENGTH, 1));
+	unit_test(&t, qsum(a, LENGTH) == (sum > INT32_MAX ? INT32_MAX : sum < INT32_MIN ? INT32_MIN : sum));
+	unit_test(&t, qsum(b, 7) == b[0] + b[1] + b[2] + b[3] + b[4] + b[5] + b[6]);
+	unit_test(&t, qsum(a, 0) == 0 && qdot(a, b, 0) == 0);
+
+	qacc_t whole = { 0, 0, 0, }, first = { 0, 0, 0, }, second = { 0, 0, 0, };
+	qacc_dot(&whole, a, b, LENGTH);
+	qacc_dot(&first, a, b, 500);
+	qacc_dot(&second, &a[500], &b[500], LENGTH - 500);
+	qacc_merge(&first, &second);
+	unit_test(&t, qacc_result(&first) == qacc_result(&whole));
+
+	const q_t big[] = { INT32_MAX, INT32_MAX, -INT32_MAX, };
+	unit_test(&t, qsum(big, 3) == INT32_MAX); /* saturates once, at the end */
+	unit_test(&t, qsum(big, 2) == INT32_MAX);
+	const q_t m[] = QMATRIX(3, 3, INT32_MAX, 0, 0, 0, INT32_MAX, 0, 0, 0, -INT32_MAX);
+	unit_test(&t, qmatrix_trace(m) == INT32_MAX);
+
+	const q_t ends[] = { 3, -7, 9, 9, -7, 2, 1, 0, 5, 9, -7, };
+	unit_test(&t, qargmax(ends, 11) == 2 && qargmin(ends, 11) == 1);
+	unit_test(&t, qargmax(&ends[3], 8) == 0 && qargmin(&ends[5], 6) == 5);
+	unit_test(&t, qargmax(ends, 0) == 0);
+	size_t imax = 0, imin = 0;
+	for (size_t i = 0; i < LENGTH; i++) {
+		imax = y[i] > y[imax] ? i : imax;
+		imin = y[i] < y[imin] ? i : imin;
+	}
+	unit_test(&t, qargmax(y, LENGTH) == imax && qargmin(y, LENGTH) == imin);
+
+	size_t bad = 0;
+	memcpy(b, y, sizeof (b));
+	qaxpy(y, qnegate(QINT(3)) + 0x1234, a, LENGTH);
+	for (size_t i = 0; i < LENGTH; i++)
+		bad += y[i] != qfma(qnegate(QINT(3)) + 0x1234, a[i], b[i]);
+	unit_test(&t, bad == 0);
+	return unit_test_finish(&t);
+}
+
+static int test_parse(void) {
+	unit_test_t t = unit_test_start();
+	enum { VALUES = 1000, };
+	static q_t in[VALUES], out[VALUES];
+	static char text[VALUES * 32];
+	const d_t places[] = { -1, 0, 1, 3, 4, };
+	size_t bad = 0, used = 0;
+	for (size_t i = 0; i < VALUES; i++)
+		in[i] = i < 4 ? (q_t[]){ 0, INT32_MIN, INT32_MAX, QINT(12), }[i] : (q_t)test_random();
+	for (size_t k = 0; k < (sizeof (places) / sizeof (places[0])); k++) {
+		for (size_t i = 0; i < VALUES; i++) {
+			char expected[64] = { 0, }, got[64] = { 0, };
+			qsprintbdp(in[i], expected, sizeof (expected), 10, places[k]);
+			const size_t n = qsprint_n(got, sizeof (got), &in[i], 1, places[k], '\n', &used);
+			bad += n != 1 || used != (strlen(expected) + 1) || memcmp(got, expected, used - 1) || got[used - 1] != '\n';
+		}
+	}
+	unit_test(&t, bad == 0);
+
+	unit_test(&t, qsprint_n(text, sizeof (text), in, VALUES, -1, '\n', &used) == VALUES);
+	const size_t length = used;
+	const size_t chunks[] = { 1, 7, 64, 4096, sizeof (text), };
+	for (size_t k = 0; k < (sizeof (chunks) / sizeof (chunks[0])); k++) {
+		qparse_t p;
+		qparse_init(&p, 10, 4);
+		size_t stored = 0;
+		for (size_t i = 0; i < length && stored < VALUES;) {
+			const size_t chunk = chunks[k] < (length - i) ? chunks[k] : length - i;
+			used = 0;
+			const int r = qparse(&p, &text[i], chunk, &out[stored], (VALUES - stored) < 13 ? VALUES - stored : 13, &used);
+			if (r < 0)
+				break;
+			stored += r;
+			i += used;
+		}
+		stored += qparse_end(&p, &out[stored]) == 1;
+		bad = stored != VALUES;
+		for (size_t i = 0, j = 0; i < VALUES && j < length; i++) {
+			size_t l = 0;
+			while (text[j + l] != '\n')
+				l++;
+			q_t expected = 0;
+			qnconvbdp(&expected, &text[j], l, 10, 4);
+			bad += out[i] != expected;
+			j += l + 1;
+		}
+		unit_test(&t, bad == 0);
+	}
+
+	qparse_t p;
+	const char mixed[] = "1, 2\t-3.5,,\n  4. .25 -0.0001 99999 -40000.5 3";
+	qparse_init(&p, 10, 4);
+	unit_test(&t, qparse(&p, mixed, sizeof (mixed) - 1, out, VALUES, &used) == 8);
+	unit_test(&t, used == (sizeof (mixed) - 1) && p.length == 1); /* the last number may continue */
+	unit_test(&t, qparse_end(&p, &out[8]) == 1);
+	unit_test(&t, out[0] == QINT(1) && out[1] == QINT(2) && out[2] == qnegate(QINT(7)) / 2 && out[3] == QINT(4));
+	unit_test(&t, out[4] == QINT(1) / 4 && out[5] == qnegate(0x6) && out[6] == INT32_MAX && out[7] == INT32_MIN);
+	unit_test(&t, out[8] == QINT(3));
+	unit_test(&t, qparse_end(&p, out) == 0);
+
+	qparse_init(&p, 10, 4);
+	unit_test(&t, qparse(&p, "1 2x 3 ", 7, out, VALUES, &used) < 0);
+	unit_test(&t, qparse(&p, "4 ", 2, out, VALUES, &used) < 0); /* errors stay */
+
+	qparse_init(&p, 16, 4);
+	unit_test(&t, qparse(&p, "ff 10.8 ", 8, out, VALUES, &used) == 2);
+	unit_test(&t, out[0] == QINT(255) && out[1] == QINT(33) / 2);
+
+	qparse_init(&p, 10, 4);
+	unit_test(&t, qparse(&p, "1 ", 2, out, 0, &used) == 0 && used == 0);
+
+	const q_t few[] = { QINT(1), QINT(22), QINT(333), };
+	char small[8] = { 0, };
+	unit_test(&t, qsprint_n(small, sizeof (small), few, 3, 0, ',', &used) == 2);
+	unit_test(&t, used == 7 && !memcmp(small, "1.,22.,", 7));
+	return unit_test_finish(&t);
+}
+
+static int test_file(void) {
+	unit_test_t t = unit_test_start();
+	enum { ELEMENTS = 37, };
+	q_t a[ELEMENTS], b[ELEMENTS];
+	char packed[ELEMENTS * sizeof (q_t)], single[sizeof (q_t)];
+	size_t bad = 0;
+	for (size_t i = 0; i < ELEMENTS; i++)
+		a[i] = test_random();
+	unit_test(&t, qpack_n(a, ELEMENTS, packed, sizeof (packed) - 1) < 0);
+	unit_test(&t, qpack_n(a, ELEMENTS, packed, sizeof (packed)) == sizeof (packed));
+	for (size_t i = 0; i < ELEMENTS; i++) {
+		qpack(&a[i], single, sizeof (single));
+		bad += memcmp(single, &packed[i * sizeof (q_t)], sizeof (single)) != 0;
+	}
+	unit_test(&t, bad == 0);
+	unit_test(&t, qunpack_n(b, ELEMENTS, packed, sizeof (packed)) == sizeof (packed));
+	unit_test(&t, !memcmp(a, b, sizeof (a)));
+
+	q_t m[] = QMATRIX(3, 5, 
+		QINT(1), QINT(2), QINT(3), QINT(4), QINT(5),
+		-1, -2, -3, -4, INT32_MIN,
+		0x1234, 0x5678, 0x9ABC, 0x7FFFFFFF, 0);
+	q_t r[QMATRIXSZ(5, 5)] = QMATRIXZ(5, 5);
+	q_t mt[QMATRIXSZ(5, 3)] = QMATRIXZ(5, 3);
+	q_t storage[64 + 16]; /* aligned for 'qfile_matrix' */
+	char *file = (char*)storage;
+	const size_t size = qfile_size(3, 5);
+	unit_test(&t, size == (64 + (15 * sizeof (q_t))));
+	unit_test(&t, qfile_size(0x10000, 0x10000) == 0);
+	unit_test(&t, qfile_pack(file, size - 1, qview_matrix(m)) < 0);
+	unit_test(&t, qfile_pack(file, size, qview_matrix(m)) == 0);
+	unit_test(&t, !memcmp(file, "QARR", 4));
+	size_t rows = 0, columns = 0;
+	unit_test(&t, qfile_check(file, size, &rows, &columns) == 0 && rows == 3 && columns == 5);
+	unit_test(&t, qfile_check(file, size - 1, NULL, NULL) < 0);
+	unit_test(&t, qfile_verify(file, size) == 0);
+	file[64 + 7] ^= 0x10;
+	unit_test(&t, qfile_check(file, size, NULL, NULL) == 0);
+	unit_test(&t, qfile_verify(file, size) < 0);
+	file[64 + 7] ^= 0x10;
+	unit_test(&t, qfile_verify(file, size) == 0);
+
+	q_t *mapped = qfile_matrix(file, size);
+	unit_test(&t, mapped == &storage[12]);
+	unit_test(&t, mapped && qmatrix_equal(mapped, m));
+	qview_t v = { NULL, 0, 0, 0, 0, };
+	unit_test(&t, qfile_view(file, size, &v) == 0 && v.data == &storage[16] && v.rows == 3 && v.columns == 5);
+	unit_test(&t, qfile_unpack(r, file, size) == 0 && qmatrix_equal(r, m));
+
+	char unaligned[sizeof (storage) + 1];
+	memcpy(&unaligned[1], file, size);
+	unit_test(&t, qfile_matrix(&unaligned[1], size) == NULL);
+	unit_test(&t, qfile_verify(&unaligned[1], size) == 0);
+	unit_test(&t, qfile_unpack(r, &unaligned[1], size) == 0 && qmatrix_equal(r, m));
+
+	unit_test(&t, qmatrix_transpose(mt, m) == 0);
+	unit_test(&t, qfile_pack(file, sizeof (storage), qview_transpose(qview_matrix(m))) == 0);
+	unit_test(&t, qfile_verify(file, sizeof (storage)) == 0);
+	unit_test(&t, qfile_unpack(r, file, sizeof (storage)) == 0 && qmatrix_equal(r, mt));
+
+	unit_test(&t, qfile_pack(file, sizeof (storage), qview(a, 1, ELEMENTS, ELEMENTS)) == 0);
+	unit_test(&t, qfile_view(file, sizeof (storage), &v) == 0 && v.rows == 1 && !memcmp(v.data, a, sizeof (a)));
+	file[0] = 'X';
+	unit_test(&t, qfile_check(file, sizeof (storage), NULL, NULL) < 0 && qfile_matrix(file, sizeof (storage)) == NULL);
 	return unit_test_finish(&t);
 }
 
 static q_t qid(q_t x) { return x; }
 static q_t qsq(q_t x) { return qmul(x, x); }
+static unsigned counted = 0;
+static q_t qsq_counted(q_t x) { counted++; return qsq(x); }
+static q_t qsin_counted(q_t x) { counted++; return qsin(x); }
 
 static int test_simpson(void) {
 	unit_test_t t = unit_test_start();
 	unit_test(&t, qwithin_interval(qsimpson(qid, QINT(0), QINT(10), 100), QINT(50), QINT(1))); // (x^2)/2 + C
 	unit_test(&t, qwithin_interval(qsimpson(qsq, qnegate(QINT(2)), QINT(5), 100), QINT(44), QINT(1))); // (x^3)/3 + C
+	unit_test(&t, qwithin_interval(qsimpson(qid, QINT(0), QINT(10), 100), QINT(50), 0x4));
+	unit_test(&t, qwithin_interval(qsimpson(qsq, qnegate(QINT(2)), QINT(5), 100), qdiv(QINT(133), QINT(3)), 0x10));
+
+	counted = 0;
+	unit_test(&t, qwithin_interval(qsimpson_adaptive(qsq_counted, qnegate(QINT(2)), QINT(5), 0x10, 1000), qdiv(QINT(133), QINT(3)), 0x10));
+	unit_test(&t, counted == 5); /* exact for a quadratic, so one subdivision is enough */
+	counted = 0;
+	unit_test(&t, qwithin_interval(qsimpson_adaptive(qsin_counted, QINT(0), qinfo.pi, 0x20, 1000), QINT(2), 0x40));
+	unit_test(&t, counted < 100);
+	const unsigned sin_evaluations = counted;
+	counted = 0;
+	unit_test(&t, qwithin_interval(qsimpson_adaptive(qsin_counted, qinfo.pi, QINT(0), 0x20, 1000), qnegate(QINT(2)), 0x40));
+	unit_test(&t, counted == sin_evaluations);
+	counted = 0;
+	(void)qsimpson_adaptive(qsin_counted, QINT(0), qinfo.pi, 0, 51);
+	unit_test(&t, counted <= 51);
+	unit_test(&t, qsimpson_adaptive(qsq, QINT(3), QINT(3), 0, 3) == 0);
+
+	enum { SAMPLES = 20001, };
+	static q_t y[SAMPLES];
+	for (size_t i = 0; i < SAMPLES; i++)
+		y[i] = QINT(3);
+	const q_t h = 0x10; /* the sum of samples is well beyond the range of a 'q_t' */
+	unit_test(&t, qwithin_interval(qtrapezoid_array(y, SAMPLES, h), qdiv(QINT(60000 / 16), QINT(256)), 0x2));
+	unit_test(&t, qwithin_interval(qsimpson_array(y, SAMPLES, h), qdiv(QINT(60000 / 16), QINT(256)), 0x2));
+	for (size_t i = 0; i < 33; i++) /* x^2 between 0 and 4 */
+		y[i] = qsq(QINT(i) / 8);
+	unit_test(&t, qwithin_interval(qsimpson_array(y, 33, QINT(1) / 8), qdiv(QINT(64), QINT(3)), 0x4));
+	unit_test(&t, qwithin_interval(qtrapezoid_array(y, 33, QINT(1) / 8), qdiv(QINT(64), QINT(3)) + qdiv(QINT(1), QINT(96)), 0x4));
+	unit_test(&t, qtrapezoid_array(y, 1, QINT(1)) == 0 && qsimpson_array(y, 1, QINT(1)) == 0);
+	unit_test(&t, qsimpson_array(y, 3, QINT(1)) == qdiv(y[0] + (4 * y[1]) + y[2], QINT(3)));
+	return unit_test_finish(&t);
+}
+
+static int test_nco(void) {
+	unit_test_t t = unit_test_start();
+	enum { SAMPLES = 65536, };
+	static q_t s[SAMPLES], c[SAMPLES];
+	qnco_t o;
+	qnco_init(&o, QINT(1), QINT(48)); /* 1 kHz at 48 kHz */
+	unit_test(&t, o.increment == 89478485uL && o.phase == 0 && o.table == NULL);
+	qnco_init(&o, -QINT(1), QINT(48));
+	unit_test(&t, o.increment == (u_t)-89478485L);
+	qnco_init(&o, QINT(1), QINT(4));
+	unit_test(&t, o.increment == 0x40000000uL);
+
+	o.phase = 0;
+	o.increment = 0x10000uL; /* every Furman angle, through the SIMD path and the tail */
+	qnco_iq_n(&o, c, s, SAMPLES - 3);
+	unit_test(&t, o.phase == (u_t)(SAMPLES - 3) * 0x10000uL);
+	int same = 1;
+	for (long i = 0; i < SAMPLES - 3; i++)
+		same &= s[i] == furman_sin(i) * 2 && c[i] == furman_cos(i) * 2;
+	unit_test(&t, same);
+
+	o.phase = 0x12345678uL;
+	o.increment = 0x0ABCDEF1uL;
+	qnco_sin_n(&o, s, 1003);
+	q_t error = 0;
+	u_t phase = 0x12345678uL;
+	for (size_t i = 0; i < 1003; i++, phase += 0x0ABCDEF1uL) {
+		const q_t theta = ((ld_t)phase * qinfo.pi) >> 31; /* phase in radians, 0 to 2pi */
+		const q_t e = qabs(qsub(s[i], qsin_lut(theta)));
+		error = e > error ? e : error;
+	}
+	unit_test(&t, error < 0x10);
+	qnco_cos_n(&o, &c[1], 1);
+	qnco_sin_n(&o, &s[1], 1);
+	unit_test(&t, c[1] == furman_cos(((o.phase - 2 * o.increment) + 0x8000uL) >> 16) * 2);
+
+	static const q_t saw[] = { 0, QINT(1), 0, -QINT(1), }; /* triangle wave */
+	o.table = saw;
+	o.bits = 2;
+	o.phase = 0;
+	o.increment = 0x20000000uL; /* an eighth of a cycle, half way between entries */
+	qnco_iq_n(&o, c, s, 9);
+	unit_test(&t, s[0] == 0 && s[1] == QINT(1) / 2 && s[2] == QINT(1) && s[6] == -QINT(1) && s[7] == -QINT(1) / 2 && s[8] == 0);
+	unit_test(&t, c[0] == QINT(1) && c[2] == 0 && c[4] == -QINT(1) && c[7] == QINT(1) / 2);
+	return unit_test_finish(&t);
+}
+
+static double fft_error(const q_t *x, const int exponent, const double *re, const double *im, const size_t n) {
+	double worst = 0; /* largest error of 'x * 2^exponent' against a reference, in units of a 'q_t' */
+	for (size_t k = 0; k < n; k++) {
+		const double dr = ldexp(x[2*k], exponent) - re[k], di = ldexp(x[2*k + 1], exponent) - im[k];
+		worst = fmax(worst, fmax(fabs(dr), fabs(di)));
+	}
+	return worst;
+}
+
+static void fft_reference(const q_t *x, double *re, double *im, const size_t n) {
+	const double pi = acos(-1.0);
+	for (size_t k = 0; k < n; k++) {
+		double r = 0, i = 0;
+		for (size_t j = 0; j < n; j++) {
+			const double a = -2.0 * pi * (double)((k * j) % n) / (double)n;
+			r += (x[2*j] * cos(a)) - (x[2*j + 1] * sin(a));
+			i += (x[2*j] * sin(a)) + (x[2*j + 1] * cos(a));
+		}
+		re[k] = r, im[k] = i;
+	}
+}
+
+static int test_fft(void) {
+	unit_test_t t = unit_test_start();
+	enum { SIZE = 4096, };
+	static q_t tw[SIZE], x[2 * SIZE], y[2 * SIZE], m[SIZE], ph[SIZE];
+	static double re[SIZE], im[SIZE];
+	qfft_t p;
+	unit_test(&t, qfft_init(&p, tw, 12) < 0 && qfft_init(&p, tw, 1) < 0);
+	unit_test(&t, qfft_init(&p, tw, 8) == 0 && tw[0] == QINT(1) && tw[1] == 0 && tw[4] == 0 && tw[5] == -QINT(1));
+
+	int e = 0, fine = 1;
+	memset(x, 0, sizeof x);
+	x[0] = QINT(1); /* an impulse has a flat spectrum */
+	unit_test(&t, qfft(&p, x, &e) == 0);
+	for (size_t k = 0; k < 8; k++)
+		fine &= ldexp(x[2*k], e) == QINT(1) && x[2*k + 1] == 0;
+	unit_test(&t, fine);
+
+	static const size_t sizes[] = { 2, 8, 32, 64, 512, 1024 }; /* odd and even powers of two */
+	for (size_t i = 0; i < sizeof (sizes) / sizeof (sizes[0]); i++) {
+		const size_t n = sizes[i];
+		unit_test(&t, qfft_init(&p, tw, n) == 0);
+		for (size_t j = 0; j < (2 * n); j++)
+			x[j] = y[j] = (q_t)((u_t)test_random() % 0x20000u) - QINT(1);
+		fft_reference(x, re, im, n);
+		unit_test(&t, qfft(&p, x, &e) == 0);
+		unit_test(&t, fft_error(x, e, re, im, n) < (double)(((size_t)16 << e) + 4 * n));
+		unit_test(&t, qifft(&p, x, &e) == 0);
+		double worst = 0;
+		for (size_t j = 0; j < (2 * n); j++)
+			worst = fmax(worst, fabs(ldexp(x[j], e) - y[j]));
+		unit_test(&t, worst < 0x40);
+	}
+
+	unit_test(&t, qfft_init(&p, tw, SIZE) == 0);
+	for (size_t j = 0; j < SIZE; j++) { /* full scale, must not saturate */
+		x[2*j] = INT32_MAX;
+		x[2*j + 1] = j & 1 ? INT32_MIN : INT32_MAX;
+	}
+	unit_test(&t, qfft(&p, x, &e) == 0);
+	unit_test(&t, fabs(ldexp(x[0], e) - (double)SIZE * INT32_MAX) < ldexp(0x10, e) && qwithin_interval(x[1], 0, 0x10));
+	unit_test(&t, fabs(ldexp(x[SIZE + 1], e) - (double)SIZE * INT32_MAX) < ldexp(0x10, e) && qwithin_interval(x[SIZE], 0, 0x10));
+
+	for (size_t j = 0; j < SIZE; j++) /* real transform of a tone against the complex one */
+		y[2*j] = x[j] = qsin(qdiv(qmul(qinfo.pi, QINT(2 * 100) + (j & 0xFF)), QINT(SIZE))) / 2 + 0x1000, y[2*j + 1] = 0;
+	int er = 0;
+	unit_test(&t, qfft_real(&p, x, &er) == 0);
+	unit_test(&t, qfft_init(&p, tw, SIZE) == 0 && qfft(&p, y, &e) == 0);
+	double worst = fabs(ldexp(x[0], er) - ldexp(y[0], e)) + fabs(ldexp(x[1], er) - ldexp(y[SIZE], e));
+	for (size_t k = 1; k < (SIZE / 2); k++)
+		worst = fmax(worst, fmax(fabs(ldexp(x[2*k], er) - ldexp(y[2*k], e)), fabs(ldexp(x[2*k + 1], er) - ldexp(y[2*k + 1], e))));
+	unit_test(&t, worst < (double)((size_t)8 << (e > er ? e : er)));
+	memcpy(y, x, sizeof (x[0]) * SIZE);
+	unit_test(&t, qifft_real(&p, x, &e) == 0);
+	worst = 0;
+	for (size_t j = 0; j < SIZE; j++)
+		worst = fmax(worst, fabs(ldexp(ldexp(x[j], e), er) - (qsin(qdiv(qmul(qinfo.pi, QINT(2 * 100) + (j & 0xFF)), QINT(SIZE))) / 2 + 0x1000)));
+	unit_test(&t, worst < 0x100);
+
+	memset(x, 0, sizeof (x[0]) * 8);
+	x[2] = QINT(3), x[3] = QINT(4), x[4] = -QINT(1), x[7] = -QINT(2);
+	qfft_polar(x, m, ph, 4);
+	unit_test(&t, m[0] == 0 && qwithin_interval(m[1], QINT(5), 0x10) && qwithin_interval(m[2], QINT(1), 0x10) && qwithin_interval(m[3], QINT(2), 0x10));
+	unit_test(&t, qwithin_interval(ph[1], 60777, 0x10) && qwithin_interval(ph[2], qinfo.pi, 0x10) && qwithin_interval(ph[3], (3 * qinfo.pi) / 2, 0x10));
+	return unit_test_finish(&t);
+}
+
+#if CONFIG_Q_THREADS > 0
+static void *test_stats_thread(void *arg) { /* counters are per thread */
+	assert(arg);
+	qstats_t *s = arg;
+	for (int i = 0; i < 3; i++)
+		(void)qadd_ctx(&qconf, INT32_MAX, QINT(1));
+	return qstats(s) < 0 ? NULL : s;
+}
+#endif
+
+static int test_stats(void) {
+	unit_test_t t = unit_test_start();
+	qstats_t s;
+	if (qstats_reset() < 0) { /* library built without 'CONFIG_Q_STATS' */
+		unit_test(&t, qstats(&s) < 0 && s.bounded[QSTAT_ADD] == 0 && s.domain[0] == 0);
+		return unit_test_finish(&t);
+	}
+	unit_test(&t, qstats(&s) == 0 && s.bounded[QSTAT_ADD] == 0);
+	const qrecip_t quarter = qrecip_init(QINT(1) / 4);
+	(void)qadd_ctx(&qconf, INT32_MAX, 1);
+	(void)qadd_ctx(&qconf, QINT(1), QINT(1));
+	(void)qsub_ctx(&qconf, QINT(1), QINT(1));
+	(void)qmul_ctx(&qconf, INT32_MAX, QINT(2));
+	(void)qdiv_ctx(&qconf, INT32_MAX, QINT(1) / 2);
+	(void)qdiv_by(&quarter, INT32_MIN);
+	(void)qdiv_by(&quarter, QINT(1));
+	(void)qals(QINT(1), 20);
+	(void)qexp(QINT(11));
+	unit_test(&t, qstats(&s) == 0);
+	unit_test(&t, s.bounded[QSTAT_ADD] == 1 && s.bounded[QSTAT_SUB] == 0 && s.bounded[QSTAT_MUL] == 1);
+	unit_test(&t, s.bounded[QSTAT_DIV] == 2 && s.bounded[QSTAT_SHIFT] == 1 && s.bounded[QSTAT_EXP] == 1);
+#if CONFIG_Q_THREADS > 0
+	qstats_t other;
+	pthread_t id;
+	void *r = NULL;
+	unit_test(&t, pthread_create(&id, NULL, test_stats_thread, &other) == 0 && pthread_join(id, &r) == 0);
+	unit_test(&t, r == &other && other.bounded[QSTAT_ADD] == 3 && other.bounded[QSTAT_MUL] == 0);
+	unit_test(&t, qstats(&s) == 0 && s.bounded[QSTAT_ADD] == 1);
+#endif
+	unit_test(&t, qstats_reset() == 0 && qstats(&s) == 0 && s.bounded[QSTAT_ADD] == 0 && s.bounded[QSTAT_DIV] == 0);
 	return unit_test_finish(&t);
 }
 
@@ -490,10 +1569,30 @@ static int internal_tests(void) {
 		test_sanity,
 		test_pack,
 		test_fma,
+		test_bulk,
+		test_cordic_n,
+		test_lut,
+		test_exp_log,
+		test_sqrt,
+		test_recip,
+		test_ctx,
+		test_qgen,
 		// test_filter,
 		test_matrix,
+		test_matrix_mul,
 		test_matrix_trace,
+		test_matrix_lu,
+		test_matrix_view,
+		test_matrix_elementwise,
+		test_filter_block,
+		test_pid_bank,
+		test_reduce,
+		test_parse,
+		test_file,
 		test_simpson,
+		test_stats,
+		test_nco,
+		test_fft,
 		NULL
 	};
 	for (size_t i = 0; tests[i]; i++)
@@ -502,6 +1601,427 @@ static int internal_tests(void) {
 	return 0;
 }
 
+/* The benchmarks walk the operator table, timing each operation over
+ * random inputs within a range (and within the domain accepted by its
+ * check function), followed by the batch and table driven versions of
+ * some of them. Times are CPU time from 'clock', cycles are from the time
+ * stamp counter where there is one (x86), so they are reference cycles. */
+
+enum { BENCH_INPUTS = 1024, };
+
+typedef struct {
+	const qoperations_t *op;
+	q_t (*unary)(q_t a);
+	q_t (*binary)(q_t a, q_t b);
+	void (*unary_n)(q_t *r, const q_t *a, size_t n);
+	void (*binary_n)(q_t *r, const q_t *a, const q_t *b, size_t n);
+	int iterations;
+	q_t a[BENCH_INPUTS], b[BENCH_INPUTS], r[BENCH_INPUTS];
+} bench_job_t;
+
+typedef struct {
+	const char *name, *engine;
+	q_t (*unary)(q_t a);
+	void (*unary_n)(q_t *r, const q_t *a, size_t n);
+	void (*binary_n)(q_t *r, const q_t *a, const q_t *b, size_t n);
+} bench_alternative_t;
+
+static q_t bench_cosines[BENCH_INPUTS];
+
+static void bench_sin_n(q_t *r, const q_t *a, size_t n) { qsincos_n(a, r, bench_cosines, n); }
+static void bench_cos_n(q_t *r, const q_t *a, size_t n) { qsincos_n(a, bench_cosines, r, n); }
+
+static void bench_nco_n(q_t *r, const q_t *a, size_t n) { /* ignores the inputs, it makes its own phase */
+	static qnco_t o = { .phase = 0, .increment = 0x0ABCDEF1uL, .table = NULL, .bits = 0, };
+	(void)a;
+	qnco_sin_n(&o, r, n);
+}
+
+static const bench_alternative_t bench_alternatives[] = {
+	{ "*",     "batch", NULL,      NULL,        qmul_n,   },
+	{ "+",     "batch", NULL,      NULL,        qadd_n,   },
+	{ "-",     "batch", NULL,      NULL,        qsub_n,   },
+	{ "atan2", "batch", NULL,      NULL,        qatan2_n, },
+	{ "cos",   "batch", NULL,      bench_cos_n, NULL,     },
+	{ "cos",   "lut",   qcos_lut,  NULL,        NULL,     },
+	{ "exp",   "batch", NULL,      qexp_n,      NULL,     },
+	{ "exp",   "lut",   qexp_lut,  NULL,        NULL,     },
+	{ "hypot", "batch", NULL,      NULL,        qhypot_n, },
+	{ "log",   "batch", NULL,      qlog_n,      NULL,     },
+	{ "log",   "lut",   qlog_lut,  NULL,        NULL,     },
+	{ "rsqrt", "batch", NULL,      qrsqrt_n,    NULL,     },
+	{ "sin",   "batch", NULL,      bench_sin_n, NULL,     },
+	{ "sin",   "lut",   qsin_lut,  NULL,        NULL,     },
+	{ "sin",   "nco",   NULL,      bench_nco_n, NULL,     },
+	{ "sqrt",  "batch", NULL,      qsqrt_n,     NULL,     },
+};
+
+static unsigned long long bench_cycles(void) {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	return __builtin_ia32_rdtsc();
+#else
+	return 0;
+#endif
+}
+
+static void bench_kernel(bench_job_t *j) {
+	assert(j);
+	if (j->unary_n) {
+		j->unary_n(j->r, j->a, BENCH_INPUTS);
+	} else if (j->binary_n) {
+		j->binary_n(j->r, j->a, j->b, BENCH_INPUTS);
+	} else if (j->unary) {
+		for (size_t i = 0; i < BENCH_INPUTS; i++)
+			j->r[i] = j->unary(j->a[i]);
+	} else if (j->binary) {
+		for (size_t i = 0; i < BENCH_INPUTS; i++)
+			j->r[i] = j->binary(j->a[i], j->b[i]);
+	} else if (j->iterations >= 0) {
+		for (size_t i = 0; i < BENCH_INPUTS; i++)
+			qcordic_sincos(j->a[i], &j->r[i], &bench_cosines[i], j->iterations);
+	} else { /* the straight line kernel 'qsincos' uses */
+		for (size_t i = 0; i < BENCH_INPUTS; i++)
+			qsincos(j->a[i], &j->r[i], &bench_cosines[i]);
+	}
+}
+
+static q_t bench_random(const q_t lo, const q_t hi) {
+	const uint64_t range = (uint64_t)((int64_t)hi - (int64_t)lo) + 1u;
+	return (q_t)((int64_t)lo + (int64_t)((uint32_t)test_random() % range));
+}
+
+/* fill the inputs, values the operation rejects are redrawn */
+static int bench_inputs(bench_job_t *j, const q_t lo, const q_t hi) {
+	assert(j);
+	const qoperations_t *op = j->op;
+	static qexpr_t e;
+	for (size_t i = 0; i < BENCH_INPUTS; i++) {
+		int tries = 0;
+		for (;; tries++) {
+			if (tries > 100)
+				return -1;
+			j->a[i] = bench_random(lo, hi);
+			j->b[i] = bench_random(lo, hi);
+			memset(&e, 0, sizeof (e));
+			if (!op || !op->check.unary)
+				break;
+			const q_t r = op->arity == 1 ? op->check.unary(&e, j->a[i]) : op->check.binary(&e, j->a[i], j->b[i]);
+			if (!r && !e.error)
+				break;
+		}
+	}
+	return 0;
+}
+
+typedef struct {
+	double ns, cycles; /* per operation, 'cycles' is zero if unknown */
+} bench_time_t;
+
+static bench_time_t bench_measure(bench_job_t *j) {
+	assert(j);
+	const double minimum = 0.01 * CLOCKS_PER_SEC;
+	unsigned long passes = 0;
+	clock_t elapsed = 0;
+	unsigned long long cycles = 0;
+	bench_kernel(j); /* warm up */
+	for (unsigned long count = 1; (double)elapsed < minimum; count *= 2) {
+		const clock_t start = clock();
+		const unsigned long long c = bench_cycles();
+		for (unsigned long i = 0; i < count; i++)
+			bench_kernel(j);
+		cycles = bench_cycles() - c;
+		elapsed = clock() - start;
+		passes = count;
+	}
+	const double operations = (double)passes * BENCH_INPUTS;
+	const bench_time_t t = {
+		.ns = ((double)elapsed / CLOCKS_PER_SEC) * 1e9 / operations,
+		.cycles = (double)cycles / operations,
+	};
+	return t;
+}
+
+static int bench_print(FILE *out, const char *name, const char *engine, const bench_time_t t, const char *extra) {
+	assert(out);
+	assert(name);
+	assert(engine);
+	assert(extra);
+	char cycles[32] = "-";
+	if (t.cycles > 0)
+		snprintf(cycles, sizeof (cycles), "%.1f", t.cycles);
+	return fprintf(out, "%-10s %-10s %10.2f %10s %10.1f%s\n", name, engine, t.ns, cycles, 1e3 / t.ns, extra) < 0 ? -1 : 0;
+}
+
+static int bench(FILE *out, const q_t lo, const q_t hi) {
+	assert(out);
+	static bench_job_t j;
+	char l[64] = { 0, }, h[64] = { 0, };
+	qsprint(lo, l, sizeof (l));
+	qsprint(hi, h, sizeof (h));
+	if (fprintf(out, "inputs: %s to %s\n%-10s %-10s %10s %10s %10s\n",
+			l, h, "operation", "engine", "ns/op", "cycles/op", "Mop/s") < 0)
+		return -1;
+	const qconf_t saved = qconf; /* 'base' and 'places' change it */
+	for (size_t i = 0; qop_at(i); i++, qconf = saved) {
+		const qoperations_t *op = qop_at(i);
+		if (!op->eval.unary)
+			continue;
+		memset(&j, 0, sizeof (j));
+		j.op = op;
+		if (bench_inputs(&j, lo, hi) < 0) {
+			if (fprintf(out, "%-10s (no valid inputs in range)\n", op->name) < 0)
+				return -1;
+			continue;
+		}
+		if (op->arity == 1)
+			j.unary = op->eval.unary;
+		else
+			j.binary = op->eval.binary;
+		if (bench_print(out, op->name, "scalar", bench_measure(&j), "") < 0)
+			return -1;
+		for (size_t k = 0; k < (sizeof (bench_alternatives) / sizeof (bench_alternatives[0])); k++) {
+			const bench_alternative_t *alt = &bench_alternatives[k];
+			if (strcmp(alt->name, op->name))
+				continue;
+			j.unary = alt->unary;
+			j.binary = NULL;
+			j.unary_n = alt->unary_n;
+			j.binary_n = alt->binary_n;
+			if (bench_print(out, op->name, alt->engine, bench_measure(&j), "") < 0)
+				return -1;
+		}
+	}
+	if (fprintf(out, "\n%-10s %-10s %10s %10s %10s %10s\n", "cordic", "iterations", "ns/call", "cycles", "Mcall/s", "gain") < 0)
+		return -1;
+	const int iterations[] = { 4, 8, 12, 16, -1, };
+	memset(&j, 0, sizeof (j));
+	if (bench_inputs(&j, lo, hi) < 0)
+		return -1;
+	for (size_t i = 0; i < (sizeof (iterations) / sizeof (iterations[0])); i++) {
+		j.iterations = iterations[i];
+		char count[32] = "default", gain[64] = " ";
+		if (iterations[i] >= 0)
+			snprintf(count, sizeof (count), "%d", iterations[i]);
+		qsprint(qcordic_circular_gain(iterations[i]), &gain[1], sizeof (gain) - 1);
+		if (bench_print(out, "sincos", count, bench_measure(&j), gain) < 0)
+			return -1;
+	}
+	return 0;
+}
+
+/* The accuracy sweep compares the unary functions against the C library,
+ * working in doubles, at every 'step'th input across each domain (a step of
+ * one is exhaustive). The domain is split into contiguous pieces, one per
+ * thread, and the statistics merged afterwards. Errors are measured in units
+ * of the last place (1/65536) and only over inputs where the correctly
+ * rounded result is representable, the others should saturate and are
+ * counted separately, as are those that do not. The accurate range is the
+ * interval around zero (or the nearest end of the domain) bounded by the
+ * first inputs either side with an error over the tolerance, or a wrongly
+ * saturated result. */
+
+enum { SWEEP_THREADS_MAX = 64, };
+
+typedef struct {
+	const char *name;
+	q_t (*f)(q_t a);
+	double (*reference)(double a);
+	bool (*valid)(q_t a); /* optional, inputs the function asserts on within the domain */
+	q_t lo, hi; /* inclusive domain to sweep */
+} sweep_function_t;
+
+typedef struct {
+	double max, sum;   /* largest and total error, in ULP */
+	q_t worst;         /* input giving the largest error */
+	long long below, above; /* nearest inaccurate inputs below and above the centre */
+	unsigned long long count, saturated, mismatched;
+} sweep_stats_t;
+
+typedef struct {
+	const sweep_function_t *fn;
+	long long start, end, step; /* 'end' is exclusive */
+	double tolerance;
+	sweep_stats_t stats;
+} sweep_job_t;
+
+static double sweep_rsqrt(double a) { return 1.0 / sqrt(a); }
+static bool sweep_tan_valid(q_t a) { return qcos(a) != 0; }
+
+static const sweep_function_t sweep_functions[] = {
+	{ "qsin",     qsin,     sin,         NULL,            INT32_MIN,    INT32_MAX, },
+	{ "qcos",     qcos,     cos,         NULL,            INT32_MIN,    INT32_MAX, },
+	{ "qtan",     qtan,     tan,         sweep_tan_valid, INT32_MIN,    INT32_MAX, },
+	{ "qasin",    qasin,    asin,        NULL,            -QINT(1),     QINT(1), },
+	{ "qacos",    qacos,    acos,        NULL,            -QINT(1),     QINT(1), },
+	{ "qatan",    qatan,    atan,        NULL,            INT32_MIN,    INT32_MAX, },
+	{ "qsinh",    qsinh,    sinh,        NULL,            INT32_MIN,    INT32_MAX, },
+	{ "qcosh",    qcosh,    cosh,        NULL,            INT32_MIN,    INT32_MAX, },
+	{ "qtanh",    qtanh,    tanh,        NULL,            INT32_MIN,    INT32_MAX, },
+	{ "qasinh",   qasinh,   asinh,       NULL,            INT32_MIN,    INT32_MAX, },
+	{ "qacosh",   qacosh,   acosh,       NULL,            QINT(1),      INT32_MAX, },
+	{ "qatanh",   qatanh,   atanh,       NULL,            -QINT(1) + 1, QINT(1) - 1, },
+	{ "qexp",     qexp,     exp,         NULL,            INT32_MIN,    INT32_MAX, },
+	{ "qlog",     qlog,     log,         NULL,            1,            INT32_MAX, },
+	{ "qsqrt",    qsqrt,    sqrt,        NULL,            0,            INT32_MAX, },
+	{ "qrsqrt",   qrsqrt,   sweep_rsqrt, NULL,            1,            INT32_MAX, },
+	{ "qsin_lut", qsin_lut, sin,         NULL,            INT32_MIN,    INT32_MAX, },
+	{ "qcos_lut", qcos_lut, cos,         NULL,            INT32_MIN,    INT32_MAX, },
+	{ "qexp_lut", qexp_lut, exp,         NULL,            INT32_MIN,    INT32_MAX, },
+	{ "qlog_lut", qlog_lut, log,         NULL,            1,            INT32_MAX, },
+};
+
+static long long sweep_centre(const sweep_function_t *fn) {
+	assert(fn);
+	return fn->lo > 0 ? fn->lo : fn->hi < 0 ? fn->hi : 0;
+}
+
+static void sweep_stats_init(sweep_stats_t *s) {
+	assert(s);
+	memset(s, 0, sizeof (*s));
+	s->below = LLONG_MIN;
+	s->above = LLONG_MAX;
+}
+
+static void sweep_inaccurate(sweep_stats_t *s, const long long centre, const long long a) {
+	assert(s);
+	if (a < centre && a > s->below)
+		s->below = a;
+	if (a >= centre && a < s->above)
+		s->above = a;
+}
+
+static void *sweep_worker(void *arg) {
+	assert(arg);
+	sweep_job_t *j = arg;
+	sweep_stats_t *s = &j->stats;
+	const double one = 65536.0;
+	const long long centre = sweep_centre(j->fn);
+	sweep_stats_init(s);
+	for (long long i = j->start; i < j->end; i += j->step) {
+		const q_t a = i;
+		if (j->fn->valid && !j->fn->valid(a))
+			continue;
+		const q_t r = j->fn->f(a);
+		const double expected = j->fn->reference(a / one) * one;
+		if (!(expected < (double)INT32_MAX + 0.5 && expected > (double)INT32_MIN - 0.5)) {
+			const q_t bound = expected > 0 ? INT32_MAX : INT32_MIN;
+			s->saturated++;
+			if (r != bound) {
+				s->mismatched++;
+				sweep_inaccurate(s, centre, a);
+			}
+			continue;
+		}
+		const double error = fabs(r - expected);
+		s->count++;
+		s->sum += error;
+		if (error > s->max || s->count == 1) {
+			s->max = error;
+			s->worst = a;
+		}
+		if (error > j->tolerance)
+			sweep_inaccurate(s, centre, a);
+	}
+	return NULL;
+}
+
+static void sweep_merge(sweep_stats_t *s, const sweep_stats_t *t) {
+	assert(s);
+	assert(t);
+	if (t->count && (t->max > s->max || !s->count)) {
+		s->max = t->max;
+		s->worst = t->worst;
+	}
+	if (t->below > s->below)
+		s->below = t->below;
+	if (t->above < s->above)
+		s->above = t->above;
+	s->sum        += t->sum;
+	s->count      += t->count;
+	s->saturated  += t->saturated;
+	s->mismatched += t->mismatched;
+}
+
+static int sweep_run(sweep_job_t *jobs, const int threads) {
+	assert(jobs);
+	assert(threads > 0);
+#if CONFIG_Q_THREADS > 0
+	pthread_t id[SWEEP_THREADS_MAX];
+	int started = 0, r = 0;
+	for (started = 0; started < threads; started++)
+		if (pthread_create(&id[started], NULL, sweep_worker, &jobs[started]))
+			break;
+	for (int i = started; i < threads; i++) /* not enough threads, run the rest here */
+		(void)sweep_worker(&jobs[i]);
+	for (int i = 0; i < started; i++)
+		if (pthread_join(id[i], NULL))
+			r = -1;
+	return r;
+#else
+	for (int i = 0; i < threads; i++)
+		(void)sweep_worker(&jobs[i]);
+	return 0;
+#endif
+}
+
+static int sweep_interval(char *s, size_t length, const long long lo, const long long hi) {
+	assert(s);
+	if (lo > hi)
+		return snprintf(s, length, "none");
+	char l[32] = { 0, }, h[32] = { 0, };
+	if (qsprint(lo, l, sizeof (l)) < 0 || qsprint(hi, h, sizeof (h)) < 0)
+		return -1;
+	return snprintf(s, length, "%s to %s", l, h);
+}
+
+static int sweep(FILE *out, const long long step, int threads, const double tolerance) {
+	assert(out);
+	assert(step > 0);
+	static sweep_job_t jobs[SWEEP_THREADS_MAX];
+	threads = threads < 1 ? 1 : threads > SWEEP_THREADS_MAX ? SWEEP_THREADS_MAX : threads;
+	if (fprintf(out, "step: %lld, threads: %d, tolerance: %g ULP\n\n", step, threads, tolerance) < 0)
+		return -1;
+	if (fprintf(out, "| %-10s | %-22s | %-22s | %13s | %9s | %-10s | %10s | %10s |\n",
+			"Function", "Domain", "Accurate inputs", "Max ULP", "Mean ULP", "Worst", "Saturated", "Mismatched") < 0)
+		return -1;
+	if (fprintf(out, "| ---------- | ---------------------- | ---------------------- | ------------- | --------- | ---------- | ---------- | ---------- |\n") < 0)
+		return -1;
+	for (size_t i = 0; i < (sizeof (sweep_functions) / sizeof (sweep_functions[0])); i++) {
+		const sweep_function_t *fn = &sweep_functions[i];
+		const long long lo = fn->lo, total = ((long long)fn->hi - lo) / step + 1;
+		const long long chunk = (total + threads - 1) / threads;
+		for (int k = 0; k < threads; k++) {
+			const long long s = k * chunk, e = (k + 1) * chunk;
+			jobs[k].fn        = fn;
+			jobs[k].step      = step;
+			jobs[k].tolerance = tolerance;
+			jobs[k].start     = lo + (s < total ? s : total) * step;
+			jobs[k].end       = lo + (e < total ? e : total) * step;
+		}
+		if (sweep_run(jobs, threads) < 0)
+			return -1;
+		sweep_stats_t s;
+		sweep_stats_init(&s);
+		for (int k = 0; k < threads; k++)
+			sweep_merge(&s, &jobs[k].stats);
+		/* the accurate range is between the samples next to the inaccurate ones */
+		const long long first = s.below == LLONG_MIN ? lo : s.below + step;
+		const long long last  = s.above == LLONG_MAX ? lo + (total - 1) * step : s.above - step;
+		char domain[80] = { 0, }, range[80] = { 0, }, worst[32] = "-";
+		if (sweep_interval(domain, sizeof (domain), fn->lo, fn->hi) < 0 || sweep_interval(range, sizeof (range), first, last) < 0)
+			return -1;
+		if (s.count)
+			qsprint(s.worst, worst, sizeof (worst));
+		if (fprintf(out, "| %-10s | %-22s | %-22s | %13.2f | %9.3f | %-10s | %10llu | %10llu |\n",
+				fn->name, domain, range, s.max, s.count ? s.sum / s.count : 0.0,
+				worst, s.saturated, s.mismatched) < 0)
+			return -1;
+		if (fflush(out) < 0)
+			return -1;
+	}
+	return 0;
+}
+
 static int help(FILE *out, const char *arg0) {
 	assert(out);
 	assert(arg0);
@@ -512,6 +2032,12 @@ License: MIT\n\
 E-mail:  howe.r.j.89@gmail.com\n\
 Site:    https://github.com/howerj/q\n\n\
 Options:\n\
+\t-b\trun the benchmarks, for every operator and some batch versions\n\
+\t-r lo hi\tset the range of benchmark inputs, the default is -8 to 8\n\
+\t-a\tsweep the functions against the C library, print an error table\n\t\t(the -S, -j and -E options must come before it)\n\
+\t-S step\tset the sweep step, 1 tests every input, the default is 256\n\
+\t-j n\tset the number of sweep threads, the default is 1\n\
+\t-E ulp\tset the error tolerance for the sweep's accurate range, default 16\n\
 \t-s\tprint a sine-cosine table\n\
 \t-h\tprint this help message and exit\n\
 \t-i\tprint library information\n\
@@ -536,13 +2062,17 @@ numbers of the form '-12.45'. 'expected' is the expected result,\n\
 'allowance' the +/- amount the result is allowed to deviated by, and\n\
 'arg1' and 'arg2' the operator arguments.\n\
 \n\n";
-	if (fprintf(out, "usage: %s -h -s -i -v -t -c file\n", arg0) < 0) return -1;
+	if (fprintf(out, "usage: %s -h -s -i -v -t -b -r lo hi -a -S step -j n -E ulp -c file\n", arg0) < 0) return -1;
 	if (fputs(h, out) < 0) return -1;
 	return 0;
 }
 
 int main(int argc, char **argv) {
 	bool ran = false;
+	q_t lo = qnegate(QINT(8)), hi = QINT(8);
+	long long step = 256;
+	int threads = 1;
+	double tolerance = 16.0;
 	for (int i = 1; i < argc; i++) {
 		if (!strcmp("-h", argv[i])) {
 			if (help(stdout, argv[0]) < 0)
@@ -558,6 +2088,38 @@ int main(int argc, char **argv) {
 			if (internal_tests() < 0)
 				return 1;
 			ran = true;
+		} else if (!strcmp("-b", argv[i])) {
+			if (bench(stdout, lo, hi) < 0)
+				return 1;
+			ran = true;
+		} else if (!strcmp("-a", argv[i])) {
+			if (sweep(stdout, step, threads, tolerance) < 0)
+				return 1;
+			ran = true;
+		} else if (!strcmp("-S", argv[i])) {
+			if ((i + 1) >= argc || (step = atoll(argv[i + 1])) < 1) {
+				(void)fprintf(stderr, "-S expects a step greater than zero\n");
+				return 1;
+			}
+			i++;
+		} else if (!strcmp("-j", argv[i])) {
+			if ((i + 1) >= argc || (threads = atoi(argv[i + 1])) < 1 || threads > SWEEP_THREADS_MAX) {
+				(void)fprintf(stderr, "-j expects a thread count, 1 to %d\n", SWEEP_THREADS_MAX);
+				return 1;
+			}
+			i++;
+		} else if (!strcmp("-E", argv[i])) {
+			if ((i + 1) >= argc || !((tolerance = atof(argv[i + 1])) >= 0)) {
+				(void)fprintf(stderr, "-E expects a tolerance in ULP, zero or more\n");
+				return 1;
+			}
+			i++;
+		} else if (!strcmp("-r", argv[i])) {
+			if ((i + 2) >= argc || qconv(&lo, argv[i + 1]) < 0 || qconv(&hi, argv[i + 2]) < 0 || qmore(lo, hi)) {
+				(void)fprintf(stderr, "-r expects a range, two numbers, lo <= hi\n");
+				return 1;
+			}
+			i += 2;
 		} else if (!strcmp("-i", argv[i])) {
 			if (qinfo_print(stdout, &qinfo) < 0)
 				return 1;